@@ -11,6 +11,9 @@
 struct write_tgt_ctx {
 	FILE *out;
 	const struct project *proj;
+	struct hash *args_vars;
+	FILE *compdb;
+	uint32_t compdb_entries;
 	bool wrote_default;
 };
 
@@ -9,4 +9,5 @@
 
 bool ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj,
 	bool need_phony, obj compiler_rule_arr);
+obj ninja_compiler_command(struct workspace *wk, obj rule_args, obj comp_id);
 #endif
@@ -0,0 +1,22 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_CACHE_H
+#define MUON_CACHE_H
+
+#include "lang/workspace.h"
+
+/*
+ * A persistent cache shared between build directories.  Entries are arbitrary
+ * objects stored under a namespace and a 32 byte key (usually a sha256).
+ */
+
+#define CACHE_DEFAULT_MAX_SIZE (64 * 1024 * 1024)
+
+bool cache_dir(struct workspace *wk, struct sbuf *res);
+bool cache_get(struct workspace *wk, const char *ns, const uint8_t key[32], obj *res);
+bool cache_set(struct workspace *wk, const char *ns, const uint8_t key[32], obj val);
+bool cache_evict(struct workspace *wk, const char *ns, uint64_t max_size);
+#endif
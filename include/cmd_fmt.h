@@ -0,0 +1,19 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_CMD_FMT_H
+#define MUON_CMD_FMT_H
+#include <stdbool.h>
+#include <stdint.h>
+
+struct fmt_options {
+	char *const *filenames;
+	uint32_t filenames_len, jobs;
+	const char *cfg_path;
+	bool in_place, check_only, editorconfig, cache, no_evict;
+};
+
+bool fmt_run(struct fmt_options *opts, const char *argv0);
+#endif
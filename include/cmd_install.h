@@ -6,9 +6,11 @@
 #ifndef MUON_CMD_INSTALL_H
 #define MUON_CMD_INSTALL_H
 #include <stdbool.h>
+#include <stdint.h>
 
 struct install_options {
 	const char *destdir;
+	uint32_t jobs;
 	bool dry_run;
 };
 
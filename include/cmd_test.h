@@ -15,6 +15,7 @@ enum test_flag {
 };
 
 #define MAX_CMDLINE_TEST_SUITES 64
+#define TEST_DEFAULT_OUTPUT_MAX_KIB 1024
 
 enum test_display {
 	test_display_auto,
@@ -27,8 +28,10 @@ struct test_options {
 	char *const *tests;
 	const char *setup;
 	uint32_t suites_len, tests_len, jobs, verbosity;
+	// per-stream limit on the captured output of a test, 0 for no limit
+	uint32_t output_max;
 	enum test_display display;
-	bool fail_fast, print_summary, no_rebuild, list;
+	bool fail_fast, failed_first, print_summary, no_rebuild, list;
 
 	enum test_category cat;
 };
@@ -0,0 +1,51 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_DIGEST_H
+#define MUON_DIGEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sha_256.h"
+
+#define DIGEST_MAX_LEN 64
+
+enum digest_algo {
+	digest_algo_md5,
+	digest_algo_sha1,
+	digest_algo_sha224,
+	digest_algo_sha256,
+	digest_algo_sha384,
+	digest_algo_sha512,
+};
+
+struct digest {
+	enum digest_algo algo;
+	union {
+		struct sha_256 sha_256;
+		struct {
+			union {
+				uint32_t w[5];
+				uint64_t d[8];
+			} h;
+			uint8_t chunk[128];
+			size_t chunk_len;
+			uint64_t total_len;
+		} other;
+	} ctx;
+};
+
+bool digest_algo_from_s(const char *name, enum digest_algo *res);
+uint32_t digest_len(enum digest_algo algo);
+
+void digest_init(struct digest *d, enum digest_algo algo);
+void digest_update(struct digest *d, const void *input, size_t len);
+void digest_final(struct digest *d, uint8_t *hash);
+
+bool digest_file(enum digest_algo algo, const char *path, uint8_t *hash);
+void digest_to_hex(const uint8_t *hash, uint32_t len, char *buf);
+#endif
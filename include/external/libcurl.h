@@ -11,7 +11,9 @@
 
 extern const bool have_libcurl;
 
+typedef bool ((*muon_curl_write_cb)(void *ctx, const uint8_t *buf, uint64_t len));
+
 void muon_curl_init(void);
 void muon_curl_deinit(void);
-bool muon_curl_fetch(const char *url, uint8_t **buf, uint64_t *len);
+bool muon_curl_fetch(const char *url, muon_curl_write_cb cb, void *ctx);
 #endif
@@ -13,4 +13,5 @@ struct editorconfig_opts {
 };
 
 void try_parse_editorconfig(struct source *src, struct editorconfig_opts *opts);
+void editorconfig_cache_destroy(void);
 #endif
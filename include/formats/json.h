@@ -0,0 +1,11 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_FORMATS_JSON_H
+#define MUON_FORMATS_JSON_H
+#include <stdio.h>
+
+void json_write_str(FILE *out, const char *s);
+#endif
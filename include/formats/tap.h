@@ -14,5 +14,20 @@ struct tap_parse_result {
 	bool all_ok;
 };
 
-void tap_parse(char *buf, uint64_t buf_len, struct tap_parse_result *res);
+/*
+ * An incremental TAP parser, fed with output as it arrives.  The counts in
+ * res are kept up to date while parsing, total and all_ok are only valid
+ * after tap_parser_finish.
+ */
+struct tap_parser {
+	struct tap_parse_result res;
+	char *line;
+	uint32_t line_len, line_cap;
+	bool have_plan, bail_out;
+};
+
+void tap_parser_init(struct tap_parser *ctx);
+void tap_parser_feed(struct tap_parser *ctx, const char *buf, uint64_t len);
+void tap_parser_finish(struct tap_parser *ctx, struct tap_parse_result *res);
+void tap_parser_destroy(struct tap_parser *ctx);
 #endif
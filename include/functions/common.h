@@ -42,6 +42,7 @@ extern bool disabler_among_args_immunity, disable_fuzz_unsafe_functions;
 void build_func_impl_tables(void);
 
 const struct func_impl *func_lookup(const struct func_impl **impl_tbl, enum language_mode mode, const char *name);
+const struct func_impl *func_lookup_node(struct workspace *wk, const struct func_impl **impl_tbl, enum obj_type rcvr_type, uint32_t name_node);
 
 bool interp_args(struct workspace *wk, uint32_t args_node,
 	struct args_norm positional_args[],
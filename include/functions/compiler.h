@@ -8,4 +8,6 @@
 #include "functions/common.h"
 
 extern const struct func_impl impl_tbl_compiler[];
+
+void compiler_check_cache_persist(struct workspace *wk);
 #endif
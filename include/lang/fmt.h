@@ -10,5 +10,19 @@
 
 #include "lang/parser.h"
 
-bool fmt(struct source *src, FILE *out, const char *cfg_path, bool check_only, bool editorconfig);
+struct fmt_opts {
+	bool space_array, kwa_ml, wide_colon, no_single_comma_function;
+	uint32_t max_line_len;
+	const char *indent_by;
+
+	bool cfg_sets_indent_by;
+	struct source cfg_src;
+	char *cfg_buf;
+};
+
+void fmt_opts_init(struct fmt_opts *opts);
+bool fmt_opts_load(struct fmt_opts *opts, const char *cfg_path);
+void fmt_opts_destroy(struct fmt_opts *opts);
+void fmt_opts_for_file(const struct fmt_opts *opts, struct source *src, struct fmt_opts *res);
+bool fmt(struct source *src, FILE *out, const struct fmt_opts *opts, bool check_only);
 #endif
@@ -33,11 +33,12 @@ bool boundscheck(struct workspace *wk, uint32_t n_id, uint32_t len, int64_t *i);
 bool bounds_adjust(struct workspace *wk, uint32_t len, int64_t *i);
 bool rangecheck(struct workspace *wk, uint32_t n_id, int64_t min, int64_t max, int64_t n);
 
-void assign_variable(struct workspace *wk, const char *name, obj o, uint32_t _n_id, enum variable_assignment_mode mode);
-void unassign_variable(struct workspace *wk, const char *name);
+void assign_variable(struct workspace *wk, obj sym, obj o, uint32_t _n_id, enum variable_assignment_mode mode);
+void unassign_variable(struct workspace *wk, obj sym);
+void make_scope(struct workspace *wk, obj *res);
 void push_local_scope(struct workspace *wk);
 void pop_local_scope(struct workspace *wk);
-bool get_variable(struct workspace *wk, const char *name, obj *res, uint32_t proj_id);
+bool get_variable(struct workspace *wk, obj sym, obj *res, uint32_t proj_id);
 obj scope_stack_dup(struct workspace *wk, obj scope_stack);
 
 void interpreter_init(void);
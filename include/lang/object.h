@@ -162,12 +162,12 @@ struct obj_module {
 	obj exports;
 };
 
+/*
+ * Array elements are stored contiguously in wk->array_elems, starting at
+ * data.  cap elements are reserved for the array there.
+ */
 struct obj_array {
-	obj val; // any
-	obj next; // obj_array
-	obj tail; // obj_array
-	uint32_t len;
-	bool have_next;
+	uint32_t data, len, cap;
 };
 
 enum obj_dict_flags {
@@ -469,7 +469,7 @@ struct obj_source_configuration {
 /* end of object structs */
 
 struct obj_clear_mark {
-	uint32_t obji;
+	uint32_t obji, array_elems;
 	struct bucket_arr_save objs, chrs;
 	struct bucket_arr_save obj_aos[obj_type_count - _obj_aos_start];
 };
@@ -567,6 +567,16 @@ obj obj_array_slice(struct workspace *wk, obj arr, int64_t i0, int64_t i1);
 obj obj_array_get_tail(struct workspace *wk, obj arr);
 obj obj_array_pop(struct workspace *wk, obj arr);
 
+struct obj_ordered_set {
+	obj arr; // obj_array
+	struct hash index;
+};
+
+void obj_ordered_set_init(struct workspace *wk, struct obj_ordered_set *set);
+void obj_ordered_set_destroy(struct obj_ordered_set *set);
+bool obj_ordered_set_push(struct workspace *wk, struct obj_ordered_set *set, obj val);
+void obj_ordered_set_extend(struct workspace *wk, struct obj_ordered_set *set, obj arr);
+
 typedef enum iteration_result (*obj_dict_iterator)(struct workspace *wk, void *ctx, obj key, obj val);
 bool obj_dict_foreach(struct workspace *wk, obj dict, void *ctx, obj_dict_iterator cb);
 bool obj_dict_in(struct workspace *wk, obj dict, obj key);
@@ -579,6 +589,7 @@ void obj_dict_merge(struct workspace *wk, obj dict, obj dict2, obj *res);
 void obj_dict_merge_nodup(struct workspace *wk, obj dict, obj dict2);
 void obj_dict_seti(struct workspace *wk, obj dict, uint32_t key, obj val);
 bool obj_dict_geti(struct workspace *wk, obj dict, uint32_t key, obj *val);
+void obj_dict_deli(struct workspace *wk, obj dict, uint32_t key);
 void obj_dict_del(struct workspace *wk, obj dict, obj key);
 void obj_dict_del_str(struct workspace *wk, obj dict, const char *str);
 void obj_dict_del_strn(struct workspace *wk, obj dict, const char *str, uint32_t len);
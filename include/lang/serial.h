@@ -10,5 +10,7 @@
 
 bool serial_dump(struct workspace *wk_src, obj o, FILE *f);
 bool serial_load(struct workspace *wk, obj *res, FILE *f);
+bool serial_load_buf(struct workspace *wk, obj *res, const uint8_t *buf, uint64_t len);
 bool serial_load_from_private_dir(struct workspace *wk, obj *res, const char *file);
+uint32_t serial_format_version(void);
 #endif
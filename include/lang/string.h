@@ -62,6 +62,7 @@ obj make_str(struct workspace *wk, const char *str);
 obj make_strn(struct workspace *wk, const char *str, uint32_t n);
 obj make_strf(struct workspace *wk, const char *fmt, ...)
 MUON_ATTR_FORMAT(printf, 2, 3);
+obj make_sym(struct workspace *wk, const char *name);
 
 void str_app(struct workspace *wk, obj *s, const char *str);
 void str_appf(struct workspace *wk, obj *s, const char *fmt, ...)
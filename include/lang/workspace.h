@@ -91,6 +91,17 @@ struct workspace {
 	obj global_opts;
 	/* dict[sha_512 -> [bool, any]] */
 	obj compiler_check_cache;
+	/* number of compiler checks that may run concurrently */
+	uint32_t compiler_check_jobs;
+	/* whether compiler check results are shared with other build dirs */
+	bool compiler_check_shared_cache;
+	/* dict[sha_256 -> sha_256], compiler_check_cache keys that missed the
+	 * shared cache, and the keys to store them under there */
+	obj compiler_check_shared_keys;
+	/* dict[str -> [number, str, str]], see toolchain_cache.h */
+	obj toolchain_cmd_cache;
+	/* whether toolchain_cmd_cache entries were added to the shared cache */
+	bool toolchain_cache_written;
 	/* list[dict[str -> any]] */
 	obj default_scope;
 	/* ----------------- */
@@ -98,6 +109,7 @@ struct workspace {
 	struct bucket_arr chrs;
 	struct bucket_arr objs;
 	struct bucket_arr dict_elems, dict_hashes;
+	struct arr array_elems;
 	/* struct bucket_arr inst; */
 	struct bucket_arr obj_aos[obj_type_count - _obj_aos_start];
 
@@ -106,7 +118,13 @@ struct workspace {
 	struct arr source_data;
 	struct bucket_arr asts;
 
-	struct hash obj_hash, str_hash;
+	struct hash str_hash;
+	// lookups in str_hash, for workspace_write_stats()
+	struct {
+		uint64_t str_lookups, str_hits, sym_lookups, sym_hits;
+	} intern_stats;
+	// see dep_process_deps_memo
+	struct hash dep_memo;
 
 	uint32_t loop_depth, func_depth, return_node;
 	enum loop_ctl loop_ctl;
@@ -121,12 +139,12 @@ struct workspace {
 	struct source *src;
 	/* interpreter base functions */
 	bool ((*interp_node)(struct workspace *wk, uint32_t node, obj *res));
-	void ((*assign_variable)(struct workspace *wk, const char *name, obj o, uint32_t n_id, enum variable_assignment_mode mode));
-	void ((*unassign_variable)(struct workspace *wk, const char *name));
+	void ((*assign_variable)(struct workspace *wk, obj sym, obj o, uint32_t n_id, enum variable_assignment_mode mode));
+	void ((*unassign_variable)(struct workspace *wk, obj sym));
 	void ((*push_local_scope)(struct workspace *wk));
 	void ((*pop_local_scope)(struct workspace *wk));
 	obj((*scope_stack_dup)(struct workspace *wk, obj scope_stack));
-	bool ((*get_variable)(struct workspace *wk, const char *name, obj *res, uint32_t proj_id));
+	bool ((*get_variable)(struct workspace *wk, obj sym, obj *res, uint32_t proj_id));
 	bool ((*eval_project_file)(struct workspace *wk, const char *path, bool first));
 	bool in_analyzer;
 
@@ -159,4 +177,5 @@ struct project *make_project(struct workspace *wk, uint32_t *id, const char *sub
 struct project *current_project(struct workspace *wk);
 
 void workspace_print_summaries(struct workspace *wk, FILE *out);
+void workspace_write_stats(struct workspace *wk, FILE *out, const char *phase);
 #endif
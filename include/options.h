@@ -31,6 +31,9 @@ bool prefix_dir_opts(struct workspace *wk);
 bool setup_project_options(struct workspace *wk, const char *cwd);
 bool init_global_options(struct workspace *wk);
 
+bool options_snapshot_get(const char *script, const uint8_t **data, uint64_t *len);
+bool options_snapshot_write(const char *path);
+
 bool parse_and_set_cmdline_option(struct workspace *wk, char *lhs);
 bool parse_and_set_default_options(struct workspace *wk, uint32_t err_node, obj arr, obj project_name, bool for_subproject);
 bool parse_and_set_override_options(struct workspace *wk, uint32_t err_node, obj arr, obj *res);
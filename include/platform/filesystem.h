@@ -33,6 +33,8 @@ struct workspace;
 struct sbuf;
 
 bool fs_stat(const char *path, struct stat *sb);
+// the modification time of sb in nanoseconds, where the platform has them
+int64_t fs_stat_mtime_ns(const struct stat *sb);
 bool fs_exists(const char *path);
 bool fs_file_exists(const char *path);
 bool fs_symlink_exists(const char *path);
@@ -40,6 +42,7 @@ bool fs_exe_exists(const char *path);
 bool fs_dir_exists(const char *path);
 bool fs_mkdir(const char *path);
 bool fs_mkdir_p(const char *path);
+bool fs_rmdir(const char *path);
 bool fs_read_entire_file(const char *path, struct source *src);
 bool fs_fsize(FILE *file, uint64_t *ret);
 bool fs_fclose(FILE *file);
@@ -47,6 +50,8 @@ FILE *fs_fopen(const char *path, const char *mode);
 bool fs_fwrite(const void *ptr, size_t size, FILE *f);
 bool fs_fread(void *ptr, size_t size, FILE *f);
 bool fs_write(const char *path, const uint8_t *buf, uint64_t buf_len);
+bool fs_remove(const char *path);
+bool fs_rename(const char *old, const char *new);
 bool fs_find_cmd(struct workspace *wk, struct sbuf *buf, const char *cmd);
 bool fs_has_cmd(const char *cmd);
 void fs_source_destroy(struct source *src);
@@ -54,6 +59,18 @@ void fs_source_dup(const struct source *src, struct source *dup);
 bool fs_redirect(const char *path, const char *mode, int fd, int *old_fd);
 bool fs_redirect_restore(int fd, int old_fd);
 bool fs_copy_file(const char *src, const char *dest);
+/*
+ * Returns true if a and b both exist and have the same contents.
+ */
+bool fs_same_contents(const char *a, const char *b);
+typedef bool ((*fs_copy_fixup_cb)(void *ctx, const char *path));
+/*
+ * Copy src to dest unless dest has the same size and modification time as
+ * src or, if there is no fixup, the same contents.  A copied dest is passed
+ * to fixup and then given the modification time of src, so that later calls
+ * can skip it without reading it.  copied is set if dest was written.
+ */
+bool fs_copy_file_if_changed(const char *src, const char *dest, fs_copy_fixup_cb fixup, void *ctx, bool *copied);
 bool fs_copy_dir(const char *src_base, const char *dest_base);
 bool fs_fileno(FILE *f, int *ret);
 bool fs_make_symlink(const char *target, const char *path, bool force);
@@ -64,6 +81,8 @@ bool fs_is_a_tty_from_fd(int fd);
 bool fs_is_a_tty(FILE *f);
 bool fs_chmod(const char *path, uint32_t mode);
 bool fs_copy_metadata(const char *src, const char *dest);
+// set the modification time of path to now
+bool fs_touch(const char *path);
 /* Windows only */
 bool fs_has_extension(const char *path, const char *ext);
 
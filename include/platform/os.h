@@ -8,6 +8,7 @@
 #define MUON_PLATFORM_OS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef _WIN32
 #ifndef S_IRUSR
@@ -28,5 +29,16 @@ extern int opterr, optind, optopt;
 bool os_chdir(const char *path);
 char *os_getcwd(char *buf, size_t size);
 int os_getopt(int argc, char * const argv[], const char *optstring);
+uint32_t os_getpid(void);
+bool os_peak_rss(uint64_t *bytes);
+
+/*
+ * Call fn(ctx, i) for each i below n, each in its own copy of the current
+ * process, and wait for all of them to finish.  Returns false if this isn't
+ * supported on the current platform or the copies couldn't be created (in
+ * which case some calls may have run already, unless n is 1), otherwise res
+ * is set to whether all calls succeeded.
+ */
+bool os_run_isolated(bool (*fn)(void *ctx, uint32_t i), void *ctx, uint32_t n, bool *res);
 
 #endif
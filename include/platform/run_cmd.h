@@ -8,6 +8,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #ifdef _WIN32
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
@@ -27,6 +28,9 @@ struct run_cmd_pipe_ctx {
 	size_t size;
 	size_t len;
 	char *buf;
+	// output that didn't fit in capture_max, buf holds what came after it
+	FILE *spill;
+	uint64_t spilled;
 };
 
 enum run_cmd_ctx_flags {
@@ -39,6 +43,7 @@ struct run_cmd_ctx {
 	const char *err_msg; // set on error
 	const char *chdir; // set by caller
 	const char *stdin_path; // set by caller
+	size_t capture_max; // set by caller, 0 keeps all of stdout in memory
 	int status;
 	enum run_cmd_ctx_flags flags;
 #ifdef _WIN32
@@ -69,6 +74,48 @@ uint32_t argstr_to_argv(const char *argstr, uint32_t argc, const char *prepend,
 bool run_cmd(struct run_cmd_ctx *ctx, const char *argstr, uint32_t argc, const char *envstr, uint32_t envc);
 bool run_cmd_argv(struct run_cmd_ctx *ctx, char *const *argv, const char *envstr, uint32_t envc);
 enum run_cmd_state run_cmd_collect(struct run_cmd_ctx *ctx);
+/*
+ * Block until one of the commands in ctxs has output ready or exits, or
+ * until timeout_ms has passed.  Output is not consumed, call run_cmd_collect
+ * afterwards.
+ */
+#define RUN_CMD_WAIT_MAX 1000
+void run_cmd_wait(struct run_cmd_ctx **ctxs, uint32_t len, uint32_t timeout_ms);
+/*
+ * Undo the process-wide state set up by run_cmd_wait, for use in a forked
+ * child that keeps running muon code instead of calling exec.
+ */
+void run_cmd_wait_reset(void);
 void run_cmd_ctx_destroy(struct run_cmd_ctx *ctx);
+/*
+ * Run total commands, at most jobs of them at a time.  argv_cb returns the
+ * argv of the ith command, which only needs to stay valid until the command
+ * is started.  done_cb is called for every command once it has exited or
+ * failed to start, before its buffered output is printed.  Returns false if
+ * any command failed.
+ */
+typedef const char *const *((*run_cmd_jobs_argv_cb)(void *ctx, uint32_t i));
+typedef void ((*run_cmd_jobs_done_cb)(void *ctx, uint32_t i, const struct run_cmd_ctx *cmd_ctx, bool ok));
+bool run_cmd_jobs(uint32_t total,
+	uint32_t jobs,
+	void *ctx,
+	run_cmd_jobs_argv_cb argv_cb,
+	run_cmd_jobs_done_cb done_cb);
+/*
+ * Discard everything but the last len bytes of captured output, returning the
+ * number of bytes discarded.
+ */
+size_t run_cmd_pipe_keep_tail(struct run_cmd_pipe_ctx *ctx, size_t len);
+/*
+ * Move captured output to a temporary file once more than max bytes of it
+ * are held in memory.
+ */
+#define RUN_CMD_CAPTURE_SPILL_SIZE (1024 * 1024)
+bool run_cmd_pipe_spill(struct run_cmd_pipe_ctx *ctx, size_t max);
+/*
+ * Write all captured output, including any that was spilled, to path.
+ */
+bool run_cmd_pipe_write(struct run_cmd_pipe_ctx *ctx, const char *path);
+void run_cmd_pipe_destroy(struct run_cmd_pipe_ctx *ctx);
 bool run_cmd_kill(struct run_cmd_ctx *ctx, bool force);
 #endif
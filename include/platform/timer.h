@@ -29,6 +29,7 @@ struct timer {
 
 void timer_start(struct timer *t);
 float timer_end(struct timer *t);
+uint64_t timer_elapsed_ns(struct timer *t);
 void timer_sleep(uint64_t nanoseconds);
 
 #endif
@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_PROFILE_H
+#define MUON_PROFILE_H
+
+#include "compat.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * A span profiler for setup that works without tracy.  Spans on the main
+ * thread of execution are opened with profile_begin() and must be closed
+ * with profile_end() in order.  Work that overlaps with other spans, like
+ * concurrent compiler checks, is recorded once it is done with
+ * profile_record(), on a separate lane.  All of these do nothing unless
+ * profile_init() has been called.
+ *
+ * cat must be a string literal, name and detail are copied.
+ */
+
+void profile_init(void);
+void profile_destroy(void);
+bool profile_enabled(void);
+uint64_t profile_now(void);
+
+void profile_begin(const char *cat, const char *name);
+void profile_begin_detail(const char *cat, const char *name, const char *fmt, ...)
+MUON_ATTR_FORMAT(printf, 3, 4);
+void profile_end(void);
+void profile_record(const char *cat, uint32_t lane, uint64_t start, const char *name, const char *fmt, ...)
+MUON_ATTR_FORMAT(printf, 5, 6);
+
+bool profile_write(const char *path);
+void profile_print_slowest(uint32_t n);
+#endif
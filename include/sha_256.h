@@ -9,5 +9,19 @@
 #include <stdint.h>
 #include <stddef.h>
 
+struct sha_256 {
+	uint32_t h[8];
+	uint8_t chunk[64];
+	size_t chunk_len;
+	uint64_t total_len;
+	unsigned hash_len;
+	void (*blocks)(uint32_t h[8], const uint8_t *p, size_t n);
+};
+
+void sha_256_init(struct sha_256 *ctx);
+void sha_224_init(struct sha_256 *ctx);
+void sha_256_update(struct sha_256 *ctx, const void *input, size_t len);
+void sha_256_final(struct sha_256 *ctx, uint8_t *hash);
+
 void calc_sha_256(uint8_t hash[32], const void *input, size_t len);
 #endif
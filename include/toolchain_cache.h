@@ -0,0 +1,24 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_TOOLCHAIN_CACHE_H
+#define MUON_TOOLCHAIN_CACHE_H
+
+#include "lang/workspace.h"
+
+/*
+ * Output of commands run to detect properties of toolchain programs, e.g.
+ * "cc --version".  Results are remembered for the rest of the run, and also
+ * in the shared cache if it is enabled.
+ */
+struct toolchain_cmd_result {
+	obj out, err;
+	int32_t status;
+};
+
+bool toolchain_run_cmd(struct workspace *wk, obj cmd_arr, const char *arg, struct toolchain_cmd_result *res);
+void toolchain_cache_evict(struct workspace *wk);
+bool toolchain_cache_key(struct workspace *wk, const struct str *prefix, obj cmd_arr, uint8_t key[32]);
+#endif
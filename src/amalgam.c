@@ -18,6 +18,8 @@
 #include "backend/ninja/custom_target.c"
 #include "backend/ninja/rules.c"
 #include "backend/output.c"
+#include "cache.c"
+#include "cmd_fmt.c"
 #include "cmd_install.c"
 #include "cmd_test.c"
 #include "coerce.c"
@@ -25,6 +27,7 @@
 #include "datastructures/arr.c"
 #include "datastructures/bucket_arr.c"
 #include "datastructures/hash.c"
+#include "digest.c"
 #include "embedded.c"
 #include "error.c"
 #include "external/bestline_null.c"
@@ -34,6 +37,7 @@
 #include "external/tinyjson_null.c"
 #include "formats/editorconfig.c"
 #include "formats/ini.c"
+#include "formats/json.c"
 #include "formats/lines.c"
 #include "formats/tap.c"
 #include "functions/array.c"
@@ -93,7 +97,9 @@
 #include "memmem.c"
 #include "meson_opts.c"
 #include "options.c"
+#include "options_snapshot.c"
 #include "opts.c"
+#include "profile.c"
 #include "platform/filesystem.c"
 #include "platform/mem.c"
 #include "platform/path.c"
@@ -101,6 +107,7 @@
 #include "platform/uname.c"
 #include "rpmvercmp.c"
 #include "sha_256.c"
+#include "toolchain_cache.c"
 #include "version.c.in"
 #include "wrap.c"
 
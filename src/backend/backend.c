@@ -11,6 +11,7 @@
 #include "functions/environment.h"
 #include "log.h"
 #include "platform/run_cmd.h"
+#include "profile.h"
 #include "tracy.h"
 
 static enum iteration_result
@@ -53,17 +54,25 @@ bool
 backend_output(struct workspace *wk)
 {
 	TracyCZoneAutoS;
+	bool ret = false;
+	profile_begin("backend", "backend_output");
+
 	if (!ninja_write_all(wk)) {
 		LOG_E("backend output failed");
-		TracyCZoneAutoE;
-		return false;
+		goto ret;
 	}
 
-	if (!obj_array_foreach(wk, wk->postconf_scripts, NULL, run_postconf_script_iter)) {
-		TracyCZoneAutoE;
-		return false;
+	profile_begin("backend", "postconf scripts");
+	bool ok = obj_array_foreach(wk, wk->postconf_scripts, NULL, run_postconf_script_iter);
+	profile_end();
+
+	if (!ok) {
+		goto ret;
 	}
 
+	ret = true;
+ret:
+	profile_end();
 	TracyCZoneAutoE;
-	return true;
+	return ret;
 }
@@ -21,6 +21,7 @@
 #include "options.h"
 #include "platform/filesystem.h"
 #include "platform/mem.h"
+#include "platform/os.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
 #include "tracy.h"
@@ -103,29 +104,25 @@ write_tgt_iter(struct workspace *wk, void *_ctx, obj tgt_id)
 
 struct write_build_ctx {
 	obj compiler_rule_arr;
+	FILE *out;
 };
 
+/*
+ * Called with compile_commands.json open, which is written while writing the
+ * targets to build.ninja.
+ */
 static bool
-ninja_write_build(struct workspace *wk, void *_ctx, FILE *out)
+ninja_write_build_tgts(struct workspace *wk, void *_ctx, FILE *compdb)
 {
 	struct write_build_ctx *ctx = _ctx;
-	struct check_tgt_ctx check_ctx = { 0 };
+	FILE *out = ctx->out;
+	bool wrote_default = false, ret = false;
+	uint32_t i, compdb_entries = 0;
 
-	uint32_t i;
-	for (i = 0; i < wk->projects.len; ++i) {
-		struct project *proj = arr_get(&wk->projects, i);
-		if (proj->not_ok) {
-			continue;
-		}
-
-		obj_array_foreach(wk, proj->targets, &check_ctx, check_tgt_iter);
-	}
-
-	if (!ninja_write_rules(out, wk, arr_get(&wk->projects, 0), check_ctx.need_phony, ctx->compiler_rule_arr)) {
-		return false;
-	}
+	struct hash args_vars;
+	hash_init(&args_vars, 64, 32);
 
-	bool wrote_default = false;
+	fputc('[', compdb);
 
 	for (i = 0; i < wk->projects.len; ++i) {
 		struct project *proj = arr_get(&wk->projects, i);
@@ -133,16 +130,25 @@ ninja_write_build(struct workspace *wk, void *_ctx, FILE *out)
 			continue;
 		}
 
-		struct write_tgt_ctx ctx = { .out = out, .proj = proj };
+		struct write_tgt_ctx ctx = {
+			.out = out,
+			.proj = proj,
+			.args_vars = &args_vars,
+			.compdb = compdb,
+			.compdb_entries = compdb_entries,
+		};
 
 		if (!obj_array_foreach(wk, proj->targets, &ctx, write_tgt_iter)) {
 			LOG_E("failed to write rules for project %s", get_cstr(wk, proj->cfg.name));
-			return false;
+			goto ret;
 		}
 
 		wrote_default |= ctx.wrote_default;
+		compdb_entries = ctx.compdb_entries;
 	}
 
+	fputs("\n]\n", compdb);
+
 	if (!wrote_default) {
 		fprintf(out,
 			"build muon_do_nothing: phony\n"
@@ -150,7 +156,34 @@ ninja_write_build(struct workspace *wk, void *_ctx, FILE *out)
 			);
 	}
 
-	return true;
+	ret = true;
+ret:
+	hash_destroy(&args_vars);
+	return ret;
+}
+
+static bool
+ninja_write_build(struct workspace *wk, void *_ctx, FILE *out)
+{
+	struct write_build_ctx *ctx = _ctx;
+	struct check_tgt_ctx check_ctx = { 0 };
+
+	uint32_t i;
+	for (i = 0; i < wk->projects.len; ++i) {
+		struct project *proj = arr_get(&wk->projects, i);
+		if (proj->not_ok) {
+			continue;
+		}
+
+		obj_array_foreach(wk, proj->targets, &check_ctx, check_tgt_iter);
+	}
+
+	if (!ninja_write_rules(out, wk, arr_get(&wk->projects, 0), check_ctx.need_phony, ctx->compiler_rule_arr)) {
+		return false;
+	}
+
+	ctx->out = out;
+	return with_open(wk->build_root, "compile_commands.json", wk, ctx, ninja_write_build_tgts);
 }
 
 static bool
@@ -242,34 +275,24 @@ ninja_write_all(struct workspace *wk)
 	struct write_build_ctx ctx = { 0 };
 	make_obj(wk, &ctx.compiler_rule_arr, obj_array);
 
-	if (!(with_open(wk->build_root, "build.ninja", wk, &ctx, ninja_write_build)
-	      && with_open(wk->muon_private, output_path.tests, wk, NULL, ninja_write_tests)
-	      && with_open(wk->muon_private, output_path.install, wk, NULL, ninja_write_install)
-	      && with_open(wk->muon_private, output_path.compiler_check_cache, wk, NULL, ninja_write_compiler_check_cache)
-	      && with_open(wk->muon_private, output_path.summary, wk, NULL, ninja_write_summary_file)
-	      && with_open(wk->muon_private, output_path.option_info, wk, NULL, ninja_write_option_info)
-	      )) {
-		return false;
-	}
-
-	{/* compile_commands.json */
-		TracyCZoneN(tctx_compdb, "output compile_commands.json", true);
-
-		obj compdb_args;
-		make_obj(wk, &compdb_args, obj_array);
-		obj_array_push(wk, compdb_args, make_str(wk, "-C"));
-		obj_array_push(wk, compdb_args, make_str(wk, wk->build_root));
-		obj_array_push(wk, compdb_args, make_str(wk, "-t"));
-		obj_array_push(wk, compdb_args, make_str(wk, "compdb"));
-		obj_array_extend_nodup(wk, compdb_args, ctx.compiler_rule_arr);
-		if (ninja_run(wk, compdb_args, wk->build_root, "compile_commands.json") != 0) {
-			LOG_E("error writing compile_commands.json");
-		}
+	return with_open(wk->build_root, "build.ninja", wk, &ctx, ninja_write_build)
+	       && with_open(wk->muon_private, output_path.tests, wk, NULL, ninja_write_tests)
+	       && with_open(wk->muon_private, output_path.install, wk, NULL, ninja_write_install)
+	       && with_open(wk->muon_private, output_path.compiler_check_cache, wk, NULL, ninja_write_compiler_check_cache)
+	       && with_open(wk->muon_private, output_path.summary, wk, NULL, ninja_write_summary_file)
+	       && with_open(wk->muon_private, output_path.option_info, wk, NULL, ninja_write_option_info);
+}
 
-		TracyCZoneEnd(tctx_compdb);
-	}
+struct ninja_run_samu_ctx {
+	uint32_t argc;
+	char *const *argv;
+};
 
-	return true;
+static bool
+ninja_run_samu(void *_ctx, uint32_t _)
+{
+	struct ninja_run_samu_ctx *ctx = _ctx;
+	return muon_samu(ctx->argc, ctx->argv);
 }
 
 int
@@ -278,12 +301,14 @@ ninja_run(struct workspace *wk, obj args, const char *chdir, const char *capture
 	// XXX since samu was designed to be an executable and not a library,
 	// lots of the resource management is left to the OS.  For instance,
 	// there are several important globals that are assumed to be
-	// zero-initialized.  Not to mention memory "leaks".  This is all fine
-	// since almost zero effort has been put in to making samu into a true
-	// libsamu, however it means that calling the internal samu more than
-	// once is riddled with UB.  Prevent that with this hacky static
-	// variable by  falling back to executing an external ninja-compatible
-	// tool if the internal samu has already been invoked.
+	// zero-initialized.  Not to mention memory "leaks".  Where the
+	// platform allows it, the internal samu is therefore run in a copy of
+	// this process which starts out with pristine samu globals and is
+	// thrown away afterwards, so it can be used any number of times
+	// without paying for an exec and a full muon startup.  Otherwise,
+	// calling the internal samu more than once is riddled with UB, so fall
+	// back to executing an external ninja-compatible tool if it has
+	// already been invoked.
 	static bool internal_samu_has_been_called = false;
 
 	const char *argstr;
@@ -311,22 +336,29 @@ ninja_run(struct workspace *wk, obj args, const char *chdir, const char *capture
 	}
 
 	if (have_samurai && !internal_samu_has_been_called && have_stdout_fileno) {
-		internal_samu_has_been_called = true;
-
 		join_args_argstr(wk, &argstr, &argstr_argc, args);
 		argc = argstr_to_argv(argstr, argstr_argc, "samu", &argv);
 
 		int old_stdout;
 
 		if (capture) {
+			fflush(stdout);
 			if (!fs_redirect(capture, "wb", stdout_fileno, &old_stdout)) {
 				goto ret;
 			}
 		}
 
-		bool res = muon_samu(argc, argv);
+		bool res;
+		struct ninja_run_samu_ctx samu_ctx = { .argc = argc, .argv = argv };
+		// only fall back to running samu in-process if no copy could be
+		// started, otherwise its result stands
+		if (!os_run_isolated(ninja_run_samu, &samu_ctx, 1, &res)) {
+			internal_samu_has_been_called = true;
+			res = ninja_run_samu(&samu_ctx, 0);
+		}
 
 		if (capture) {
+			fflush(stdout);
 			if (!fs_redirect_restore(stdout_fileno, old_stdout)) {
 				goto ret;
 			}
@@ -365,7 +397,9 @@ ninja_run(struct workspace *wk, obj args, const char *chdir, const char *capture
 		join_args_argstr(wk, &argstr, &argstr_argc, args);
 		argc = argstr_to_argv(argstr, argstr_argc, prepend, &argv);
 
-		if (!capture) {
+		if (capture) {
+			cmd_ctx.capture_max = RUN_CMD_CAPTURE_SPILL_SIZE;
+		} else {
 			cmd_ctx.flags |= run_cmd_ctx_flag_dont_capture;
 		}
 
@@ -375,7 +409,7 @@ ninja_run(struct workspace *wk, obj args, const char *chdir, const char *capture
 		}
 
 		if (capture) {
-			if (!fs_write(capture, (uint8_t *)cmd_ctx.out.buf, cmd_ctx.out.len)) {
+			if (!run_cmd_pipe_write(&cmd_ctx.out, capture)) {
 				goto run_cmd_done;
 			}
 		}
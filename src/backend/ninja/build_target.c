@@ -5,18 +5,22 @@
 
 #include "compat.h"
 
+#include <inttypes.h>
 #include <string.h>
 
 #include "args.h"
 #include "backend/common_args.h"
 #include "backend/ninja.h"
 #include "backend/ninja/build_target.h"
+#include "backend/ninja/rules.h"
 #include "error.h"
+#include "formats/json.h"
 #include "functions/build_target.h"
 #include "lang/workspace.h"
 #include "log.h"
 #include "platform/filesystem.h"
 #include "platform/path.h"
+#include "sha_256.h"
 
 struct write_tgt_iter_ctx {
 	FILE *out;
@@ -24,13 +28,144 @@ struct write_tgt_iter_ctx {
 	const struct project *proj;
 	struct build_dep args;
 	obj joined_args;
+	obj args_vars;
 	obj object_names;
 	obj order_deps;
 	obj implicit_deps;
 	bool have_order_deps;
 	bool have_link_language;
+	struct hash *global_args_vars;
+	struct write_tgt_ctx *wctx;
 };
 
+/*
+ * Expand the variables in a compiler rule's command the same way ninja would
+ * for a build statement.  Only $in and $out (which are shell escaped) are
+ * bound, since the arguments are always substituted into the command.
+ */
+static void
+ninja_eval_command(struct workspace *wk, struct sbuf *sb, const char *cmd, const char *in, const char *out)
+{
+	SBUF(esc_in);
+	SBUF(esc_out);
+	shell_escape(wk, &esc_in, in);
+	shell_escape(wk, &esc_out, out);
+
+	const char *p = cmd;
+	while (*p) {
+		if (*p != '$') {
+			sbuf_push(wk, sb, *p);
+			++p;
+			continue;
+		}
+
+		++p;
+		if (*p == '$' || *p == ' ' || *p == ':') {
+			sbuf_push(wk, sb, *p);
+			++p;
+			continue;
+		}
+
+		const char *name = p;
+		uint32_t len = 0;
+		if (*p == '{') {
+			name = ++p;
+			while (*p && *p != '}') {
+				++p;
+			}
+			len = p - name;
+			if (*p) {
+				++p;
+			}
+		} else {
+			while (('a' <= *p && *p <= 'z') || ('A' <= *p && *p <= 'Z')
+			       || ('0' <= *p && *p <= '9') || *p == '_' || *p == '-') {
+				++p;
+			}
+			len = p - name;
+		}
+
+		if (len == 2 && strncmp(name, "in", 2) == 0) {
+			sbuf_pushs(wk, sb, esc_in.buf);
+		} else if (len == 3 && strncmp(name, "out", 3) == 0) {
+			sbuf_pushs(wk, sb, esc_out.buf);
+		}
+	}
+}
+
+/*
+ * compile_commands.json is written alongside build.ninja from the same
+ * data, in the format of `ninja -t compdb`.
+ */
+static void
+write_compdb_entry(struct workspace *wk, struct write_tgt_iter_ctx *ctx, enum compiler_language lang,
+	const char *src_path, const char *dest_path)
+{
+	obj comp_id, args;
+	if (!obj_dict_geti(wk, ctx->proj->compilers, lang, &comp_id)) {
+		UNREACHABLE;
+	} else if (!obj_dict_geti(wk, ctx->joined_args, lang, &args)) {
+		UNREACHABLE;
+	}
+
+	SBUF(cmd);
+	ninja_eval_command(wk, &cmd, get_cstr(wk, ninja_compiler_command(wk, args, comp_id)), src_path, dest_path);
+
+	FILE *f = ctx->wctx->compdb;
+	fputs(ctx->wctx->compdb_entries ? ",\n" : "\n", f);
+	fputs("  {\n    \"directory\": ", f);
+	json_write_str(f, wk->build_root);
+	fputs(",\n    \"command\": ", f);
+	json_write_str(f, cmd.buf);
+	fputs(",\n    \"file\": ", f);
+	json_write_str(f, src_path);
+	fputs(",\n    \"output\": ", f);
+	json_write_str(f, dest_path);
+	fputs("\n  }", f);
+
+	++ctx->wctx->compdb_entries;
+}
+
+/*
+ * Sources of targets that don't have a specialized compiler rule get their
+ * arguments from the ARGS binding of each build statement.  Rather than
+ * repeating the full arguments for every source, each distinct argument
+ * string is written once as a top level variable which the ARGS bindings
+ * refer to.
+ */
+static obj
+write_tgt_args_var(struct workspace *wk, struct write_tgt_iter_ctx *ctx, enum compiler_language lang)
+{
+	obj var;
+	if (!ctx->args_vars) {
+		make_obj(wk, &ctx->args_vars, obj_dict);
+	} else if (obj_dict_geti(wk, ctx->args_vars, lang, &var)) {
+		return var;
+	}
+
+	obj args;
+	if (!obj_dict_geti(wk, ctx->joined_args, lang, &args)) {
+		UNREACHABLE;
+	}
+
+	const struct str *ss = get_str(wk, args);
+	uint8_t key[32];
+	calc_sha_256(key, ss->s, ss->len);
+
+	uint64_t *v, n;
+	if ((v = hash_get(ctx->global_args_vars, key))) {
+		n = *v;
+	} else {
+		n = ctx->global_args_vars->len;
+		hash_set(ctx->global_args_vars, key, n);
+		fprintf(ctx->out, "muon_args_%" PRIu64 " = %s\n", n, ss->s);
+	}
+
+	var = make_strf(wk, "$muon_args_%" PRIu64, n);
+	obj_dict_seti(wk, ctx->args_vars, lang, var);
+	return var;
+}
+
 static enum iteration_result
 add_tgt_objects_iter(struct workspace *wk, void *_ctx, obj val)
 {
@@ -77,13 +212,16 @@ write_tgt_sources_iter(struct workspace *wk, void *_ctx, obj val)
 		obj_array_index(wk, rule_name_arr, 0, &rule_name);
 		obj_array_index(wk, rule_name_arr, 1, &specialized_rule);
 
-		if (!specialized_rule) {
-			if (!ctx->joined_args && !build_target_args(wk, ctx->proj, ctx->tgt, &ctx->joined_args)) {
-				return ir_err;
-			}
+		if (!ctx->joined_args && !build_target_args(wk, ctx->proj, ctx->tgt, &ctx->joined_args)) {
+			return ir_err;
 		}
 	}
 
+	obj args_var = 0;
+	if (!specialized_rule) {
+		args_var = write_tgt_args_var(wk, ctx, lang);
+	}
+
 	SBUF(esc_dest_path);
 	SBUF(esc_path);
 
@@ -100,16 +238,11 @@ write_tgt_sources_iter(struct workspace *wk, void *_ctx, obj val)
 	}
 	fputc('\n', ctx->out);
 
-	if (!specialized_rule) {
-		obj args;
-		if (!obj_dict_geti(wk, ctx->joined_args, lang, &args)) {
-			UNREACHABLE;
-		}
-
-		fprintf(ctx->out,
-			" ARGS = %s\n", get_cstr(wk, args));
+	if (args_var) {
+		fprintf(ctx->out, " ARGS = %s\n", get_cstr(wk, args_var));
 	}
 
+	write_compdb_entry(wk, ctx, lang, src_path.buf, dest_path.buf);
 	return ir_cont;
 }
 
@@ -130,6 +263,8 @@ ninja_write_build_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *wc
 		.tgt = tgt,
 		.proj = wctx->proj,
 		.out = wctx->out,
+		.global_args_vars = wctx->args_vars,
+		.wctx = wctx,
 	};
 
 	enum linker_type linker;
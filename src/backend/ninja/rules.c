@@ -16,6 +16,7 @@
 #include "lang/workspace.h"
 #include "log.h"
 #include "platform/path.h"
+#include "sha_256.h"
 #include "tracy.h"
 
 struct write_compiler_rule_ctx {
@@ -23,6 +24,7 @@ struct write_compiler_rule_ctx {
 	struct project *proj;
 	struct obj_build_target *tgt;
 	obj args, generic_rules;
+	struct hash *specialized_rules;
 };
 
 static void
@@ -82,6 +84,27 @@ write_linker_rule_iter(struct workspace *wk, void *_ctx, enum compiler_language
 	return ir_cont;
 }
 
+obj
+ninja_compiler_command(struct workspace *wk, obj rule_args, obj comp_id)
+{
+	struct obj_compiler *comp = get_obj_compiler(wk, comp_id);
+	enum compiler_type t = comp->type;
+
+	obj args;
+	make_obj(wk, &args, obj_array);
+	obj_array_extend(wk, args, comp->cmd_arr);
+	obj_array_push(wk, args, rule_args);
+
+	if (compilers[t].deps) {
+		push_args(wk, args, compilers[t].args.deps("$out", "${out}.d"));
+	}
+	push_args(wk, args, compilers[t].args.output("$out"));
+	push_args(wk, args, compilers[t].args.compile_only());
+	obj_array_push(wk, args, make_str(wk, "$in"));
+
+	return join_args_plain(wk, args);
+}
+
 static void
 write_compiler_rule(struct workspace *wk, FILE *out, obj rule_args, obj rule_name, enum compiler_language l, obj comp_id)
 {
@@ -100,19 +123,7 @@ write_compiler_rule(struct workspace *wk, FILE *out, obj rule_args, obj rule_nam
 		break;
 	}
 
-	obj args;
-	make_obj(wk, &args, obj_array);
-	obj_array_extend(wk, args, comp->cmd_arr);
-	obj_array_push(wk, args, rule_args);
-
-	if (compilers[t].deps) {
-		push_args(wk, args, compilers[t].args.deps("$out", "${out}.d"));
-	}
-	push_args(wk, args, compilers[t].args.output("$out"));
-	push_args(wk, args, compilers[t].args.compile_only());
-	obj_array_push(wk, args, make_str(wk, "$in"));
-
-	obj compile_command = join_args_plain(wk, args);
+	obj compile_command = ninja_compiler_command(wk, rule_args, comp_id);
 
 	fprintf(out, "rule %s\n"
 		" command = %s\n",
@@ -134,9 +145,8 @@ write_compiler_rule_iter(struct workspace *wk, void *_ctx, enum compiler_languag
 {
 	struct write_compiler_rule_ctx *ctx = _ctx;
 
-	obj rule_name;
+	obj rule_name, rule_name_arr;
 	{
-		obj rule_name_arr;
 		if (!obj_dict_geti(wk, ctx->tgt->required_compilers, l, &rule_name_arr)) {
 			return ir_cont;
 		}
@@ -155,6 +165,30 @@ write_compiler_rule_iter(struct workspace *wk, void *_ctx, enum compiler_languag
 		UNREACHABLE;
 	}
 
+	/*
+	 * Targets which are compiled with exactly the same arguments share a
+	 * single specialized rule, so identical commands aren't repeated in
+	 * build.ninja.
+	 */
+	uint8_t key[32];
+	{
+		struct sha_256 sha;
+		sha_256_init(&sha);
+		sha_256_update(&sha, &l, sizeof(l));
+		sha_256_update(&sha, &comp_id, sizeof(comp_id));
+		const struct str *ss = get_str(wk, rule_args);
+		sha_256_update(&sha, ss->s, ss->len);
+		sha_256_final(&sha, key);
+	}
+
+	uint64_t *existing;
+	if ((existing = hash_get(ctx->specialized_rules, key))) {
+		obj_array_set(wk, rule_name_arr, 0, *existing);
+		return ir_cont;
+	}
+
+	hash_set(ctx->specialized_rules, key, rule_name);
+
 	write_compiler_rule(wk, ctx->out, rule_args, rule_name, l, comp_id);
 	return ir_cont;
 }
@@ -321,8 +355,10 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj,
 		"rule REGENERATE_BUILD\n"
 		" command = %s", get_cstr(wk, regen_cmd));
 
+	// build.ninja is only replaced if it changed, see with_open
 	fputs("\n description = Regenerating build files.\n"
 		" generator = 1\n"
+		" restat = 1\n"
 		"\n", out);
 
 	obj regenerate_deps_rel;
@@ -342,6 +378,9 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj,
 		fprintf(out, "build build_always_stale: phony\n\n");
 	}
 
+	struct hash specialized_rules;
+	hash_init(&specialized_rules, 64, 32);
+
 	obj rule_prefix_arr;
 	make_obj(wk, &rule_prefix_arr, obj_array);
 	uint32_t i;
@@ -385,6 +424,7 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj,
 				.out = out,
 				.proj = proj,
 				.generic_rules = generic_rules,
+				.specialized_rules = &specialized_rules,
 			};
 
 			struct obj_clear_mark mk;
@@ -412,6 +452,7 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj,
 
 	res = true;
 ret:
+	hash_destroy(&specialized_rules);
 	TracyCZoneAutoE;
 	return res;
 }
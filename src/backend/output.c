@@ -10,6 +10,7 @@
 #include "backend/output.h"
 #include "platform/filesystem.h"
 #include "platform/path.h"
+#include "profile.h"
 #include "tracy.h"
 
 const struct output_path output_path = {
@@ -19,19 +20,16 @@ const struct output_path output_path = {
 	.install = "install.dat",
 	.compiler_check_cache = "compiler_check_cache.dat",
 	.option_info = "option_info.dat",
+	.test_history = "test_history.dat",
+	.python_introspection = "python_introspection.dat",
 };
 
-FILE *
-output_open(const char *dir, const char *name)
-{
-	SBUF_manual(path);
-	path_join(NULL, &path, dir, name);
-
-	FILE *f = fs_fopen(path.buf, "wb");
-	sbuf_destroy(&path);
-	return f;
-}
-
+/*
+ * Outputs are written to a temporary file which only replaces the existing
+ * file if their contents differ.  This keeps the mtime of unchanged outputs
+ * intact, so that ninja and tools watching them (e.g. clangd for
+ * compile_commands.json) don't treat them as modified.
+ */
 bool
 with_open(const char *dir, const char *name, struct workspace *wk,
 	void *ctx, with_open_callback cb)
@@ -42,19 +40,38 @@ with_open(const char *dir, const char *name, struct workspace *wk,
 	snprintf(buf, 4096, "with_open('%s')", name);
 	TracyCZoneName(tctx_func, buf, strlen(buf));
 #endif
+	profile_begin("backend", name);
 
 	bool ret = false;
+	SBUF_manual(path);
+	SBUF_manual(tmp);
+	path_join(NULL, &path, dir, name);
+	sbuf_pushf(NULL, &tmp, "%s.tmp", path.buf);
+
 	FILE *out;
-	if (!(out = output_open(dir, name))) {
+	if (!(out = fs_fopen(tmp.buf, "wb"))) {
 		goto ret;
 	} else if (!cb(wk, ctx, out)) {
+		fs_fclose(out);
 		goto ret;
 	} else if (!fs_fclose(out)) {
 		goto ret;
 	}
 
-	ret = true;
+	if (fs_same_contents(path.buf, tmp.buf)) {
+		ret = fs_remove(tmp.buf);
+	} else {
+		ret = fs_rename(tmp.buf, path.buf);
+	}
+
 ret:
+	if (!ret && fs_file_exists(tmp.buf)) {
+		fs_remove(tmp.buf);
+	}
+
+	sbuf_destroy(&tmp);
+	sbuf_destroy(&path);
+	profile_end();
 	TracyCZoneEnd(tctx_func);
 	return ret;
 }
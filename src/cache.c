@@ -0,0 +1,345 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "datastructures/arr.h"
+#include "lang/serial.h"
+#include "log.h"
+#include "platform/filesystem.h"
+#include "platform/os.h"
+#include "platform/path.h"
+
+bool
+cache_dir(struct workspace *wk, struct sbuf *res)
+{
+	const char *dir;
+
+	if ((dir = getenv("MUON_CACHE_DIR")) && *dir) {
+		path_make_absolute(wk, res, dir);
+	} else if ((dir = getenv("XDG_CACHE_HOME")) && *dir) {
+		path_make_absolute(wk, res, dir);
+		path_push(wk, res, "muon");
+	} else if ((dir = fs_user_home())) {
+		path_make_absolute(wk, res, dir);
+		path_push(wk, res, ".cache/muon");
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Entries live in <cache dir>/<ns>/v<serial version>/<key[0]>/<key[1..]> so
+ * that a change to the serialization format invalidates the whole cache.
+ */
+static bool
+cache_ns_dir(struct workspace *wk, const char *ns, struct sbuf *res)
+{
+	if (!cache_dir(wk, res)) {
+		return false;
+	}
+
+	path_push(wk, res, ns);
+	sbuf_pushf(wk, res, "/v%d", serial_format_version());
+	return true;
+}
+
+static bool
+cache_entry_path(struct workspace *wk, const char *ns, const uint8_t key[32], struct sbuf *res)
+{
+	if (!cache_ns_dir(wk, ns, res)) {
+		return false;
+	}
+
+	uint32_t i;
+	sbuf_pushf(wk, res, "/%02x/", key[0]);
+	for (i = 1; i < 32; ++i) {
+		sbuf_pushf(wk, res, "%02x", key[i]);
+	}
+
+	return true;
+}
+
+bool
+cache_get(struct workspace *wk, const char *ns, const uint8_t key[32], obj *res)
+{
+	SBUF(path);
+	if (!cache_entry_path(wk, ns, key, &path)) {
+		return false;
+	} else if (!fs_file_exists(path.buf)) {
+		return false;
+	}
+
+	FILE *f;
+	if (!(f = fs_fopen(path.buf, "rb"))) {
+		return false;
+	}
+
+	bool ret = serial_load(wk, res, f);
+
+	if (!fs_fclose(f)) {
+		ret = false;
+	}
+
+	if (!ret) {
+		LOG_W("ignoring invalid cache entry %s", path.buf);
+	} else {
+		// eviction removes the entries with the oldest mtime first, so
+		// a hit has to refresh it.  Failing to do so, e.g. in a read-only
+		// cache dir, only makes the entry look older than it is.
+		fs_touch(path.buf);
+	}
+
+	return ret;
+}
+
+/*
+ * Entries are written to a temporary file which is then renamed into place,
+ * so concurrent readers and writers only ever see complete entries.
+ */
+bool
+cache_set(struct workspace *wk, const char *ns, const uint8_t key[32], obj val)
+{
+	SBUF(path);
+	SBUF(dir);
+	SBUF(tmp);
+
+	if (!cache_entry_path(wk, ns, key, &path)) {
+		return false;
+	}
+
+	path_dirname(wk, &dir, path.buf);
+	if (!fs_mkdir_p(dir.buf)) {
+		return false;
+	}
+
+	sbuf_pushf(wk, &tmp, "%s.%d.tmp", path.buf, os_getpid());
+
+	FILE *f;
+	if (!(f = fs_fopen(tmp.buf, "wb"))) {
+		return false;
+	}
+
+	bool ret = serial_dump(wk, val, f);
+
+	if (!fs_fclose(f)) {
+		ret = false;
+	}
+
+	if (ret) {
+		ret = fs_rename(tmp.buf, path.buf);
+	}
+
+	if (!ret && fs_file_exists(tmp.buf)) {
+		fs_remove(tmp.buf);
+	}
+
+	return ret;
+}
+
+struct cache_remove_ctx {
+	struct workspace *wk;
+	const char *dir;
+};
+
+static bool cache_remove_dir(struct workspace *wk, const char *dir);
+
+static enum iteration_result
+cache_remove_dir_iter(void *_ctx, const char *name)
+{
+	struct cache_remove_ctx *ctx = _ctx;
+	SBUF(path);
+	path_join(ctx->wk, &path, ctx->dir, name);
+
+	bool ok;
+	if (!fs_symlink_exists(path.buf) && fs_dir_exists(path.buf)) {
+		ok = cache_remove_dir(ctx->wk, path.buf);
+	} else {
+		// another process may be removing the same dir
+		ok = !fs_exists(path.buf) || fs_remove(path.buf);
+	}
+
+	return ok ? ir_cont : ir_err;
+}
+
+static bool
+cache_remove_dir(struct workspace *wk, const char *dir)
+{
+	struct cache_remove_ctx ctx = { .wk = wk, .dir = dir };
+	return fs_dir_foreach(dir, &ctx, cache_remove_dir_iter) && (!fs_dir_exists(dir) || fs_rmdir(dir));
+}
+
+struct cache_stale_versions_ctx {
+	struct workspace *wk;
+	const char *dir, *current;
+};
+
+static enum iteration_result
+cache_remove_stale_versions_iter(void *_ctx, const char *name)
+{
+	struct cache_stale_versions_ctx *ctx = _ctx;
+
+	if (name[0] != 'v' || !name[1] || strspn(&name[1], "0123456789") != strlen(&name[1])
+	    || strcmp(name, ctx->current) == 0) {
+		return ir_cont;
+	}
+
+	SBUF(path);
+	path_join(ctx->wk, &path, ctx->dir, name);
+
+	if (fs_symlink_exists(path.buf) || !fs_dir_exists(path.buf)) {
+		return ir_cont;
+	}
+
+	L("removing cache dir %s left by another version of muon", path.buf);
+	if (!cache_remove_dir(ctx->wk, path.buf)) {
+		LOG_W("failed to remove cache dir %s", path.buf);
+	}
+
+	return ir_cont;
+}
+
+/*
+ * Entries written with another serialization format can never be read again,
+ * so the dirs of other versions are removed entirely.
+ */
+static bool
+cache_remove_stale_versions(struct workspace *wk, const char *ns_version_dir)
+{
+	SBUF(dir);
+	SBUF(current);
+	path_dirname(wk, &dir, ns_version_dir);
+	path_basename(wk, &current, ns_version_dir);
+
+	struct cache_stale_versions_ctx ctx = { .wk = wk, .dir = dir.buf, .current = current.buf };
+	return fs_dir_foreach(dir.buf, &ctx, cache_remove_stale_versions_iter);
+}
+
+struct cache_evict_entry {
+	obj path;
+	int64_t mtime;
+	uint64_t size;
+};
+
+struct cache_evict_ctx {
+	struct workspace *wk;
+	struct arr entries;
+	uint64_t total;
+	const char *dir;
+};
+
+static enum iteration_result
+cache_evict_file_iter(void *_ctx, const char *name)
+{
+	struct cache_evict_ctx *ctx = _ctx;
+	SBUF(path);
+	path_join(ctx->wk, &path, ctx->dir, name);
+
+	// may have been removed by a concurrent process
+	struct stat sb;
+	if (!fs_file_exists(path.buf) || !fs_stat(path.buf, &sb)) {
+		return ir_cont;
+	}
+
+	arr_push(&ctx->entries, &(struct cache_evict_entry) {
+		.path = sbuf_into_str(ctx->wk, &path),
+		.mtime = fs_stat_mtime_ns(&sb),
+		.size = sb.st_size,
+	});
+
+	ctx->total += sb.st_size;
+	return ir_cont;
+}
+
+static enum iteration_result
+cache_evict_dir_iter(void *_ctx, const char *name)
+{
+	struct cache_evict_ctx *ctx = _ctx;
+	SBUF(path);
+	path_join(ctx->wk, &path, ctx->dir, name);
+
+	if (!fs_dir_exists(path.buf)) {
+		return ir_cont;
+	}
+
+	const char *ns_dir = ctx->dir;
+	ctx->dir = path.buf;
+	bool ok = fs_dir_foreach(path.buf, ctx, cache_evict_file_iter);
+	ctx->dir = ns_dir;
+
+	return ok ? ir_cont : ir_err;
+}
+
+static int32_t
+cache_evict_entry_cmp(const void *_a, const void *_b, void *_ctx)
+{
+	const struct cache_evict_entry *a = _a, *b = _b;
+
+	if (a->mtime < b->mtime) {
+		return -1;
+	} else if (a->mtime > b->mtime) {
+		return 1;
+	} else {
+		return 0;
+	}
+}
+
+/*
+ * If the entries in a namespace take up more than max_size bytes, remove the
+ * least recently used ones until they fit in 3/4 of it, so that eviction
+ * doesn't run every time a cache is written.  Entries of other serialization
+ * format versions are removed as well.
+ */
+bool
+cache_evict(struct workspace *wk, const char *ns, uint64_t max_size)
+{
+	SBUF(dir);
+	if (!cache_ns_dir(wk, ns, &dir)) {
+		return false;
+	} else if (!fs_dir_exists(dir.buf)) {
+		return true;
+	} else if (!cache_remove_stale_versions(wk, dir.buf)) {
+		return false;
+	}
+
+	bool ret = false;
+	struct cache_evict_ctx ctx = { .wk = wk, .dir = dir.buf };
+	arr_init(&ctx.entries, 64, sizeof(struct cache_evict_entry));
+
+	if (!fs_dir_foreach(dir.buf, &ctx, cache_evict_dir_iter)) {
+		goto ret;
+	}
+
+	if (ctx.total > max_size) {
+		arr_sort(&ctx.entries, NULL, cache_evict_entry_cmp);
+
+		uint32_t i;
+		for (i = 0; i < ctx.entries.len && ctx.total > max_size / 4 * 3; ++i) {
+			struct cache_evict_entry *e = arr_get(&ctx.entries, i);
+			const char *path = get_cstr(wk, e->path);
+
+			// another process may have evicted it already
+			if (fs_file_exists(path) && !fs_remove(path)) {
+				goto ret;
+			}
+
+			ctx.total -= e->size;
+		}
+
+		L("evicted %d entries from cache %s", i, dir.buf);
+	}
+
+	ret = true;
+ret:
+	arr_destroy(&ctx.entries);
+	return ret;
+}
@@ -0,0 +1,310 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "cmd_fmt.h"
+#include "formats/editorconfig.h"
+#include "lang/fmt.h"
+#include "log.h"
+#include "platform/filesystem.h"
+#include "platform/mem.h"
+#include "platform/path.h"
+#include "platform/run_cmd.h"
+#include "sha_256.h"
+#include "version.h"
+
+#define FMT_CACHE_NS "fmt"
+
+struct fmt_run_ctx {
+	struct workspace wk;
+	struct fmt_options *opts;
+	struct fmt_opts fmt_opts;
+	uint32_t cached, stored;
+};
+
+/*
+ * Files that are known to be formatted are remembered in the shared cache,
+ * keyed by their path, modification time, and size, along with everything
+ * else that affects the output: the muon version and the effective options.
+ */
+static bool
+fmt_cache_key(struct fmt_run_ctx *ctx, const char *path, const struct fmt_opts *opts, uint8_t key[32])
+{
+	struct stat sb;
+	if (!fs_stat(path, &sb)) {
+		return false;
+	}
+
+	SBUF(buf);
+	path_make_absolute(&ctx->wk, &buf, path);
+	sbuf_pushf(&ctx->wk, &buf, "\n%" PRId64 "\n%" PRIu64 "\n%s%s\n%d %d %d %d %d '%s'",
+		fs_stat_mtime_ns(&sb),
+		(uint64_t)sb.st_size,
+		muon_version.version,
+		muon_version.vcs_tag,
+		opts->max_line_len,
+		opts->space_array,
+		opts->kwa_ml,
+		opts->wide_colon,
+		opts->no_single_comma_function,
+		opts->indent_by);
+
+	calc_sha_256(key, buf.buf, buf.len);
+	return true;
+}
+
+static bool
+fmt_cache_hit(struct fmt_run_ctx *ctx, const uint8_t key[32])
+{
+	obj res;
+	return cache_get(&ctx->wk, FMT_CACHE_NS, key, &res)
+	       && get_obj_type(&ctx->wk, res) == obj_bool
+	       && get_obj_bool(&ctx->wk, res);
+}
+
+static void
+fmt_cache_store(struct fmt_run_ctx *ctx, const uint8_t key[32])
+{
+	obj res;
+	make_obj(&ctx->wk, &res, obj_bool);
+	set_obj_bool(&ctx->wk, res, true);
+
+	if (!cache_set(&ctx->wk, FMT_CACHE_NS, key, res)) {
+		LOG_W("failed to write fmt cache entry");
+	} else {
+		++ctx->stored;
+	}
+}
+
+/*
+ * Sets file_opts to the options for path and returns true if key was set.
+ */
+static bool
+fmt_file_opts(struct fmt_run_ctx *ctx, const char *path, struct fmt_opts *file_opts, uint8_t key[32])
+{
+	struct source src = { .label = path };
+
+	*file_opts = ctx->fmt_opts;
+	if (ctx->opts->editorconfig) {
+		fmt_opts_for_file(&ctx->fmt_opts, &src, file_opts);
+	}
+
+	return ctx->opts->cache && fs_file_exists(path) && fmt_cache_key(ctx, path, file_opts, key);
+}
+
+static bool
+fmt_file_cached(struct fmt_run_ctx *ctx, const char *path)
+{
+	struct fmt_opts file_opts;
+	uint8_t key[32];
+	return fmt_file_opts(ctx, path, &file_opts, key) && fmt_cache_hit(ctx, key);
+}
+
+static bool
+fmt_file(struct fmt_run_ctx *ctx, const char *path)
+{
+	bool ret = false, opened_out = false;
+	struct fmt_options *opts = ctx->opts;
+	struct source src = { .label = path };
+	FILE *out;
+
+	struct fmt_opts file_opts;
+	uint8_t key[32];
+	bool use_cache = fmt_file_opts(ctx, path, &file_opts, key);
+	if (use_cache && fmt_cache_hit(ctx, key)) {
+		++ctx->cached;
+		return true;
+	}
+
+	if (!fs_read_entire_file(path, &src)) {
+		return false;
+	}
+
+	if (opts->in_place) {
+		if (!(out = fs_fopen(path, "wb"))) {
+			goto ret;
+		}
+		opened_out = true;
+	} else if (opts->check_only) {
+		out = NULL;
+	} else {
+		out = stdout;
+	}
+
+	ret = fmt(&src, out, &file_opts, opts->check_only);
+
+	if (opened_out) {
+		fs_fclose(out);
+
+		if (!ret) {
+			fs_write(path, (const uint8_t *)src.src, src.len);
+		} else if (use_cache) {
+			// the file was rewritten, so its key has changed
+			use_cache = fmt_cache_key(ctx, path, &file_opts, key);
+		}
+	}
+
+	if (ret && use_cache) {
+		fmt_cache_store(ctx, key);
+	}
+ret:
+	fs_source_destroy(&src);
+	return ret;
+}
+
+/*
+ * Split the files into one contiguous chunk per job, so that files from the
+ * same directories end up in the same process, and format each chunk in a
+ * separate muon process.
+ */
+struct fmt_run_jobs_ctx {
+	struct fmt_options *opts;
+	const char *argv0;
+	char *const *filenames;
+	uint32_t filenames_len, jobs;
+	const char **argv;
+};
+
+static const char *const *
+fmt_run_jobs_argv(void *_ctx, uint32_t i)
+{
+	struct fmt_run_jobs_ctx *ctx = _ctx;
+	struct fmt_options *opts = ctx->opts;
+	uint32_t j, start = (uint64_t)ctx->filenames_len * i / ctx->jobs,
+		    end = (uint64_t)ctx->filenames_len * (i + 1) / ctx->jobs;
+
+	const char **argv = ctx->argv;
+	uint32_t argc = 0;
+	argv[argc++] = ctx->argv0;
+	argv[argc++] = "fmt";
+	argv[argc++] = "-j";
+	argv[argc++] = "1";
+	argv[argc++] = opts->in_place ? "-i" : "-q";
+	if (opts->cfg_path) {
+		argv[argc++] = "-c";
+		argv[argc++] = opts->cfg_path;
+	}
+	if (opts->editorconfig) {
+		argv[argc++] = "-e";
+	}
+	if (opts->cache) {
+		argv[argc++] = "-K";
+	}
+	argv[argc++] = "--";
+	for (j = start; j < end; ++j) {
+		argv[argc++] = ctx->filenames[j];
+	}
+	argv[argc] = NULL;
+
+	return argv;
+}
+
+static void
+fmt_run_jobs_done(void *_ctx, uint32_t i, const struct run_cmd_ctx *cmd_ctx, bool ok)
+{
+	struct fmt_run_jobs_ctx *ctx = _ctx;
+
+	if (cmd_ctx->err_msg) {
+		LOG_E("failed to run %s: %s", ctx->argv0, cmd_ctx->err_msg);
+	}
+}
+
+static bool
+fmt_run_jobs(struct fmt_run_ctx *ctx, const char *argv0, char *const *filenames, uint32_t filenames_len)
+{
+	struct fmt_run_jobs_ctx jobs_ctx = {
+		.opts = ctx->opts,
+		.argv0 = argv0,
+		.filenames = filenames,
+		.filenames_len = filenames_len,
+		.jobs = ctx->opts->jobs < filenames_len ? ctx->opts->jobs : filenames_len,
+		.argv = z_calloc(filenames_len + 16, sizeof(const char *)),
+	};
+
+	bool ret = run_cmd_jobs(jobs_ctx.jobs, jobs_ctx.jobs, &jobs_ctx, fmt_run_jobs_argv, fmt_run_jobs_done);
+
+	z_free((void *)jobs_ctx.argv);
+	return ret;
+}
+
+bool
+fmt_run(struct fmt_options *opts, const char *argv0)
+{
+	bool ret = true;
+	struct fmt_run_ctx ctx = { .opts = opts };
+
+	workspace_init_bare(&ctx.wk);
+	fmt_opts_init(&ctx.fmt_opts);
+
+	if (!opts->jobs) {
+		opts->jobs = 4;
+	}
+
+	if (opts->cfg_path && !fmt_opts_load(&ctx.fmt_opts, opts->cfg_path)) {
+		ret = false;
+		goto ret;
+	}
+
+	char *const *filenames = opts->filenames;
+	uint32_t i, filenames_len = opts->filenames_len;
+
+	// output written to stdout has to stay in order
+	bool parallel = opts->jobs > 1 && opts->filenames_len > 1 && (opts->in_place || opts->check_only);
+
+	/*
+	 * Cached files are skipped before splitting the files into jobs, so
+	 * that they are counted once here and don't cost a process.
+	 */
+	if (parallel && opts->cache) {
+		char **uncached = z_calloc(opts->filenames_len, sizeof(char *));
+		filenames_len = 0;
+		for (i = 0; i < opts->filenames_len; ++i) {
+			if (fmt_file_cached(&ctx, opts->filenames[i])) {
+				++ctx.cached;
+			} else {
+				uncached[filenames_len++] = opts->filenames[i];
+			}
+		}
+		filenames = uncached;
+	}
+
+	bool run_jobs = parallel && filenames_len > 1;
+	if (run_jobs) {
+		ret = fmt_run_jobs(&ctx, argv0, filenames, filenames_len);
+	} else {
+		for (i = 0; i < filenames_len; ++i) {
+			ret &= fmt_file(&ctx, filenames[i]);
+		}
+	}
+
+	if (filenames != opts->filenames) {
+		z_free((void *)filenames);
+	}
+
+	if (ctx.cached) {
+		L("%d files unchanged since they were last formatted", ctx.cached);
+	}
+
+	// The cache can only have grown if something was stored, which jobs
+	// may have done without the parent knowing.  Jobs leave evicting to
+	// the parent, so that it only happens once.
+	if (opts->cache && !opts->no_evict && (ctx.stored || run_jobs)) {
+		if (!cache_evict(&ctx.wk, FMT_CACHE_NS, CACHE_DEFAULT_MAX_SIZE)) {
+			LOG_W("failed to evict old entries from the fmt cache");
+		}
+	}
+
+ret:
+	editorconfig_cache_destroy();
+	fmt_opts_destroy(&ctx.fmt_opts);
+	workspace_destroy_bare(&ctx.wk);
+	return ret;
+}
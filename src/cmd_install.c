@@ -13,15 +13,29 @@
 #include "backend/output.h"
 #include "buf_size.h"
 #include "cmd_install.h"
+#include "datastructures/arr.h"
 #include "functions/environment.h"
 #include "lang/serial.h"
 #include "log.h"
 #include "platform/filesystem.h"
+#include "platform/os.h"
 #include "platform/path.h"
 #include "platform/rpath_fixer.h"
 #include "platform/run_cmd.h"
 
+/*
+ * Files are not copied as soon as they are encountered.  They are collected
+ * into a list of copies instead, which is then split between several
+ * processes.
+ */
+struct install_copy {
+	obj src, dest;
+	uint32_t perm;
+	bool has_perm, fix_rpaths;
+};
+
 struct copy_subdir_ctx {
+	struct arr *copies;
 	obj exclude_directories;
 	obj exclude_files;
 	bool has_perm;
@@ -61,6 +75,7 @@ copy_subdir_iter(void *_ctx, const char *path)
 		}
 
 		struct copy_subdir_ctx new_ctx = {
+			.copies = ctx->copies,
 			.exclude_directories = ctx->exclude_directories,
 			.exclude_files = ctx->exclude_files,
 			.has_perm = ctx->has_perm,
@@ -83,9 +98,13 @@ copy_subdir_iter(void *_ctx, const char *path)
 
 		LOG_I("install '%s' -> '%s'", src.buf, dest.buf);
 
-		if (!fs_copy_file(src.buf, dest.buf)) {
-			return ir_err;
-		}
+		arr_push(ctx->copies, &(struct install_copy) {
+			.src = sbuf_into_str(ctx->wk, &src),
+			.dest = sbuf_into_str(ctx->wk, &dest),
+			.has_perm = ctx->has_perm,
+			.perm = ctx->perm,
+		});
+		return ir_cont;
 	} else {
 		LOG_E("unhandled file type '%s'", path);
 		return ir_err;
@@ -100,6 +119,9 @@ copy_subdir_iter(void *_ctx, const char *path)
 
 struct install_ctx {
 	struct install_options *opts;
+	struct workspace *wk;
+	struct arr copies;
+	uint32_t jobs;
 	obj prefix;
 	obj full_prefix;
 	obj destdir;
@@ -144,6 +166,12 @@ install_iter(struct workspace *wk, void *_ctx, obj v_id)
 		return ir_cont;
 	}
 
+	// e.g. the output of a target that isn't built by default
+	if (in->type == install_target_default && !fs_exists(src)) {
+		LOG_W("skipping '%s', it does not exist", src);
+		return ir_cont;
+	}
+
 	switch (in->type) {
 	case install_target_default:
 	case install_target_symlink:
@@ -164,9 +192,14 @@ install_iter(struct workspace *wk, void *_ctx, obj v_id)
 					return ir_err;
 				}
 			} else {
-				if (!fs_copy_file(src, dest)) {
-					return ir_err;
-				}
+				arr_push(&ctx->copies, &(struct install_copy) {
+					.src = in->src,
+					.dest = make_str(wk, dest),
+					.has_perm = in->has_perm,
+					.perm = in->perm,
+					.fix_rpaths = in->build_target,
+				});
+				return ir_cont;
 			}
 
 			if (in->build_target) {
@@ -185,7 +218,8 @@ install_iter(struct workspace *wk, void *_ctx, obj v_id)
 			return ir_err;
 		}
 
-		struct copy_subdir_ctx ctx = {
+		struct copy_subdir_ctx subdir_ctx = {
+			.copies = &ctx->copies,
 			.exclude_directories = in->exclude_directories,
 			.exclude_files = in->exclude_files,
 			.has_perm = in->has_perm,
@@ -196,7 +230,9 @@ install_iter(struct workspace *wk, void *_ctx, obj v_id)
 			.wk = wk,
 		};
 
-		if (!fs_dir_foreach(src, &ctx, copy_subdir_iter)) {
+		// a subdir that doesn't exist in the source tree is installed
+		// as an empty dir
+		if (fs_dir_exists(src) && !fs_dir_foreach(src, &subdir_ctx, copy_subdir_iter)) {
 			return ir_err;
 		}
 		break;
@@ -216,6 +252,61 @@ install_iter(struct workspace *wk, void *_ctx, obj v_id)
 	return ir_cont;
 }
 
+static bool
+install_copy_fix_rpaths(void *_ctx, const char *path)
+{
+	struct install_ctx *ctx = _ctx;
+	return fix_rpaths(path, ctx->wk->build_root);
+}
+
+static bool
+install_copy(struct install_ctx *ctx, const struct install_copy *c)
+{
+	const char *src = get_cstr(ctx->wk, c->src), *dest = get_cstr(ctx->wk, c->dest);
+	bool copied;
+	if (!fs_copy_file_if_changed(src, dest, c->fix_rpaths ? install_copy_fix_rpaths : NULL, ctx, &copied)) {
+		return false;
+	}
+
+	if (c->has_perm && !fs_chmod(dest, c->perm)) {
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+install_copies_job(void *_ctx, uint32_t job)
+{
+	struct install_ctx *ctx = _ctx;
+	bool ret = true;
+
+	uint32_t i;
+	for (i = job; i < ctx->copies.len; i += ctx->jobs) {
+		if (!install_copy(ctx, arr_get(&ctx->copies, i))) {
+			ret = false;
+		}
+	}
+
+	return ret;
+}
+
+static bool
+install_copies(struct install_ctx *ctx)
+{
+	bool res;
+
+	ctx->jobs = ctx->opts->jobs < ctx->copies.len ? ctx->opts->jobs : ctx->copies.len;
+	if (ctx->jobs > 1 && os_run_isolated(install_copies_job, ctx, ctx->jobs, &res)) {
+		return res;
+	}
+
+	// copies are skipped once they are done, so redoing the ones already
+	// completed by an unsuccessful os_run_isolated is cheap
+	ctx->jobs = 1;
+	return install_copies_job(ctx, 0);
+}
+
 static enum iteration_result
 install_scripts_iter(struct workspace *wk, void *_ctx, obj install_script)
 {
@@ -273,7 +364,7 @@ err:
 bool
 install_run(struct install_options *opts)
 {
-	bool ret = true;
+	bool ret = false;
 	SBUF_manual(install_src);
 	path_join(NULL, &install_src, output_path.private_dir, output_path.install);
 
@@ -298,6 +389,7 @@ install_run(struct install_options *opts)
 
 	struct install_ctx ctx = {
 		.opts = opts,
+		.wk = &wk,
 	};
 
 	obj install_targets, install_scripts, source_root;
@@ -323,10 +415,16 @@ install_run(struct install_options *opts)
 		ctx.full_prefix = ctx.prefix;
 	}
 
-	obj_array_foreach(&wk, install_targets, &ctx, install_iter);
-	obj_array_foreach(&wk, install_scripts, &ctx, install_scripts_iter);
+	arr_init(&ctx.copies, 1024, sizeof(struct install_copy));
+	ret = obj_array_foreach(&wk, install_targets, &ctx, install_iter)
+	      && install_copies(&ctx);
+	arr_destroy(&ctx.copies);
+
+	if (!ret) {
+		goto ret;
+	}
 
-	ret = true;
+	obj_array_foreach(&wk, install_scripts, &ctx, install_scripts_iter);
 ret:
 	workspace_destroy_bare(&wk);
 	return ret;
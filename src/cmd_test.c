@@ -5,6 +5,7 @@
 
 #include "compat.h"
 
+#include <inttypes.h>
 #include <string.h>
 
 #include "args.h"
@@ -23,8 +24,6 @@
 #include "platform/term.h"
 #include "platform/timer.h"
 
-#define SLEEP_TIME 10000000 // 10ms
-
 enum test_result_status {
 	test_result_status_running,
 	test_result_status_ok,
@@ -42,8 +41,13 @@ struct test_result {
 	bool busy;
 	struct {
 		bool have;
-		uint32_t pass, total;
+		uint32_t pass, fail, total;
 	} subtests;
+	struct tap_parser tap;
+	// how much of cmd_ctx.out has been fed to tap
+	size_t out_parsed;
+	// how much output was discarded to stay within the output limit
+	uint64_t out_dropped, err_dropped;
 };
 
 struct run_test_ctx {
@@ -51,11 +55,16 @@ struct run_test_ctx {
 	obj proj_name;
 	obj collected_tests;
 	obj deps;
+	// dict of "project:test" -> [duration in ms, failed] from previous runs
+	obj history;
+	// int-keyed dict of test -> its history entry, used while sorting
+	obj test_history;
 	uint32_t proj_i;
 	struct {
 		uint32_t test_i, test_len, error_count;
 		uint32_t total_count, total_error_count, total_expect_fail_count;
 		uint32_t total_skipped;
+		uint32_t subtests_pass, subtests_fail;
 		uint32_t term_width;
 		bool term;
 		bool ran_tests;
@@ -71,6 +80,7 @@ struct run_test_ctx {
 	struct arr test_results;
 
 	struct test_result *jobs;
+	struct run_cmd_ctx **busy_cmd_ctxs;
 	uint32_t busy_jobs;
 	bool serial;
 };
@@ -251,14 +261,22 @@ print_test_progress(struct workspace *wk, struct run_test_ctx *ctx, const struct
 		return;
 	}
 
-	uint32_t i, pad = 2;
+	uint32_t i, pad = 2, info_len;
 
 	char info[BUF_SIZE_4k];
-	pad += snprintf(info, BUF_SIZE_4k, "%d/%d f:%d s:%d j:%d ",
+	info_len = snprintf(info, BUF_SIZE_4k, "%d/%d f:%d s:%d j:%d ",
 		ctx->stats.test_i, ctx->stats.test_len,
 		ctx->stats.error_count, ctx->stats.total_skipped,
 		ctx->busy_jobs);
 
+	if (ctx->stats.subtests_pass || ctx->stats.subtests_fail) {
+		info_len += snprintf(&info[info_len], BUF_SIZE_4k - info_len, "t:%d/%d ",
+			ctx->stats.subtests_pass,
+			ctx->stats.subtests_pass + ctx->stats.subtests_fail);
+	}
+
+	pad += info_len;
+
 	log_plain("%s[", info);
 	uint32_t pct = (float)(ctx->stats.test_i) * (float)(ctx->stats.term_width - pad) / (float)ctx->stats.test_len;
 	for (i = 0; i < ctx->stats.term_width - pad; ++i) {
@@ -492,14 +510,68 @@ ret:
  * Test runner
  */
 
+/*
+ * Feed new output of a running test to its TAP parser, updating the subtest
+ * counts as they come in, and discard old output beyond the output limit.
+ * Only the tail of the output is kept so that failing tests still show how
+ * they ended.
+ */
+static void
+consume_test_output(struct workspace *wk, struct run_test_ctx *ctx, struct test_result *res, bool done)
+{
+	struct run_cmd_pipe_ctx *out = &res->cmd_ctx.out, *err = &res->cmd_ctx.err;
+
+	if (res->test->protocol == test_protocol_tap && out->len > res->out_parsed) {
+		tap_parser_feed(&res->tap, &out->buf[res->out_parsed], out->len - res->out_parsed);
+		res->out_parsed = out->len;
+
+		uint32_t pass = res->tap.res.pass + res->tap.res.skip,
+			 fail = res->tap.res.fail;
+
+		if (pass != res->subtests.pass || fail != res->subtests.fail) {
+			ctx->stats.subtests_pass += pass - res->subtests.pass;
+			ctx->stats.subtests_fail += fail - res->subtests.fail;
+
+			res->subtests.have = true;
+			res->subtests.pass = pass;
+			res->subtests.fail = fail;
+			res->subtests.total = res->tap.have_plan ? res->tap.res.total : pass + fail;
+
+			if (!done && ctx->stats.term) {
+				print_test_progress(wk, ctx, res, false);
+			}
+		}
+	}
+
+	size_t max = ctx->opts->output_max;
+	if (!max) {
+		return;
+	}
+
+	// let the output grow to twice the limit while the test is running so
+	// that it isn't moved around on every read
+	if (done || out->len > max * 2) {
+		res->out_dropped += run_cmd_pipe_keep_tail(out, max);
+		res->out_parsed = out->len;
+	}
+
+	if (done || err->len > max * 2) {
+		res->err_dropped += run_cmd_pipe_keep_tail(err, max);
+	}
+}
+
 static enum test_result_status
 check_test_result_tap(struct workspace *wk, struct run_test_ctx *ctx, struct test_result *res)
 {
-	struct tap_parse_result tap_result = { 0 };
-	tap_parse(res->cmd_ctx.out.buf, res->cmd_ctx.out.len, &tap_result);
+	struct tap_parse_result tap_result;
+	tap_parser_finish(&res->tap, &tap_result);
+
+	ctx->stats.subtests_pass += tap_result.pass + tap_result.skip - res->subtests.pass;
+	ctx->stats.subtests_fail += tap_result.fail - res->subtests.fail;
 
 	res->subtests.have = true;
 	res->subtests.pass = tap_result.pass + tap_result.skip;
+	res->subtests.fail = tap_result.fail;
 	res->subtests.total = tap_result.total;
 
 	return tap_result.all_ok && res->status == 0 ? test_result_status_ok : test_result_status_failed;
@@ -520,6 +592,62 @@ check_test_result_exitcode(struct workspace *wk, struct run_test_ctx *ctx, struc
 	}
 }
 
+static obj
+test_history_key(struct workspace *wk, obj proj_name, struct obj_test *test)
+{
+	SBUF(key);
+
+	// test names are only unique within a suite
+	if (test->suites) {
+		obj_asprintf(wk, &key, "%#o:%o:%#o", proj_name, test->suites, test->name);
+	} else {
+		obj_asprintf(wk, &key, "%#o::%#o", proj_name, test->name);
+	}
+
+	return sbuf_into_str(wk, &key);
+}
+
+/*
+ * The history is read back from the build directory, so entries that don't
+ * have the shape written by push_test_result are ignored.
+ */
+static bool
+test_history_entry_valid(struct workspace *wk, obj entry)
+{
+	obj v;
+
+	if (get_obj_type(wk, entry) != obj_array || get_obj_array(wk, entry)->len != 2) {
+		return false;
+	}
+
+	obj_array_index(wk, entry, 0, &v);
+	if (get_obj_type(wk, v) != obj_number) {
+		return false;
+	}
+
+	obj_array_index(wk, entry, 1, &v);
+	return get_obj_type(wk, v) == obj_bool;
+}
+
+static void
+push_test_result(struct workspace *wk, struct run_test_ctx *ctx, struct test_result *res)
+{
+	tap_parser_destroy(&res->tap);
+	arr_push(&ctx->test_results, res);
+
+	obj entry, dur, failed;
+	make_obj(wk, &dur, obj_number);
+	set_obj_number(wk, dur, res->dur * 1000.0f);
+	make_obj(wk, &failed, obj_bool);
+	set_obj_bool(wk, failed, res->status == test_result_status_failed
+		|| res->status == test_result_status_timedout);
+
+	make_obj(wk, &entry, obj_array);
+	obj_array_push(wk, entry, dur);
+	obj_array_push(wk, entry, failed);
+	obj_dict_set(wk, ctx->history, test_history_key(wk, ctx->proj_name, res->test), entry);
+}
+
 static void
 collect_tests(struct workspace *wk, struct run_test_ctx *ctx)
 {
@@ -534,12 +662,13 @@ collect_tests(struct workspace *wk, struct run_test_ctx *ctx)
 		res->dur = timer_end(&res->t);
 
 		enum run_cmd_state state = run_cmd_collect(&res->cmd_ctx);
+		consume_test_output(wk, ctx, res, state != run_cmd_running);
 
 		if (state != run_cmd_running
 		    && res->status == test_result_status_timedout) {
 			run_cmd_ctx_destroy(&res->cmd_ctx);
 			print_test_progress(wk, ctx, res, true);
-			arr_push(&ctx->test_results, res);
+			push_test_result(wk, ctx, res);
 			goto free_slot;
 		}
 
@@ -561,7 +690,7 @@ collect_tests(struct workspace *wk, struct run_test_ctx *ctx)
 		case run_cmd_error:
 			res->status = test_result_status_failed;
 			print_test_progress(wk, ctx, res, true);
-			arr_push(&ctx->test_results, res);
+			push_test_result(wk, ctx, res);
 			break;
 		case run_cmd_finished: {
 			enum test_result_status status;
@@ -591,7 +720,7 @@ collect_tests(struct workspace *wk, struct run_test_ctx *ctx)
 			}
 
 			print_test_progress(wk, ctx, res, true);
-			arr_push(&ctx->test_results, res);
+			push_test_result(wk, ctx, res);
 			break;
 		}
 		}
@@ -610,6 +739,46 @@ free_slot:
 	}
 }
 
+/*
+ * Block until a running test produces output, exits, or runs into its
+ * timeout, so that output is drained as it arrives and slots are refilled as
+ * soon as a test is done.
+ */
+static void
+wait_for_tests(struct workspace *wk, struct run_test_ctx *ctx)
+{
+	uint32_t i, len = 0;
+	float timeout = RUN_CMD_WAIT_MAX / 1000.0f;
+
+	for (i = 0; i < ctx->opts->jobs; ++i) {
+		struct test_result *res = &ctx->jobs[i];
+		if (!res->busy) {
+			continue;
+		}
+
+		ctx->busy_cmd_ctxs[len++] = &res->cmd_ctx;
+
+		if (res->timeout > 0.0f) {
+			float left = res->timeout - timer_end(&res->t);
+
+			if (res->status == test_result_status_timedout) {
+				// time until collect_tests force kills it
+				left += 0.5f;
+			}
+
+			if (left < timeout) {
+				timeout = left;
+			}
+		}
+	}
+
+	if (timeout < 0.0f) {
+		timeout = 0.0f;
+	}
+
+	run_cmd_wait(ctx->busy_cmd_ctxs, len, timeout * 1000.0f + 1);
+}
+
 static void
 push_test(struct workspace *wk, struct run_test_ctx *ctx, struct obj_test *test,
 	const char *argstr, uint32_t argc, const char *envstr, uint32_t envc)
@@ -635,7 +804,7 @@ push_test(struct workspace *wk, struct run_test_ctx *ctx, struct obj_test *test,
 		}
 
 cont:
-		timer_sleep(SLEEP_TIME);
+		wait_for_tests(wk, ctx);
 		collect_tests(wk, ctx);
 	}
 found_slot:
@@ -659,6 +828,8 @@ found_slot:
 		cmd_ctx->flags |= run_cmd_ctx_flag_dont_capture;
 	}
 
+	tap_parser_init(&res->tap);
+
 	if (test->workdir) {
 		cmd_ctx->chdir = get_cstr(wk, test->workdir);
 	}
@@ -674,7 +845,7 @@ found_slot:
 		res->dur = timer_end(&res->t);
 		res->status = test_result_status_failed;
 		print_test_progress(wk, ctx, res, true);
-		arr_push(&ctx->test_results, res);
+		push_test_result(wk, ctx, res);
 	}
 }
 
@@ -786,6 +957,12 @@ gather_project_tests_iter(struct workspace *wk, void *_ctx, obj val)
 
 	obj_array_push(wk, ctx->collected_tests, val);
 
+	obj entry;
+	if (obj_dict_index(wk, ctx->history, test_history_key(wk, ctx->proj_name, t), &entry)
+	    && test_history_entry_valid(wk, entry)) {
+		obj_dict_seti(wk, ctx->test_history, val, entry);
+	}
+
 	++ctx->stats.test_len;
 	if (t->depends) {
 		obj_array_extend_nodup(wk, ctx->deps, t->depends);
@@ -793,21 +970,58 @@ gather_project_tests_iter(struct workspace *wk, void *_ctx, obj val)
 	return ir_cont;
 }
 
+/*
+ * Returns the duration and failure status of a test's last run.  Tests that
+ * have never run are treated as taking forever so that they are started
+ * early.
+ */
+static void
+test_history_get(struct workspace *wk, struct run_test_ctx *ctx, obj t, int64_t *dur, bool *failed)
+{
+	obj entry, v;
+	if (!obj_dict_geti(wk, ctx->test_history, t, &entry)) {
+		*dur = INT64_MAX;
+		*failed = false;
+		return;
+	}
+
+	obj_array_index(wk, entry, 0, &v);
+	*dur = get_obj_number(wk, v);
+	obj_array_index(wk, entry, 1, &v);
+	*failed = get_obj_bool(wk, v);
+}
+
 static int32_t
 test_compare(struct workspace *wk, void *_ctx, obj t1_id, obj t2_id)
 {
+	struct run_test_ctx *ctx = _ctx;
 	struct obj_test *t1 = get_obj_test(wk, t1_id),
 			*t2 = get_obj_test(wk, t2_id);
 
 	int64_t p1 = t1->priority ? get_obj_number(wk, t1->priority) : 0,
 		p2 = t2->priority ? get_obj_number(wk, t2->priority) : 0;
 
+	int64_t d1, d2;
+	bool f1, f2;
+	test_history_get(wk, ctx, t1_id, &d1, &f1);
+	test_history_get(wk, ctx, t2_id, &d2, &f2);
+
 	if (p1 > p2) {
 		return -1;
 	} else if (p1 < p2) {
 		return 1;
+	} else if (ctx->opts->failed_first && f1 != f2) {
+		return f1 ? -1 : 1;
 	} else if (t1->is_parallel && t2->is_parallel) {
-		return 0;
+		// start the longest tests first so that a slow test doesn't
+		// end up running alone at the end
+		if (d1 > d2) {
+			return -1;
+		} else if (d1 < d2) {
+			return 1;
+		} else {
+			return 0;
+		}
 	} else if (t1->is_parallel) {
 		return 1;
 	} else {
@@ -841,9 +1055,12 @@ run_project_tests(struct workspace *wk, void *_ctx, obj proj_name, obj arr)
 	ctx->stats.error_count = 0;
 	ctx->stats.test_len = 0;
 
+	ctx->proj_name = proj_name;
 	make_obj(wk, &ctx->collected_tests, obj_array);
+	make_obj(wk, &ctx->test_history, obj_dict);
+	get_obj_dict(wk, ctx->test_history)->flags |= obj_dict_flag_int_key;
 	obj_array_foreach(wk, unfiltered_tests, ctx, gather_project_tests_iter);
-	obj_array_sort(wk, NULL, ctx->collected_tests, test_compare, &tests);
+	obj_array_sort(wk, ctx, ctx->collected_tests, test_compare, &tests);
 
 	if (ctx->opts->list) {
 		obj_array_foreach(wk, tests, ctx, list_tests_iter);
@@ -864,8 +1081,6 @@ run_project_tests(struct workspace *wk, void *_ctx, obj proj_name, obj arr)
 
 	ctx->stats.ran_tests = true;
 
-	ctx->proj_name = proj_name;
-
 	if (!obj_array_foreach(wk, tests, ctx, run_test)) {
 		return ir_err;
 	}
@@ -875,7 +1090,7 @@ run_project_tests(struct workspace *wk, void *_ctx, obj proj_name, obj arr)
 	}
 
 	while (ctx->busy_jobs) {
-		timer_sleep(SLEEP_TIME);
+		wait_for_tests(wk, ctx);
 		collect_tests(wk, ctx);
 	}
 
@@ -886,6 +1101,13 @@ run_project_tests(struct workspace *wk, void *_ctx, obj proj_name, obj arr)
 	return ir_cont;
 }
 
+static bool
+write_test_history(struct workspace *wk, void *_ctx, FILE *out)
+{
+	struct run_test_ctx *ctx = _ctx;
+	return serial_dump(wk, ctx->history, out);
+}
+
 bool
 tests_run(struct test_options *opts, const char *argv0)
 {
@@ -907,6 +1129,7 @@ tests_run(struct test_options *opts, const char *argv0)
 
 	arr_init(&ctx.test_results, 32, sizeof(struct test_result));
 	ctx.jobs = z_calloc(ctx.opts->jobs, sizeof(struct test_result));
+	ctx.busy_cmd_ctxs = z_calloc(ctx.opts->jobs, sizeof(struct run_cmd_ctx *));
 
 	{ // load global opts
 		obj option_info;
@@ -952,6 +1175,11 @@ tests_run(struct test_options *opts, const char *argv0)
 		goto ret;
 	}
 
+	if (!serial_load_from_private_dir(&wk, &ctx.history, output_path.test_history)
+	    || get_obj_type(&wk, ctx.history) != obj_dict) {
+		make_obj(&wk, &ctx.history, obj_dict);
+	}
+
 	if (!load_test_setup(&wk, &ctx, tests_dict)) {
 		goto ret;
 	}
@@ -968,6 +1196,10 @@ tests_run(struct test_options *opts, const char *argv0)
 	if (!ctx.stats.ran_tests) {
 		LOG_I("no %ss defined", test_category_label(opts->cat));
 	} else {
+		if (!with_open(output_path.private_dir, output_path.test_history, &wk, &ctx, write_test_history)) {
+			LOG_W("failed to write test history");
+		}
+
 		LOG_I("finished %d %ss, %d expected fail, %d fail, %d skipped",
 			ctx.stats.total_count,
 			test_category_label(opts->cat),
@@ -998,9 +1230,15 @@ tests_run(struct test_options *opts, const char *argv0)
 			} else {
 				ret = false;
 				if (res->cmd_ctx.out.len) {
+					if (res->out_dropped) {
+						log_plain("stdout: (%" PRIu64 " bytes omitted)\n", res->out_dropped);
+					}
 					log_plain("stdout: '%s'\n", res->cmd_ctx.out.buf);
 				}
 				if (res->cmd_ctx.err.len) {
+					if (res->err_dropped) {
+						log_plain("stderr: (%" PRIu64 " bytes omitted)\n", res->err_dropped);
+					}
 					log_plain("stderr: '%s'\n", res->cmd_ctx.err.buf);
 				}
 
@@ -1016,5 +1254,6 @@ ret:
 	workspace_destroy_bare(&wk);
 	arr_destroy(&ctx.test_results);
 	z_free(ctx.jobs);
+	z_free(ctx.busy_cmd_ctxs);
 	return ret;
 }
@@ -23,6 +23,7 @@
 #include "options.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
+#include "toolchain_cache.h"
 
 const char *
 compiler_type_to_s(enum compiler_type t)
@@ -170,25 +171,6 @@ coalesce_link_languages(enum compiler_language cur, enum compiler_language new)
 	return cur;
 }
 
-static bool
-run_cmd_arr(struct workspace *wk, struct run_cmd_ctx *cmd_ctx, obj cmd_arr, const char *arg)
-{
-	obj args;
-	obj_array_dup(wk, cmd_arr, &args);
-	obj_array_push(wk, args, make_str(wk, arg));
-
-	const char *argstr;
-	uint32_t argc;
-	join_args_argstr(wk, &argstr, &argc, args);
-
-	if (!run_cmd(cmd_ctx, argstr, argc, NULL, 0)) {
-		run_cmd_ctx_destroy(cmd_ctx);
-		return false;
-	}
-
-	return true;
-}
-
 static const char *
 compiler_get_c_version_arg(struct workspace *wk, obj cmd_arr)
 {
@@ -203,37 +185,37 @@ static bool
 compiler_detect_c_or_cpp(struct workspace *wk, obj cmd_arr, obj *comp_id)
 {
 	// helpful: mesonbuild/compilers/detect.py:350
-	struct run_cmd_ctx cmd_ctx = { 0 };
-	if (!run_cmd_arr(wk, &cmd_ctx, cmd_arr, compiler_get_c_version_arg(wk, cmd_arr))) {
-		run_cmd_ctx_destroy(&cmd_ctx);
+	struct toolchain_cmd_result cmd_res;
+	if (!toolchain_run_cmd(wk, cmd_arr, compiler_get_c_version_arg(wk, cmd_arr), &cmd_res)) {
 		return false;
 	}
 
 	enum compiler_type type;
 	bool unknown = true;
 	obj ver;
+	const char *out = get_cstr(wk, cmd_res.out);
 
-	if (cmd_ctx.status != 0) {
+	if (cmd_res.status != 0) {
 		goto detection_over;
 	}
 
-	if (strstr(cmd_ctx.out.buf, "Apple") && strstr(cmd_ctx.out.buf, "clang")) {
+	if (strstr(out, "Apple") && strstr(out, "clang")) {
 		type = compiler_apple_clang;
-	} else if (strstr(cmd_ctx.out.buf, "clang") || strstr(cmd_ctx.out.buf, "Clang")) {
-		if (strstr(cmd_ctx.out.buf, "msvc")) {
+	} else if (strstr(out, "clang") || strstr(out, "Clang")) {
+		if (strstr(out, "msvc")) {
 			type = compiler_clang_cl;
 		} else {
 			type = compiler_clang;
 		}
-	} else if (strstr(cmd_ctx.out.buf, "Free Software Foundation")) {
+	} else if (strstr(out, "Free Software Foundation")) {
 		type = compiler_gcc;
-	} else if (strstr(cmd_ctx.out.buf, "Microsoft")) {
+	} else if (strstr(out, "Microsoft")) {
 		type = compiler_msvc;
 	} else {
 		goto detection_over;
 	}
 
-	if (!guess_version(wk, (type == compiler_msvc) ? cmd_ctx.err.buf : cmd_ctx.out.buf, &ver)) {
+	if (!guess_version(wk, (type == compiler_msvc) ? get_cstr(wk, cmd_res.err) : out, &ver)) {
 		ver = make_str(wk, "unknown");
 	}
 
@@ -255,32 +237,31 @@ detection_over:
 	comp->type = type;
 	comp->ver = ver;
 
-	run_cmd_ctx_destroy(&cmd_ctx);
 	return true;
 }
 
 static bool
 compiler_detect_nasm(struct workspace *wk, obj cmd_arr, obj *comp_id)
 {
-	struct run_cmd_ctx cmd_ctx = { 0 };
-	if (!run_cmd_arr(wk, &cmd_ctx, cmd_arr, "--version")) {
-		run_cmd_ctx_destroy(&cmd_ctx);
+	struct toolchain_cmd_result cmd_res;
+	if (!toolchain_run_cmd(wk, cmd_arr, "--version", &cmd_res)) {
 		return false;
 	}
 
 	enum compiler_type type;
 	obj ver;
+	const char *out = get_cstr(wk, cmd_res.out);
 
-	if (strstr(cmd_ctx.out.buf, "NASM")) {
+	if (strstr(out, "NASM")) {
 		type = compiler_nasm;
-	} else if (strstr(cmd_ctx.out.buf, "yasm")) {
+	} else if (strstr(out, "yasm")) {
 		type = compiler_yasm;
 	} else {
 		// Just assume it is nasm
 		type = compiler_nasm;
 	}
 
-	if (!guess_version(wk, cmd_ctx.out.buf, &ver)) {
+	if (!guess_version(wk, out, &ver)) {
 		ver = make_str(wk, "unknown");
 	}
 
@@ -319,23 +300,22 @@ compiler_detect_nasm(struct workspace *wk, obj cmd_arr, obj *comp_id)
 	comp->ver = ver;
 	comp->lang = compiler_language_nasm;
 
-	run_cmd_ctx_destroy(&cmd_ctx);
 	return true;
 }
 
 static bool
 compiler_get_libdirs(struct workspace *wk, struct obj_compiler *comp)
 {
-	struct run_cmd_ctx cmd_ctx = { 0 };
-	if (!run_cmd_arr(wk, &cmd_ctx, comp->cmd_arr, "-print-search-dirs")
-	    || cmd_ctx.status) {
+	struct toolchain_cmd_result cmd_res;
+	if (!toolchain_run_cmd(wk, comp->cmd_arr, "-print-search-dirs", &cmd_res)
+	    || cmd_res.status) {
 		goto done;
 	}
 
 	const char *key = "libraries: ";
-	char *s, *e;
+	const char *s, *e;
 	bool beginning_of_line = true;
-	for (s = cmd_ctx.out.buf; *s; ++s) {
+	for (s = get_cstr(wk, cmd_res.out); *s; ++s) {
 		if (beginning_of_line && strncmp(s, key, strlen(key)) == 0) {
 			s += strlen(key);
 			if (*s == '=') {
@@ -357,8 +337,6 @@ compiler_get_libdirs(struct workspace *wk, struct obj_compiler *comp)
 	}
 
 done:
-	run_cmd_ctx_destroy(&cmd_ctx);
-
 	if (!comp->libdirs) {
 		const char *libdirs[] = {
 			"/usr/lib",
@@ -32,7 +32,7 @@ fnv_1a_64_str(const struct hash *hash, const void *_key)
 {
 	const struct strkey *key = _key;
 	uint64_t h = 14695981039346656037u;
-	uint16_t i;
+	uint64_t i;
 
 	for (i = 0; i < key->len; i++) {
 		h ^= key->str[i];
@@ -47,7 +47,7 @@ fnv_1a_64(const struct hash *hash, const void *_key)
 {
 	const uint8_t *key = _key;
 	uint64_t h = 14695981039346656037u;
-	uint16_t i;
+	uint64_t i;
 
 	for (i = 0; i < hash->keys.item_size; i++) {
 		h ^= key[i];
@@ -0,0 +1,448 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "buf_size.h"
+#include "digest.h"
+#include "log.h"
+#include "platform/filesystem.h"
+#include "platform/mem.h"
+
+#define DIGEST_READ_BUF_SIZE (1024 * 1024)
+
+/*
+ * Portable implementations of the algorithms other than sha224 and sha256,
+ * which are handled by sha_256.c.  These follow RFC 1321 (md5) and FIPS
+ * 180-4 (sha1, sha384, sha512).
+ */
+
+static uint32_t
+rol32(uint32_t v, uint32_t n)
+{
+	return v << n | v >> (32 - n);
+}
+
+static uint64_t
+ror64(uint64_t v, uint32_t n)
+{
+	return v >> n | v << (64 - n);
+}
+
+static uint32_t
+load_be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static uint32_t
+load_le32(const uint8_t *p)
+{
+	return (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | (uint32_t)p[0];
+}
+
+static uint64_t
+load_be64(const uint8_t *p)
+{
+	return (uint64_t)load_be32(p) << 32 | load_be32(&p[4]);
+}
+
+static void
+digest_blocks_md5(struct digest *d, const uint8_t *p, size_t n)
+{
+	static const uint32_t k[64] = {
+	0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+	0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+	0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+	0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+	0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+	0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+	0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+	0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+	};
+	static const uint8_t r[64] = {
+		7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+		5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+		4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+		6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+	};
+
+	uint32_t *h = d->ctx.other.h.w;
+	uint32_t m[16], a, b, c, dd, f, g, tmp, i;
+
+	for (; n; --n, p += 64) {
+		for (i = 0; i < 16; ++i) {
+			m[i] = load_le32(&p[i * 4]);
+		}
+
+		a = h[0];
+		b = h[1];
+		c = h[2];
+		dd = h[3];
+
+		for (i = 0; i < 64; ++i) {
+			if (i < 16) {
+				f = (b & c) | (~b & dd);
+				g = i;
+			} else if (i < 32) {
+				f = (dd & b) | (~dd & c);
+				g = (5 * i + 1) % 16;
+			} else if (i < 48) {
+				f = b ^ c ^ dd;
+				g = (3 * i + 5) % 16;
+			} else {
+				f = c ^ (b | ~dd);
+				g = (7 * i) % 16;
+			}
+
+			tmp = dd;
+			dd = c;
+			c = b;
+			b = b + rol32(a + f + k[i] + m[g], r[i]);
+			a = tmp;
+		}
+
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += dd;
+	}
+}
+
+static void
+digest_blocks_sha1(struct digest *d, const uint8_t *p, size_t n)
+{
+	uint32_t *h = d->ctx.other.h.w;
+	uint32_t w[80], a, b, c, dd, e, f, k, tmp, i;
+
+	for (; n; --n, p += 64) {
+		for (i = 0; i < 16; ++i) {
+			w[i] = load_be32(&p[i * 4]);
+		}
+
+		for (i = 16; i < 80; ++i) {
+			w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+
+		a = h[0];
+		b = h[1];
+		c = h[2];
+		dd = h[3];
+		e = h[4];
+
+		for (i = 0; i < 80; ++i) {
+			if (i < 20) {
+				f = (b & c) | (~b & dd);
+				k = 0x5a827999;
+			} else if (i < 40) {
+				f = b ^ c ^ dd;
+				k = 0x6ed9eba1;
+			} else if (i < 60) {
+				f = (b & c) | (b & dd) | (c & dd);
+				k = 0x8f1bbcdc;
+			} else {
+				f = b ^ c ^ dd;
+				k = 0xca62c1d6;
+			}
+
+			tmp = rol32(a, 5) + f + e + k + w[i];
+			e = dd;
+			dd = c;
+			c = rol32(b, 30);
+			b = a;
+			a = tmp;
+		}
+
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += dd;
+		h[4] += e;
+	}
+}
+
+static void
+digest_blocks_sha512(struct digest *d, const uint8_t *p, size_t n)
+{
+	static const uint64_t k[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+	};
+
+	uint64_t *h = d->ctx.other.h.d;
+	uint64_t w[80], ah[8], s0, s1, ch, maj, temp1, temp2;
+	uint32_t i;
+
+	for (; n; --n, p += 128) {
+		for (i = 0; i < 16; ++i) {
+			w[i] = load_be64(&p[i * 8]);
+		}
+
+		for (i = 16; i < 80; ++i) {
+			s0 = ror64(w[i - 15], 1) ^ ror64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+			s1 = ror64(w[i - 2], 19) ^ ror64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		memcpy(ah, h, sizeof(ah));
+
+		for (i = 0; i < 80; ++i) {
+			s1 = ror64(ah[4], 14) ^ ror64(ah[4], 18) ^ ror64(ah[4], 41);
+			ch = (ah[4] & ah[5]) ^ (~ah[4] & ah[6]);
+			temp1 = ah[7] + s1 + ch + k[i] + w[i];
+			s0 = ror64(ah[0], 28) ^ ror64(ah[0], 34) ^ ror64(ah[0], 39);
+			maj = (ah[0] & ah[1]) ^ (ah[0] & ah[2]) ^ (ah[1] & ah[2]);
+			temp2 = s0 + maj;
+
+			ah[7] = ah[6];
+			ah[6] = ah[5];
+			ah[5] = ah[4];
+			ah[4] = ah[3] + temp1;
+			ah[3] = ah[2];
+			ah[2] = ah[1];
+			ah[1] = ah[0];
+			ah[0] = temp1 + temp2;
+		}
+
+		for (i = 0; i < 8; ++i) {
+			h[i] += ah[i];
+		}
+	}
+}
+
+static const struct {
+	const char *name;
+	uint32_t len, block_size, len_size;
+	bool little_endian;
+	void (*blocks)(struct digest *d, const uint8_t *p, size_t n);
+} digest_algos[] = {
+	[digest_algo_md5] = { "md5", 16, 64, 8, true, digest_blocks_md5 },
+	[digest_algo_sha1] = { "sha1", 20, 64, 8, false, digest_blocks_sha1 },
+	[digest_algo_sha224] = { "sha224", 28 },
+	[digest_algo_sha256] = { "sha256", 32 },
+	[digest_algo_sha384] = { "sha384", 48, 128, 16, false, digest_blocks_sha512 },
+	[digest_algo_sha512] = { "sha512", 64, 128, 16, false, digest_blocks_sha512 },
+};
+
+bool
+digest_algo_from_s(const char *name, enum digest_algo *res)
+{
+	uint32_t i;
+	for (i = 0; i < ARRAY_LEN(digest_algos); ++i) {
+		if (strcmp(digest_algos[i].name, name) == 0) {
+			*res = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t
+digest_len(enum digest_algo algo)
+{
+	return digest_algos[algo].len;
+}
+
+void
+digest_init(struct digest *d, enum digest_algo algo)
+{
+	static const uint32_t md5_h[] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+	static const uint32_t sha1_h[] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+	static const uint64_t sha384_h[] = {
+	0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+	0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL, 0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL,
+	};
+	static const uint64_t sha512_h[] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+	};
+
+	memset(d, 0, sizeof(*d));
+	d->algo = algo;
+
+	switch (algo) {
+	case digest_algo_md5:
+		memcpy(d->ctx.other.h.w, md5_h, sizeof(md5_h));
+		break;
+	case digest_algo_sha1:
+		memcpy(d->ctx.other.h.w, sha1_h, sizeof(sha1_h));
+		break;
+	case digest_algo_sha224:
+		sha_224_init(&d->ctx.sha_256);
+		break;
+	case digest_algo_sha256:
+		sha_256_init(&d->ctx.sha_256);
+		break;
+	case digest_algo_sha384:
+		memcpy(d->ctx.other.h.d, sha384_h, sizeof(sha384_h));
+		break;
+	case digest_algo_sha512:
+		memcpy(d->ctx.other.h.d, sha512_h, sizeof(sha512_h));
+		break;
+	}
+}
+
+void
+digest_update(struct digest *d, const void *input, size_t len)
+{
+	if (d->algo == digest_algo_sha224 || d->algo == digest_algo_sha256) {
+		sha_256_update(&d->ctx.sha_256, input, len);
+		return;
+	}
+
+	const uint8_t *p = input;
+	const uint32_t block_size = digest_algos[d->algo].block_size;
+
+	d->ctx.other.total_len += len;
+
+	if (d->ctx.other.chunk_len) {
+		size_t n = block_size - d->ctx.other.chunk_len;
+		if (n > len) {
+			n = len;
+		}
+
+		memcpy(&d->ctx.other.chunk[d->ctx.other.chunk_len], p, n);
+		d->ctx.other.chunk_len += n;
+		p += n;
+		len -= n;
+
+		if (d->ctx.other.chunk_len < block_size) {
+			return;
+		}
+
+		digest_algos[d->algo].blocks(d, d->ctx.other.chunk, 1);
+		d->ctx.other.chunk_len = 0;
+	}
+
+	if (len >= block_size) {
+		digest_algos[d->algo].blocks(d, p, len / block_size);
+		p += len - len % block_size;
+		len %= block_size;
+	}
+
+	memcpy(d->ctx.other.chunk, p, len);
+	d->ctx.other.chunk_len = len;
+}
+
+void
+digest_final(struct digest *d, uint8_t *hash)
+{
+	if (d->algo == digest_algo_sha224 || d->algo == digest_algo_sha256) {
+		sha_256_final(&d->ctx.sha_256, hash);
+		return;
+	}
+
+	const uint32_t block_size = digest_algos[d->algo].block_size,
+		       len_size = digest_algos[d->algo].len_size;
+	const uint64_t bits = d->ctx.other.total_len << 3;
+	uint8_t pad[128 + 16] = { 0x80 };
+	uint32_t i;
+
+	/*
+	 * Append a single one bit, then zeroes until there is just enough space
+	 * left for the length in bits.
+	 */
+	size_t pad_len = (d->ctx.other.chunk_len < block_size - len_size ? block_size : 2 * block_size)
+			 - d->ctx.other.chunk_len - len_size;
+
+	for (i = 0; i < 8; ++i) {
+		if (digest_algos[d->algo].little_endian) {
+			pad[pad_len + i] = (uint8_t)(bits >> (8 * i));
+		} else {
+			pad[pad_len + len_size - 1 - i] = (uint8_t)(bits >> (8 * i));
+		}
+	}
+
+	digest_update(d, pad, pad_len + len_size);
+
+	for (i = 0; i < digest_algos[d->algo].len; ++i) {
+		switch (d->algo) {
+		case digest_algo_md5:
+			hash[i] = (uint8_t)(d->ctx.other.h.w[i / 4] >> (8 * (i % 4)));
+			break;
+		case digest_algo_sha1:
+			hash[i] = (uint8_t)(d->ctx.other.h.w[i / 4] >> (8 * (3 - i % 4)));
+			break;
+		default:
+			hash[i] = (uint8_t)(d->ctx.other.h.d[i / 8] >> (8 * (7 - i % 8)));
+			break;
+		}
+	}
+}
+
+/*
+ * Files are hashed in fixed size pieces so that memory use doesn't depend on
+ * the size of the file.
+ */
+bool
+digest_file(enum digest_algo algo, const char *path, uint8_t *hash)
+{
+	FILE *f;
+	if (!(f = fs_fopen(path, "rb"))) {
+		return false;
+	}
+
+	bool ret = false;
+	uint8_t *buf = z_malloc(DIGEST_READ_BUF_SIZE);
+	struct digest d;
+	size_t n;
+
+	digest_init(&d, algo);
+
+	while ((n = fread(buf, 1, DIGEST_READ_BUF_SIZE, f))) {
+		digest_update(&d, buf, n);
+	}
+
+	if (ferror(f)) {
+		LOG_E("failed to read %s: %s", path, strerror(errno));
+		goto ret;
+	}
+
+	digest_final(&d, hash);
+	ret = true;
+ret:
+	z_free(buf);
+	if (!fs_fclose(f)) {
+		ret = false;
+	}
+	return ret;
+}
+
+void
+digest_to_hex(const uint8_t *hash, uint32_t len, char *buf)
+{
+	static const char hex[] = "0123456789abcdef";
+	uint32_t i;
+
+	for (i = 0; i < len; ++i) {
+		buf[i * 2] = hex[hash[i] >> 4];
+		buf[i * 2 + 1] = hex[hash[i] & 0xf];
+	}
+
+	buf[len * 2] = 0;
+}
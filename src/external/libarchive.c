@@ -16,6 +16,8 @@
 
 const bool have_libarchive = true;
 
+#define ARCHIVE_READ_BLOCK_SIZE (64 * 1024)
+
 static int
 copy_data(struct archive *ar, struct archive *aw)
 {
@@ -39,7 +41,7 @@ copy_data(struct archive *ar, struct archive *aw)
 }
 
 bool
-muon_archive_extract(const char *buf, size_t size, const char *dest_path)
+muon_archive_extract(const char *archive_path, const char *dest_path)
 {
 	bool res = false;
 	struct archive *a;
@@ -61,7 +63,7 @@ muon_archive_extract(const char *buf, size_t size, const char *dest_path)
 	archive_write_disk_set_options(ext, flags);
 	archive_write_disk_set_standard_lookup(ext);
 
-	if ((r = archive_read_open_memory(a, buf, size))) {
+	if ((r = archive_read_open_filename(a, archive_path, ARCHIVE_READ_BLOCK_SIZE))) {
 		// may not work, a might not be initialized ??
 		LOG_E("error opening archive: %s\n", archive_error_string(a));
 		goto ret;
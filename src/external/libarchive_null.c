@@ -11,7 +11,7 @@
 const bool have_libarchive = false;
 
 bool
-muon_archive_extract(const char *buf, size_t size, const char *dest_path)
+muon_archive_extract(const char *path, const char *dest_path)
 {
 	LOG_W("libarchive not enabled");
 	return false;
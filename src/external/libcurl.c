@@ -5,16 +5,12 @@
 
 #include "compat.h"
 
-#include <assert.h>
-#include <errno.h>
 #include <stdbool.h>
-#include <string.h>
 
 #include <curl/curl.h>
 
 #include "external/libcurl.h"
 #include "log.h"
-#include "platform/mem.h"
 
 const bool have_libcurl = true;
 
@@ -22,10 +18,16 @@ static struct {
 	bool init;
 } fetch_ctx = { 0 };
 
+/*
+ * libcurl is initialized once, the first time it is needed, and cleaned up
+ * when muon exits.
+ */
 void
 muon_curl_init(void)
 {
-	assert(!fetch_ctx.init);
+	if (fetch_ctx.init) {
+		return;
+	}
 
 	if (curl_global_init(CURL_GLOBAL_DEFAULT) == 0) {
 		fetch_ctx.init = true;
@@ -44,29 +46,28 @@ muon_curl_deinit(void)
 }
 
 struct write_data_ctx {
-	uint8_t *buf;
-	uint64_t len, cap;
+	muon_curl_write_cb cb;
+	void *ctx;
 };
 
+/*
+ * Data is handed to the callback as it arrives.  Returning less than nmemb
+ * makes curl abort the transfer.
+ */
 static size_t
 write_data(void *src, size_t size, size_t nmemb, void *_ctx)
 {
 	struct write_data_ctx *ctx = _ctx;
-	uint64_t want_to_write = size * nmemb;
 
-	if (want_to_write + ctx->len > ctx->cap) {
-		ctx->cap = want_to_write + ctx->len;
-		ctx->buf = z_realloc(ctx->buf, ctx->cap);
+	if (!ctx->cb(ctx->ctx, src, (uint64_t)size * nmemb)) {
+		return 0;
 	}
 
-	memcpy(&ctx->buf[ctx->len], src, want_to_write);
-	ctx->len += want_to_write;
-
 	return nmemb;
 }
 
 bool
-muon_curl_fetch(const char *url, uint8_t **buf, uint64_t *len)
+muon_curl_fetch(const char *url, muon_curl_write_cb cb, void *cb_ctx)
 {
 	CURL *curl_handle;
 	CURLcode err;
@@ -112,7 +113,7 @@ muon_curl_fetch(const char *url, uint8_t **buf, uint64_t *len)
 		goto err1;
 	}
 
-	struct write_data_ctx ctx = { 0 };
+	struct write_data_ctx ctx = { .cb = cb, .ctx = cb_ctx };
 	/* write the page body to this file handle */
 	if ((err = curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &ctx)) != CURLE_OK) {
 		goto err1;
@@ -123,9 +124,6 @@ muon_curl_fetch(const char *url, uint8_t **buf, uint64_t *len)
 		goto err1;
 	}
 
-	*buf = ctx.buf;
-	*len = ctx.len;
-
 	/* cleanup curl stuff */
 	curl_easy_cleanup(curl_handle);
 	return true;
@@ -21,7 +21,7 @@ muon_curl_deinit(void)
 }
 
 bool
-muon_curl_fetch(const char *url, uint8_t **buf, uint64_t *len)
+muon_curl_fetch(const char *url, muon_curl_write_cb cb, void *ctx)
 {
 	LOG_W("libcurl not enabled");
 	return false;
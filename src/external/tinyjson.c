@@ -12,8 +12,7 @@
 #include "lang/object.h"
 #include "lang/string.h"
 #include "log.h"
-
-#define TINYJSON_MAX_FIELDS 1024
+#include "platform/mem.h"
 
 static bool
 build_dict_from_json(struct workspace *wk, const json_t *json, obj *res)
@@ -71,18 +70,33 @@ build_dict_from_json(struct workspace *wk, const json_t *json, obj *res)
 bool
 muon_json_to_dict(struct workspace *wk, char *json_str, obj *res)
 {
-	json_t mem[TINYJSON_MAX_FIELDS];
+	bool ret = false;
+
+	// every value is either the first one in the document or a container, or
+	// follows a comma, so this is enough fields no matter how large the input
+	const char *p;
+	uint32_t fields = 1;
+	for (p = json_str; *p; ++p) {
+		if (*p == ',' || *p == '[' || *p == '{') {
+			++fields;
+		}
+	}
 
-	const json_t *json = json_create(json_str, mem, TINYJSON_MAX_FIELDS);
+	json_t *mem = z_calloc(fields, sizeof(json_t));
+
+	const json_t *json = json_create(json_str, mem, fields);
 	if (!json) {
 		LOG_E("error parsing json to obj_dict: syntax error or out of memory");
-		return false;
+		goto ret;
 	}
 
 	if (json_getType(json) != JSON_OBJ) {
 		LOG_E("error parsing json to obj_dict: unexpected or invalid object");
-		return false;
+		goto ret;
 	}
 
-	return build_dict_from_json(wk, json, res);
+	ret = build_dict_from_json(wk, json, res);
+ret:
+	z_free(mem);
+	return ret;
 }
@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "buf_size.h"
+#include "datastructures/hash.h"
 #include "error.h"
 #include "formats/editorconfig.h"
 #include "formats/ini.h"
@@ -278,6 +279,75 @@ editorconfig_cfg_parse_cb(void *_ctx, struct source *src, const char *sect,
 	return true;
 }
 
+/*
+ * Formatting many files walks up the same directories over and over, so the
+ * .editorconfig of each directory (or the lack of one) is only read once and
+ * kept until editorconfig_cache_destroy().
+ */
+struct editorconfig_file {
+	char *dir;
+	struct source src;
+	char *buf;
+	bool exists;
+};
+
+static struct {
+	struct hash dirs;
+	struct arr files;
+	bool init;
+} editorconfig_cache;
+
+static struct editorconfig_file *
+editorconfig_cache_get(const char *dir, const char *path)
+{
+	if (!editorconfig_cache.init) {
+		hash_init_str(&editorconfig_cache.dirs, 64);
+		arr_init(&editorconfig_cache.files, 64, sizeof(struct editorconfig_file));
+		editorconfig_cache.init = true;
+	}
+
+	const uint64_t *idx;
+	if ((idx = hash_get_strn(&editorconfig_cache.dirs, dir, strlen(dir)))) {
+		return arr_get(&editorconfig_cache.files, *idx);
+	}
+
+	struct editorconfig_file f = { 0 };
+	uint32_t len = strlen(dir);
+	f.dir = z_calloc(len + 1, 1);
+	memcpy(f.dir, dir, len);
+
+	if (fs_file_exists(path) && fs_read_entire_file(path, &f.src)) {
+		f.buf = z_calloc(f.src.len + 1, 1);
+		f.exists = true;
+	}
+
+	uint32_t i = arr_push(&editorconfig_cache.files, &f);
+	hash_set_strn(&editorconfig_cache.dirs, f.dir, len, i);
+	return arr_get(&editorconfig_cache.files, i);
+}
+
+void
+editorconfig_cache_destroy(void)
+{
+	if (!editorconfig_cache.init) {
+		return;
+	}
+
+	uint32_t i;
+	for (i = 0; i < editorconfig_cache.files.len; ++i) {
+		struct editorconfig_file *f = arr_get(&editorconfig_cache.files, i);
+		z_free(f->dir);
+		if (f->exists) {
+			z_free(f->buf);
+			fs_source_destroy(&f->src);
+		}
+	}
+
+	hash_destroy(&editorconfig_cache.dirs);
+	arr_destroy(&editorconfig_cache.files);
+	editorconfig_cache.init = false;
+}
+
 void
 try_parse_editorconfig(struct source *src, struct editorconfig_opts *opts)
 {
@@ -289,28 +359,19 @@ try_parse_editorconfig(struct source *src, struct editorconfig_opts *opts)
 	path_dirname(0, &wd, path.buf);
 
 	const char *indent_style = NULL, *indent_size = NULL, *tab_width = NULL;
-	struct source cfg_src = { 0 };
-
-	struct arr garbage;
-	arr_init(&garbage, 16, sizeof(void *));
 
 	while (true) {
 		path_join(0, &path, wd.buf, ".editorconfig");
-		if (fs_file_exists(path.buf)) {
+		struct editorconfig_file *f = editorconfig_cache_get(wd.buf, path.buf);
+		if (f->exists) {
 			struct parse_editorconfig_ctx editorconfig_ctx = {
 				.path = path_abs.buf,
 			};
 
-			char *cfg_buf = NULL;
-			if (!ini_parse(path.buf, &cfg_src, &cfg_buf, editorconfig_cfg_parse_cb, &editorconfig_ctx)) {
+			if (!ini_reparse(path.buf, &f->src, f->buf, editorconfig_cfg_parse_cb, &editorconfig_ctx)) {
 				goto ret;
 			}
 
-			arr_push(&garbage, &cfg_buf);
-
-			fs_source_destroy(&cfg_src);
-			cfg_src = (struct source){ 0 };
-
 			if (editorconfig_ctx.matched) {
 				if (!indent_style) {
 					indent_style = editorconfig_ctx.indent_style;
@@ -373,12 +434,6 @@ try_parse_editorconfig(struct source *src, struct editorconfig_opts *opts)
 	opts->indent_by = buf;
 
 ret:
-	for (i = 0; i < garbage.len; ++i) {
-		z_free(*(void **)arr_get(&garbage, i));
-	}
-	arr_destroy(&garbage);
-
-	fs_source_destroy(&cfg_src);
 	sbuf_destroy(&wd);
 	sbuf_destroy(&path);
 	sbuf_destroy(&path_abs);
@@ -0,0 +1,30 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include "formats/json.h"
+
+void
+json_write_str(FILE *out, const char *s)
+{
+	fputc('"', out);
+	for (; *s; ++s) {
+		switch (*s) {
+		case '"': fputs("\\\"", out); break;
+		case '\\': fputs("\\\\", out); break;
+		case '\n': fputs("\\n", out); break;
+		case '\t': fputs("\\t", out); break;
+		default:
+			if ((unsigned char)*s < 0x20) {
+				fprintf(out, "\\u%04x", *s);
+			} else {
+				fputc(*s, out);
+			}
+			break;
+		}
+	}
+	fputc('"', out);
+}
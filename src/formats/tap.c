@@ -7,36 +7,35 @@
 
 #include <string.h>
 
-#include "formats/lines.h"
+#include "buf_size.h"
 #include "formats/tap.h"
 #include "lang/string.h"
 #include "log.h"
+#include "platform/mem.h"
 
-struct tap_parse_ctx {
-	struct tap_parse_result *res;
-	bool have_plan;
-	bool bail_out;
-};
-
-static enum iteration_result
-tap_parse_line_cb(void *_ctx, char *line, size_t _)
+static void
+tap_parse_line(struct tap_parser *ctx, const char *line)
 {
-	struct tap_parse_ctx *ctx = _ctx;
 	struct str l = WKSTR(line), rest;
 	bool ok;
 
+	// nothing after a bail out counts
+	if (ctx->bail_out) {
+		return;
+	}
+
 	if (str_startswith(&l, &WKSTR("1..")) && l.len > 3) {
 		struct str i = { .s = &l.s[3], l.len - 3 };
 		int64_t plan_count;
 		if (str_to_i(&i, &plan_count, false) && plan_count > 0) {
 			ctx->have_plan = true;
-			ctx->res->total = plan_count;
+			ctx->res.total = plan_count;
 		}
 
-		return ir_cont;
+		return;
 	} else if (str_startswith(&l, &WKSTR("Bail out!"))) {
 		ctx->bail_out = true;
-		return ir_cont;
+		return;
 	} else if (str_startswith(&l, &WKSTR("ok"))) {
 		ok = true;
 		rest = (struct str) { .s = &l.s[2], .len = l.len - 2 };
@@ -44,7 +43,7 @@ tap_parse_line_cb(void *_ctx, char *line, size_t _)
 		ok = false;
 		rest = (struct str) { .s = &l.s[6], .len = l.len - 6 };
 	} else {
-		return ir_cont;
+		return;
 	}
 
 	enum { none, todo, skip, } directive = none;
@@ -61,33 +60,83 @@ tap_parse_line_cb(void *_ctx, char *line, size_t _)
 	}
 
 	if (directive == skip) {
-		++ctx->res->skip;
-		return ir_cont;
+		++ctx->res.skip;
+		return;
 	}
 
 	if (ok) {
-		++ctx->res->pass;
+		++ctx->res.pass;
 	} else {
 		if (directive == todo) {
-			++ctx->res->skip;
+			++ctx->res.skip;
 		} else {
-			++ctx->res->fail;
+			++ctx->res.fail;
 		}
 	}
+}
+
+void
+tap_parser_init(struct tap_parser *ctx)
+{
+	*ctx = (struct tap_parser) { 0 };
+}
+
+/*
+ * Only the first TAP_LINE_MAX bytes of each line are kept, which is plenty
+ * to recognize test points and their directives, so that memory use doesn't
+ * depend on how much a test prints.
+ */
+#define TAP_LINE_MAX BUF_SIZE_4k
+
+void
+tap_parser_feed(struct tap_parser *ctx, const char *buf, uint64_t len)
+{
+	uint64_t i;
+
+	for (i = 0; i < len; ++i) {
+		if (buf[i] == '\n') {
+			if (ctx->line) {
+				ctx->line[ctx->line_len] = 0;
+				tap_parse_line(ctx, ctx->line);
+			}
+			ctx->line_len = 0;
+			continue;
+		} else if (ctx->line_len >= TAP_LINE_MAX) {
+			continue;
+		}
 
-	return ir_cont;
+		if (ctx->line_len >= ctx->line_cap) {
+			ctx->line_cap = ctx->line_cap ? ctx->line_cap * 2 : 128;
+			ctx->line = z_realloc(ctx->line, ctx->line_cap + 1);
+		}
+
+		ctx->line[ctx->line_len] = buf[i];
+		++ctx->line_len;
+	}
 }
 
 void
-tap_parse(char *buf, uint64_t buf_len, struct tap_parse_result *res)
+tap_parser_finish(struct tap_parser *ctx, struct tap_parse_result *res)
 {
-	struct tap_parse_ctx ctx = { .res = res };
+	if (ctx->line_len) {
+		ctx->line[ctx->line_len] = 0;
+		tap_parse_line(ctx, ctx->line);
+		ctx->line_len = 0;
+	}
 
-	each_line(buf, buf_len, &ctx, tap_parse_line_cb);
+	*res = ctx->res;
 
-	if (!ctx.have_plan) {
+	if (!ctx->have_plan) {
 		res->total = res->pass + res->skip + res->fail;
 	}
 
-	res->all_ok = res->total == res->pass + res->skip;
+	res->all_ok = !ctx->bail_out && res->total == res->pass + res->skip;
+}
+
+void
+tap_parser_destroy(struct tap_parser *ctx)
+{
+	if (ctx->line) {
+		z_free(ctx->line);
+	}
 }
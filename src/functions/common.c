@@ -5,9 +5,12 @@
 
 #include "compat.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "buf_size.h"
+#include "datastructures/hash.h"
+#include "error.h"
 #include "functions/array.h"
 #include "functions/boolean.h"
 #include "functions/both_libs.h"
@@ -39,6 +42,7 @@
 #include "lang/typecheck.h"
 #include "log.h"
 #include "platform/filesystem.h"
+#include "profile.h"
 #include "tracy.h"
 
 // When true, disable functions with the .fuzz_unsafe attribute set to true.
@@ -744,7 +748,7 @@ func_obj_call(struct workspace *wk, struct obj_func *f, obj args, obj *res)
 			}
 
 			struct node *arg_name = arr_get(&f->ast->nodes, arg->l);
-			wk->assign_variable(wk, arg_name->dat.s, val, arg->l, assign_local);
+			wk->assign_variable(wk, arg_name->l, val, arg->l, assign_local);
 			++i;
 
 			if (!(arg->chflg & node_child_c)) {
@@ -898,45 +902,155 @@ const struct func_impl *func_tbl[obj_type_count][language_mode_count] = {
 	[obj_module] = { impl_tbl_module, }
 };
 
+/*
+ * Every impl table is indexed once at startup.  Its entries are copied into
+ * func_impl_index sorted by name, and func_impl_groups maps the table to its
+ * (offset, length) in the index so that lookups can binary search it.  An
+ * impl's position in the index + 1 is a stable id that call nodes use to
+ * cache their resolved function.
+ */
+static struct arr func_impl_index;
+static struct hash func_impl_groups;
+
+static int
+func_impl_cmp(const void *_a, const void *_b)
+{
+	const struct func_impl *const *a = _a, *const *b = _b;
+	return strcmp((*a)->name, (*b)->name);
+}
+
+static void
+func_impl_tbl_index(const struct func_impl *impl_tbl)
+{
+	if (!impl_tbl || hash_get(&func_impl_groups, &impl_tbl)) {
+		return;
+	}
+
+	uint32_t i, off = func_impl_index.len;
+	for (i = 0; impl_tbl[i].name; ++i) {
+		const struct func_impl *fi = &impl_tbl[i];
+		arr_push(&func_impl_index, &fi);
+	}
+
+	qsort(arr_get(&func_impl_index, off), i, func_impl_index.item_size, func_impl_cmp);
+
+	hash_set(&func_impl_groups, &impl_tbl, ((uint64_t)off << 32) | i);
+}
+
+static void
+func_impl_tbls_index(const struct func_impl **impl_tbl)
+{
+	uint32_t i;
+	for (i = 0; i < language_mode_count; ++i) {
+		func_impl_tbl_index(impl_tbl[i]);
+	}
+}
+
 void
 build_func_impl_tables(void)
 {
 	both_libs_build_impl_tbl();
 	python_build_impl_tbl();
+
+	arr_init(&func_impl_index, 1024, sizeof(const struct func_impl *));
+	hash_init(&func_impl_groups, 256, sizeof(const struct func_impl *));
+
+	uint32_t i;
+	func_impl_tbls_index(kernel_func_tbl);
+	for (i = 0; i < obj_type_count; ++i) {
+		func_impl_tbls_index(func_tbl[i]);
+	}
+	for (i = 0; i < module_count; ++i) {
+		func_impl_tbls_index(module_func_tbl[i]);
+	}
 }
 
 static const struct func_impl *
+func_impl_get(uint32_t id)
+{
+	return *(const struct func_impl **)arr_get(&func_impl_index, id - 1);
+}
+
+static uint32_t
 func_lookup_for_mode(const struct func_impl *impl_tbl, const char *name)
 {
 	if (!impl_tbl) {
-		return NULL;
+		return 0;
 	}
 
-	uint32_t i;
-	for (i = 0; impl_tbl[i].name; ++i) {
-		if (strcmp(impl_tbl[i].name, name) == 0) {
-			return &impl_tbl[i];
+	const uint64_t *group;
+	if (!(group = hash_get(&func_impl_groups, &impl_tbl))) {
+		UNREACHABLE_RETURN;
+	}
+
+	uint32_t lo = *group >> 32, hi = lo + (uint32_t)*group;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		int32_t cmp = strcmp(name, func_impl_get(mid + 1)->name);
+
+		if (cmp == 0) {
+			return mid + 1;
+		} else if (cmp < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
 		}
 	}
 
-	return NULL;
+	return 0;
 }
 
-const struct func_impl *
-func_lookup(const struct func_impl **impl_tbl, enum language_mode mode, const char *name)
+static uint32_t
+func_lookup_id(const struct func_impl **impl_tbl, enum language_mode mode, const char *name)
 {
 	if (mode == language_extended) {
-		const struct func_impl *r;
-		if ((r = func_lookup_for_mode(impl_tbl[language_internal], name))) {
-			return r;
+		uint32_t id;
+		if ((id = func_lookup_for_mode(impl_tbl[language_internal], name))) {
+			return id;
 		}
 
 		return func_lookup_for_mode(impl_tbl[language_external], name);
 	} else {
 		return func_lookup_for_mode(impl_tbl[mode], name);
 	}
+}
+
+const struct func_impl *
+func_lookup(const struct func_impl **impl_tbl, enum language_mode mode, const char *name)
+{
+	uint32_t id;
+	if (!(id = func_lookup_id(impl_tbl, mode, name))) {
+		return NULL;
+	}
 
-	return NULL;
+	return func_impl_get(id);
+}
+
+/*
+ * The name node of a function or method call is a node_id, which leaves its r
+ * and c fields unused.  The id of the resolved impl is stored in r, and the
+ * receiver type and language mode it was resolved for in c, so that
+ * evaluating the same call again skips name resolution entirely.
+ */
+const struct func_impl *
+func_lookup_node(struct workspace *wk, const struct func_impl **impl_tbl, enum obj_type rcvr_type, uint32_t name_node)
+{
+	struct node *n = get_node(wk->ast, name_node);
+	assert(n->type == node_id);
+
+	uint32_t key = ((rcvr_type << 8) | wk->lang_mode) + 1;
+	if (n->c == key) {
+		return func_impl_get(n->r);
+	}
+
+	uint32_t id;
+	if (!(id = func_lookup_id(impl_tbl, wk->lang_mode, n->dat.s))) {
+		return NULL;
+	}
+
+	n->r = id;
+	n->c = key;
+	return func_impl_get(id);
 }
 
 const char *
@@ -1029,7 +1143,7 @@ builtin_run(struct workspace *wk, bool have_rcvr, obj rcvr_id, uint32_t node_id,
 			return false;
 		}
 
-		fi = func_lookup(impl_tbl, wk->lang_mode, name);
+		fi = func_lookup_node(wk, impl_tbl, rcvr_type, name_node);
 
 		if (!fi) {
 			if (rcvr_type == obj_disabler) {
@@ -1057,6 +1171,11 @@ builtin_run(struct workspace *wk, bool have_rcvr, obj rcvr_id, uint32_t node_id,
 	TracyCZoneName(tctx_func, func_name, strlen(func_name));
 #endif
 
+	if (profile_enabled()) {
+		profile_begin_detail("func", func_name_str(have_rcvr, rcvr_type, name),
+			"%s:%d", wk->src->label, get_node(wk->ast, name_node)->line);
+	}
+
 	bool func_res;
 
 	if (fi) {
@@ -1065,6 +1184,7 @@ builtin_run(struct workspace *wk, bool have_rcvr, obj rcvr_id, uint32_t node_id,
 		func_res = func_obj_eval(wk, func_obj, func_module, args_node, res);
 	}
 
+	profile_end();
 	TracyCZoneEnd(tctx_func);
 
 	if (!func_res) {
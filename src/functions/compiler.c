@@ -15,6 +15,7 @@
 
 #include "args.h"
 #include "backend/common_args.h"
+#include "cache.h"
 #include "coerce.h"
 #include "compilers.h"
 #include "error.h"
@@ -26,9 +27,12 @@
 #include "lang/typecheck.h"
 #include "log.h"
 #include "platform/filesystem.h"
+#include "platform/mem.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
+#include "profile.h"
 #include "sha_256.h"
+#include "toolchain_cache.h"
 
 enum compile_mode {
 	compile_mode_preprocess,
@@ -128,7 +132,7 @@ add_include_directory_args(struct workspace *wk, struct args_kw *inc, struct bui
 
 static bool
 compiler_check_cache(struct workspace *wk, struct obj_compiler *comp,
-	const char *argstr, uint32_t argc, const char *src,
+	enum compile_mode mode, const char *argstr, uint32_t argc, const char *src,
 	uint8_t sha_res[32], bool *res, obj *res_val)
 {
 	uint32_t argstr_len;
@@ -150,7 +154,8 @@ compiler_check_cache(struct workspace *wk, struct obj_compiler *comp,
 		sha_idx_argstr = 0,
 		sha_idx_ver = sha_idx_argstr + 32,
 		sha_idx_src = sha_idx_ver + 32,
-		sha_len = sha_idx_src + 32
+		sha_idx_mode = sha_idx_src + 32,
+		sha_len = sha_idx_mode + 1
 	};
 
 	uint8_t sha[sha_len] = { 0 };
@@ -164,6 +169,10 @@ compiler_check_cache(struct workspace *wk, struct obj_compiler *comp,
 
 	calc_sha_256(&sha[sha_idx_src], src, strlen(src));
 
+	// the scratch source and output paths are not part of the key, so
+	// the mode has to be
+	sha[sha_idx_mode] = mode;
+
 	calc_sha_256(sha_res, sha, sha_len);
 
 	/* LLOG_I("sha: "); */
@@ -211,19 +220,148 @@ set_compiler_cache(struct workspace *wk, obj key, bool res, obj val)
 	}
 }
 
+#define COMPILER_CHECK_SHARED_CACHE_NS "compiler_check"
+
+/*
+ * Compiler check results are only valid for the compiler they were obtained
+ * with, so keys into the shared cache are built like the keys of toolchain
+ * commands, from the files in the compiler's command line and the
+ * environment.
+ */
 static bool
-compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
-	const char *src, uint32_t err_node, bool *res)
+compiler_check_shared_cache_key(struct workspace *wk, struct obj_compiler *comp,
+	const uint8_t sha[32], uint8_t sha_res[32])
+{
+	return toolchain_cache_key(wk, &(struct str) { .s = (const char *)sha, .len = 32 }, comp->cmd_arr, sha_res);
+}
+
+static bool
+compiler_check_shared_cache(struct workspace *wk, struct obj_compiler *comp,
+	obj key, bool *res, obj *res_val)
 {
-	enum requirement_type req = requirement_auto;
+	uint8_t sha[32];
+	if (!compiler_check_shared_cache_key(wk, comp, (const uint8_t *)get_str(wk, key)->s, sha)) {
+		return false;
+	}
+
+	obj arr, cache_res = 0;
+	if (cache_get(wk, COMPILER_CHECK_SHARED_CACHE_NS, sha, &arr)
+	    && get_obj_type(wk, arr) == obj_array
+	    && get_obj_array(wk, arr)->len == 2) {
+		obj_array_index(wk, arr, 0, &cache_res);
+	}
+
+	if (!cache_res || get_obj_type(wk, cache_res) != obj_bool) {
+		obj_dict_set(wk, wk->compiler_check_shared_keys, key, make_strn(wk, (const char *)sha, 32));
+		return false;
+	}
+
+	*res = get_obj_bool(wk, cache_res);
+	obj_array_index(wk, arr, 1, res_val);
+	obj_dict_set(wk, wk->compiler_check_cache, key, arr);
+	return true;
+}
+
+static enum iteration_result
+compiler_check_cache_persist_iter(struct workspace *wk, void *_ctx, obj key, obj shared_key)
+{
+	uint32_t *written = _ctx;
+
+	obj arr;
+	if (!obj_dict_index(wk, wk->compiler_check_cache, key, &arr)) {
+		return ir_cont;
+	}
+
+	if (!cache_set(wk, COMPILER_CHECK_SHARED_CACHE_NS, (const uint8_t *)get_str(wk, shared_key)->s, arr)) {
+		LOG_W("failed to write shared compiler check cache");
+		return ir_done;
+	}
+
+	++*written;
+	return ir_cont;
+}
+
+/*
+ * Write the results of compiler checks that weren't found in the shared cache
+ * back to it.  Failing to do so isn't fatal, since the results are also
+ * stored in the build dir's own cache.
+ */
+void
+compiler_check_cache_persist(struct workspace *wk)
+{
+	if (!wk->compiler_check_shared_cache) {
+		return;
+	}
+
+	uint32_t written = 0;
+	obj_dict_foreach(wk, wk->compiler_check_shared_keys, &written, compiler_check_cache_persist_iter);
+
+	// the cache can only have grown if something was written
+	if (!written) {
+		return;
+	}
+
+	if (!cache_evict(wk, COMPILER_CHECK_SHARED_CACHE_NS, CACHE_DEFAULT_MAX_SIZE)) {
+		LOG_W("failed to evict old entries from the shared compiler check cache");
+	}
+}
+
+enum compiler_check_job_state {
+	compiler_check_job_state_done,
+	compiler_check_job_state_pending,
+	compiler_check_job_state_running,
+};
+
+/*
+ * A compiler check that is scheduled by compiler_check_run_jobs().  Each job
+ * in a set of jobs gets its own scratch source and output file in
+ * muon_private, so that jobs can be compiled concurrently.
+ */
+struct compiler_check_job {
+	struct compiler_check_opts *opts;
+	const char *src;
+	uint32_t err_node;
+	bool *res;
+
+	enum compiler_check_job_state state;
+	enum requirement_type req;
+	obj source_path;
+	const char *output_path;
+	const char *argstr;
+	uint32_t argc;
+	struct run_cmd_ctx cmd_ctx;
+	uint64_t profile_start;
+	uint32_t profile_lane;
+};
+
+static bool
+compiler_check_required(struct workspace *wk, struct compiler_check_job *job)
+{
+	if (!*job->res && job->req == requirement_required) {
+		assert(job->opts->required);
+		interp_error(wk, job->opts->required->node, "a required compiler check failed");
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+compiler_check_prepare(struct workspace *wk, struct compiler_check_job *job, uint32_t slot)
+{
+	struct compiler_check_opts *opts = job->opts;
+
+	job->state = compiler_check_job_state_done;
+	*job->res = false;
+
+	job->req = requirement_auto;
 	if (opts->required && opts->required->set) {
-		if (!coerce_requirement(wk, opts->required, &req)) {
+		if (!coerce_requirement(wk, opts->required, &job->req)) {
 			return false;
 		}
 	}
 
-	if (req == requirement_skip) {
-		*res = false;
+	if (job->req == requirement_skip) {
 		return true;
 	}
 
@@ -279,33 +417,9 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
 		break;
 	}
 
-	obj source_path;
-	if (opts->src_is_path) {
-		source_path = make_str(wk, src);
-	} else {
-		SBUF(test_source_path);
-		path_join(wk, &test_source_path, wk->muon_private, "test.");
-		sbuf_pushs(wk, &test_source_path, compiler_language_extension(comp->lang));
-		source_path = sbuf_into_str(wk, &test_source_path);
-	}
-
-	obj_array_push(wk, compiler_args, source_path);
-
-	SBUF(test_output_path);
-	const char *output_path;
-	if (opts->output_path) {
-		output_path = opts->output_path;
-	} else if (opts->mode == compile_mode_run) {
-		path_join(wk, &test_output_path, wk->muon_private, "compiler_check_exe");
-		output_path = test_output_path.buf;
-	} else {
-		path_join(wk, &test_output_path, wk->muon_private, "test.");
-		sbuf_pushs(wk, &test_output_path, compiler_language_extension(comp->lang));
-		sbuf_pushs(wk, &test_output_path, compilers[t].object_ext);
-		output_path = test_output_path.buf;
-	}
-
-	push_args(wk, compiler_args, compilers[t].args.output(output_path));
+	// arguments that come after the source and output paths
+	obj trailing_args;
+	make_obj(wk, &trailing_args, obj_array);
 
 	if (have_dep) {
 		struct setup_linker_args_ctx sctx = {
@@ -315,48 +429,149 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
 		};
 
 		setup_linker_args(wk, NULL, NULL, &sctx);
-		obj_array_extend_nodup(wk, compiler_args, dep.link_args);
+		obj_array_extend_nodup(wk, trailing_args, dep.link_args);
 	}
 
 	if (opts->args) {
-		obj_array_extend(wk, compiler_args, opts->args);
+		obj_array_extend(wk, trailing_args, opts->args);
 	}
 
-	bool ret = false;
-	struct run_cmd_ctx cmd_ctx = { 0 };
+	{
+		obj key_args;
+		obj_array_dup(wk, compiler_args, &key_args);
+		obj_array_extend(wk, key_args, trailing_args);
+
+		const char *argstr;
+		uint32_t argc;
+		join_args_argstr(wk, &argstr, &argc, key_args);
+
+		uint8_t sha[32];
+		if (compiler_check_cache(wk, comp, opts->mode, argstr, argc, job->src, sha, job->res, &opts->cache_val)) {
+			opts->from_cache = true;
+			return compiler_check_required(wk, job);
+		}
 
-	const char *argstr;
-	uint32_t argc;
-	join_args_argstr(wk, &argstr, &argc, compiler_args);
+		opts->cache_key = make_strn(wk, (const char *)sha, 32);
 
-	uint8_t sha[32];
-	if (compiler_check_cache(wk, comp, argstr, argc, src, sha, res, &opts->cache_val)) {
-		opts->from_cache = true;
-		return true;
+		// checks of files rather than strings are keyed by the file's path
+		// only, which isn't safe to share between build dirs
+		if (wk->compiler_check_shared_cache && !opts->src_is_path
+		    && compiler_check_shared_cache(wk, comp, opts->cache_key, job->res, &opts->cache_val)) {
+			opts->from_cache = true;
+			return compiler_check_required(wk, job);
+		}
 	}
 
-	opts->cache_key = make_strn(wk, (const char *)sha, 32);
+	if (opts->src_is_path) {
+		job->source_path = make_str(wk, job->src);
+	} else {
+		SBUF(test_source_path);
+		path_join(wk, &test_source_path, wk->muon_private, "test");
+		sbuf_pushf(wk, &test_source_path, "%d.%s", slot, compiler_language_extension(comp->lang));
+		job->source_path = sbuf_into_str(wk, &test_source_path);
+	}
+
+	obj_array_push(wk, compiler_args, job->source_path);
+
+	if (opts->output_path) {
+		job->output_path = opts->output_path;
+	} else {
+		SBUF(test_output_path);
+		if (opts->mode == compile_mode_run) {
+			path_join(wk, &test_output_path, wk->muon_private, "compiler_check_exe");
+			sbuf_pushf(wk, &test_output_path, "%d", slot);
+		} else {
+			path_join(wk, &test_output_path, wk->muon_private, "test");
+			sbuf_pushf(wk, &test_output_path, "%d.%s%s", slot,
+				compiler_language_extension(comp->lang), compilers[t].object_ext);
+		}
+		job->output_path = get_cstr(wk, sbuf_into_str(wk, &test_output_path));
+	}
 
-	if (!opts->src_is_path) {
-		if (!fs_write(get_cstr(wk, source_path), (const uint8_t *)src, strlen(src))) {
+	push_args(wk, compiler_args, compilers[t].args.output(job->output_path));
+
+	obj_array_extend_nodup(wk, compiler_args, trailing_args);
+
+	join_args_argstr(wk, &job->argstr, &job->argc, compiler_args);
+
+	job->state = compiler_check_job_state_pending;
+	return true;
+}
+
+/*
+ * Concurrent checks are profiled on separate lanes, the lowest one that isn't
+ * used by another running check.
+ */
+static uint32_t
+compiler_check_profile_lane(struct compiler_check_job *jobs, uint32_t len)
+{
+	uint32_t lane, i;
+	for (lane = 1;; ++lane) {
+		for (i = 0; i < len; ++i) {
+			if (jobs[i].state == compiler_check_job_state_running && jobs[i].profile_lane == lane) {
+				break;
+			}
+		}
+
+		if (i == len) {
+			return lane;
+		}
+	}
+}
+
+static void
+compiler_check_profile(struct workspace *wk, struct compiler_check_job *job)
+{
+	static const char *mode_names[] = {
+		[compile_mode_preprocess] = "preprocess check",
+		[compile_mode_compile] = "compile check",
+		[compile_mode_link] = "link check",
+		[compile_mode_run] = "run check",
+	};
+
+	profile_record("compiler_check", job->profile_lane, job->profile_start,
+		mode_names[job->opts->mode], "%s:%d", wk->src->label, get_node(wk->ast, job->err_node)->line);
+}
+
+static bool
+compiler_check_start(struct workspace *wk, struct compiler_check_job *job)
+{
+	if (!job->opts->src_is_path) {
+		if (!fs_write(get_cstr(wk, job->source_path), (const uint8_t *)job->src, strlen(job->src))) {
 			return false;
 		}
 	}
 
-	L("compiling: '%s'", get_cstr(wk, source_path));
+	L("compiling: '%s'", get_cstr(wk, job->source_path));
 
-	if (!run_cmd(&cmd_ctx, argstr, argc, NULL, 0)) {
-		interp_error(wk, err_node, "error: %s", cmd_ctx.err_msg);
-		goto ret;
+	job->cmd_ctx = (struct run_cmd_ctx) { .flags = run_cmd_ctx_flag_async };
+	job->profile_start = profile_now();
+
+	if (!run_cmd(&job->cmd_ctx, job->argstr, job->argc, NULL, 0)) {
+		interp_error(wk, job->err_node, "error: %s", job->cmd_ctx.err_msg);
+		run_cmd_ctx_destroy(&job->cmd_ctx);
+		return false;
 	}
 
-	L("compiler stdout: '%s'", cmd_ctx.err.buf);
-	L("compiler stderr: '%s'", cmd_ctx.out.buf);
+	job->state = compiler_check_job_state_running;
+	return true;
+}
+
+static bool
+compiler_check_complete(struct workspace *wk, struct compiler_check_job *job)
+{
+	struct compiler_check_opts *opts = job->opts;
+	bool ret = false;
+
+	job->state = compiler_check_job_state_done;
+	compiler_check_profile(wk, job);
+
+	L("compiler stdout: '%s'", job->cmd_ctx.out.buf);
+	L("compiler stderr: '%s'", job->cmd_ctx.err.buf);
 
 	if (opts->mode == compile_mode_run) {
-		if (cmd_ctx.status != 0) {
+		if (job->cmd_ctx.status != 0) {
 			if (opts->skip_run_check) {
-				*res = false;
 				ret = true;
 				goto ret;
 			} else {
@@ -365,7 +580,7 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
 			}
 		}
 
-		if (!run_cmd_argv(&opts->cmd_ctx, (char *const []){ (char *)output_path, NULL }, NULL, 0)) {
+		if (!run_cmd_argv(&opts->cmd_ctx, (char *const []){ (char *)job->output_path, NULL }, NULL, 0)) {
 			LOG_W("compiled binary failed to run: %s", opts->cmd_ctx.err_msg);
 			run_cmd_ctx_destroy(&opts->cmd_ctx);
 			goto ret;
@@ -375,26 +590,226 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
 			goto ret;
 		}
 
-		*res = true;
+		*job->res = true;
 	} else {
-		*res = cmd_ctx.status == 0;
+		*job->res = job->cmd_ctx.status == 0;
 	}
 
 	// store wether or not the check suceeded in the cache, the caller is
 	// responsible for storing the actual value
-	set_compiler_cache(wk, opts->cache_key, *res, 0);
+	set_compiler_cache(wk, opts->cache_key, *job->res, 0);
 
 	ret = true;
 ret:
-	run_cmd_ctx_destroy(&cmd_ctx);
-	if (!*res && req == requirement_required) {
-		assert(opts->required);
-		interp_error(wk, opts->required->node, "a required compiler check failed");
+	run_cmd_ctx_destroy(&job->cmd_ctx);
+	if (!compiler_check_required(wk, job)) {
 		return false;
 	}
 	return ret;
 }
 
+static void
+compiler_check_wait(struct compiler_check_job *jobs, uint32_t len)
+{
+	struct run_cmd_ctx *running[64];
+	uint32_t i, n = 0;
+
+	for (i = 0; i < len && n < ARRAY_LEN(running); ++i) {
+		if (jobs[i].state == compiler_check_job_state_running) {
+			running[n++] = &jobs[i].cmd_ctx;
+		}
+	}
+
+	run_cmd_wait(running, n, RUN_CMD_WAIT_MAX);
+}
+
+/*
+ * Some builtins only need the result of the first check, in order, that
+ * passes or fails.  Once that is known, no more checks are started.
+ */
+enum compiler_check_stop {
+	compiler_check_stop_never,
+	compiler_check_stop_on_pass,
+	compiler_check_stop_on_fail,
+};
+
+static bool
+compiler_check_answered(struct compiler_check_job *jobs, uint32_t len, enum compiler_check_stop stop)
+{
+	if (stop == compiler_check_stop_never) {
+		return false;
+	}
+
+	uint32_t i;
+	for (i = 0; i < len; ++i) {
+		if (jobs[i].state != compiler_check_job_state_done) {
+			return false;
+		} else if (*jobs[i].res == (stop == compiler_check_stop_on_pass)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Run a set of independent compiler checks, compiling up to
+ * wk->compiler_check_jobs of them at a time.  Results are written to each
+ * job's res as checks finish, and callers should not depend on the order in
+ * which that happens.  If stop says so, jobs after the first one that
+ * passes or fails may never run.
+ */
+static bool
+compiler_check_run_jobs(struct workspace *wk, struct compiler_check_job *jobs, uint32_t len, enum compiler_check_stop stop)
+{
+	uint32_t i;
+	for (i = 0; i < len; ++i) {
+		if (!compiler_check_prepare(wk, &jobs[i], i)) {
+			return false;
+		}
+	}
+
+	bool ok = true;
+	uint32_t next = 0, running = 0, max_running = wk->compiler_check_jobs ? wk->compiler_check_jobs : 1;
+
+	while (true) {
+		if (compiler_check_answered(jobs, len, stop)) {
+			next = len;
+		}
+
+		for (; ok && next < len && running < max_running; ++next) {
+			if (jobs[next].state != compiler_check_job_state_pending) {
+				continue;
+			}
+
+			if (profile_enabled()) {
+				jobs[next].profile_lane = compiler_check_profile_lane(jobs, next);
+			}
+
+			if (!compiler_check_start(wk, &jobs[next])) {
+				ok = false;
+				break;
+			}
+
+			++running;
+		}
+
+		if (!running) {
+			break;
+		}
+
+		for (i = 0; i < next; ++i) {
+			if (jobs[i].state != compiler_check_job_state_running) {
+				continue;
+			}
+
+			switch (run_cmd_collect(&jobs[i].cmd_ctx)) {
+			case run_cmd_running:
+				continue;
+			case run_cmd_error:
+				interp_error(wk, jobs[i].err_node, "error: %s", jobs[i].cmd_ctx.err_msg);
+				run_cmd_ctx_destroy(&jobs[i].cmd_ctx);
+				jobs[i].state = compiler_check_job_state_done;
+				ok = false;
+				break;
+			case run_cmd_finished:
+				if (!compiler_check_complete(wk, &jobs[i])) {
+					ok = false;
+				}
+				break;
+			}
+
+			--running;
+		}
+
+		if (running) {
+			compiler_check_wait(jobs, next);
+		}
+	}
+
+	return ok;
+}
+
+static bool
+compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
+	const char *src, uint32_t err_node, bool *res)
+{
+	struct compiler_check_job job = {
+		.opts = opts,
+		.src = src,
+		.err_node = err_node,
+		.res = res,
+	};
+
+	return compiler_check_run_jobs(wk, &job, 1, compiler_check_stop_never);
+}
+
+/*
+ * Helpers for builtins that perform the same check for every element of an
+ * array, e.g. get_supported_arguments().  Elements are flattened into
+ * batch->elems, the caller fills in the opts and src of each job, and then
+ * all of them are run at once.
+ */
+struct compiler_check_batch_elem {
+	struct compiler_check_opts opts;
+	obj val;
+	bool res;
+};
+
+struct compiler_check_batch {
+	struct arr elems;
+	struct compiler_check_job *jobs;
+	uint32_t len;
+	enum compiler_check_stop stop;
+};
+
+static enum iteration_result
+compiler_check_batch_init_iter(struct workspace *wk, void *_ctx, obj val)
+{
+	struct compiler_check_batch *batch = _ctx;
+
+	arr_push(&batch->elems, &(struct compiler_check_batch_elem) { .val = val });
+	return ir_cont;
+}
+
+static void
+compiler_check_batch_init(struct workspace *wk, struct compiler_check_batch *batch, obj arr)
+{
+	*batch = (struct compiler_check_batch) { 0 };
+	arr_init(&batch->elems, 16, sizeof(struct compiler_check_batch_elem));
+
+	obj_array_foreach_flat(wk, arr, batch, compiler_check_batch_init_iter);
+
+	batch->len = batch->elems.len;
+	batch->jobs = z_calloc(batch->len ? batch->len : 1, sizeof(struct compiler_check_job));
+
+	uint32_t i;
+	for (i = 0; i < batch->len; ++i) {
+		struct compiler_check_batch_elem *elem = arr_get(&batch->elems, i);
+		batch->jobs[i].opts = &elem->opts;
+		batch->jobs[i].res = &elem->res;
+	}
+}
+
+static struct compiler_check_batch_elem *
+compiler_check_batch_get(struct compiler_check_batch *batch, uint32_t i)
+{
+	return arr_get(&batch->elems, i);
+}
+
+static bool
+compiler_check_batch_run(struct workspace *wk, struct compiler_check_batch *batch)
+{
+	return compiler_check_run_jobs(wk, batch->jobs, batch->len, batch->stop);
+}
+
+static void
+compiler_check_batch_destroy(struct compiler_check_batch *batch)
+{
+	arr_destroy(&batch->elems);
+	z_free(batch->jobs);
+}
+
 static int64_t
 compiler_check_parse_output_int(struct compiler_check_opts *opts)
 {
@@ -860,28 +1275,6 @@ func_compiler_has_function_attribute(struct workspace *wk, obj rcvr, uint32_t ar
 	return true;
 }
 
-struct func_compiler_get_supported_function_attributes_iter_ctx {
-	uint32_t node;
-	obj arr, compiler;
-};
-
-static enum iteration_result
-func_compiler_get_supported_function_attributes_iter(struct workspace *wk, void *_ctx, obj val_id)
-{
-	struct func_compiler_get_supported_function_attributes_iter_ctx *ctx = _ctx;
-	bool has_fattr;
-
-	if (!compiler_has_function_attribute(wk, ctx->compiler, ctx->node, val_id, &has_fattr)) {
-		return ir_err;
-	}
-
-	if (has_fattr) {
-		obj_array_push(wk, ctx->arr, val_id);
-	}
-
-	return ir_cont;
-}
-
 static bool
 func_compiler_get_supported_function_attributes(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res)
 {
@@ -893,12 +1286,48 @@ func_compiler_get_supported_function_attributes(struct workspace *wk, obj rcvr,
 
 	make_obj(wk, res, obj_array);
 
-	return obj_array_foreach_flat(wk, an[0].val,
-		&(struct func_compiler_get_supported_function_attributes_iter_ctx) {
-		.compiler = rcvr,
-		.arr = *res,
-		.node = an[0].node,
-	}, func_compiler_get_supported_function_attributes_iter);
+	bool ret = false;
+	struct compiler_check_batch batch;
+	compiler_check_batch_init(wk, &batch, an[0].val);
+
+	uint32_t i;
+	for (i = 0; i < batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = compiler_check_batch_get(&batch, i);
+		elem->opts = (struct compiler_check_opts) {
+			.mode = compile_mode_compile,
+			.comp_id = rcvr,
+		};
+
+		if (!get_has_function_attribute_test(get_str(wk, elem->val), &batch.jobs[i].src)) {
+			interp_error(wk, an[0].node, "unknown attribute '%s'", get_cstr(wk, elem->val));
+			goto ret;
+		}
+
+		batch.jobs[i].err_node = an[0].node;
+	}
+
+	if (!compiler_check_batch_run(wk, &batch)) {
+		goto ret;
+	}
+
+	for (i = 0; i < batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = compiler_check_batch_get(&batch, i);
+
+		compiler_check_log(wk, &elem->opts,
+			"has attribute %s: %s",
+			get_cstr(wk, elem->val),
+			bool_to_yn(elem->res)
+			);
+
+		if (elem->res) {
+			obj_array_push(wk, *res, elem->val);
+		}
+	}
+
+	ret = true;
+ret:
+	compiler_check_batch_destroy(&batch);
+	return ret;
 }
 
 static bool
@@ -1471,14 +1900,10 @@ func_compiler_has_type(struct workspace *wk, obj rcvr, uint32_t args_node, obj *
 	return true;
 }
 
-static bool
-compiler_has_member(struct workspace *wk, struct compiler_check_opts *opts,
-	uint32_t err_node, const char *prefix, obj target, obj member, bool *res)
+static const char *
+compiler_has_member_src(struct workspace *wk, const char *prefix, obj target, obj member)
 {
-	opts->mode = compile_mode_compile;
-
-	char src[BUF_SIZE_4k];
-	snprintf(src, BUF_SIZE_4k,
+	return get_cstr(wk, make_strf(wk,
 		"%s\n"
 		"void bar(void) {\n"
 		"%s foo;\n"
@@ -1487,19 +1912,29 @@ compiler_has_member(struct workspace *wk, struct compiler_check_opts *opts,
 		prefix,
 		get_cstr(wk, target),
 		get_cstr(wk, member)
-		);
-
-	if (!compiler_check(wk, opts, src, err_node, res)) {
-		return false;
-	}
+		));
+}
 
+static void
+compiler_has_member_log(struct workspace *wk, struct compiler_check_opts *opts, obj target, obj member, bool res)
+{
 	compiler_check_log(wk, opts,
 		"struct %s has member %s: %s",
 		get_cstr(wk, target),
 		get_cstr(wk, member),
-		bool_to_yn(*res)
+		bool_to_yn(res)
 		);
+}
+
+static bool
+compiler_has_member(struct workspace *wk, struct compiler_check_opts *opts,
+	uint32_t err_node, const char *prefix, obj target, obj member, bool *res)
+{
+	if (!compiler_check(wk, opts, compiler_has_member_src(wk, prefix, target, member), err_node, res)) {
+		return false;
+	}
 
+	compiler_has_member_log(wk, opts, target, member, *res);
 	return true;
 }
 
@@ -1508,7 +1943,7 @@ func_compiler_has_member(struct workspace *wk, obj rcvr, uint32_t args_node, obj
 {
 	struct args_norm an[] = { { obj_string }, { obj_string }, ARG_TYPE_NULL };
 	struct args_kw *akw;
-	struct compiler_check_opts opts = { 0 };
+	struct compiler_check_opts opts = { .mode = compile_mode_compile };
 
 	if (!func_compiler_check_args_common(wk, rcvr, args_node, an, &akw, &opts,
 		cm_kw_args | cm_kw_dependencies | cm_kw_prefix
@@ -1527,43 +1962,12 @@ func_compiler_has_member(struct workspace *wk, obj rcvr, uint32_t args_node, obj
 	return true;
 }
 
-struct compiler_has_members_ctx {
-	struct compiler_check_opts *opts;
-	uint32_t node;
-	const char *prefix;
-	obj target;
-	bool ok;
-};
-
-static enum iteration_result
-compiler_has_members_iter(struct workspace *wk, void *_ctx, obj val)
-{
-	struct compiler_has_members_ctx *ctx = _ctx;
-
-	if (!typecheck(wk, ctx->node, val, obj_string)) {
-		return ir_err;
-	}
-
-	bool ok;
-	if (!compiler_has_member(wk, ctx->opts, ctx->node,
-		ctx->prefix, ctx->target, val, &ok)) {
-		return ir_err;
-	}
-
-	if (!ok) {
-		ctx->ok = false;
-		return ir_done;
-	}
-
-	return ir_cont;
-}
-
 static bool
 func_compiler_has_members(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res)
 {
 	struct args_norm an[] = { { obj_string }, { TYPE_TAG_GLOB | obj_string }, ARG_TYPE_NULL };
 	struct args_kw *akw;
-	struct compiler_check_opts opts = { 0 };
+	struct compiler_check_opts opts = { .mode = compile_mode_compile };
 
 	if (!func_compiler_check_args_common(wk, rcvr, args_node, an, &akw, &opts,
 		cm_kw_args | cm_kw_dependencies | cm_kw_prefix
@@ -1576,22 +1980,44 @@ func_compiler_has_members(struct workspace *wk, obj rcvr, uint32_t args_node, ob
 		return false;
 	}
 
-	struct compiler_has_members_ctx ctx = {
-		.opts = &opts,
-		.node = an[0].node,
-		.prefix = compiler_check_prefix(wk, akw),
-		.target = an[0].val,
-		.ok = true,
-	};
+	const char *prefix = compiler_check_prefix(wk, akw);
 
-	if (!obj_array_foreach_flat(wk, an[1].val, &ctx, compiler_has_members_iter)) {
-		return false;
+	bool ret = false, ok = true;
+	struct compiler_check_batch batch;
+	compiler_check_batch_init(wk, &batch, an[1].val);
+
+	uint32_t i;
+	for (i = 0; i < batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = compiler_check_batch_get(&batch, i);
+		elem->opts = opts;
+		batch.jobs[i].src = compiler_has_member_src(wk, prefix, an[0].val, elem->val);
+		batch.jobs[i].err_node = an[0].node;
+	}
+
+	batch.stop = compiler_check_stop_on_fail;
+
+	if (!compiler_check_batch_run(wk, &batch)) {
+		goto ret;
+	}
+
+	for (i = 0; i < batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = compiler_check_batch_get(&batch, i);
+
+		compiler_has_member_log(wk, &elem->opts, an[0].val, elem->val, elem->res);
+
+		if (!elem->res) {
+			ok = false;
+			break;
+		}
 	}
 
 	make_obj(wk, res, obj_bool);
-	set_obj_bool(wk, *res, ctx.ok);
-	return true;
+	set_obj_bool(wk, *res, ok);
 
+	ret = true;
+ret:
+	compiler_check_batch_destroy(&batch);
+	return ret;
 }
 
 static bool
@@ -1665,67 +2091,84 @@ func_compiler_run(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res)
 	return true;
 }
 
-static bool
-compiler_has_argument(struct workspace *wk, obj comp_id, uint32_t err_node, obj arg, bool *has_argument, enum compile_mode mode)
+static void
+compiler_has_argument_opts(struct workspace *wk, obj comp_id, obj *arg, enum compile_mode mode, struct compiler_check_opts *opts)
 {
 	struct obj_compiler *comp = get_obj_compiler(wk, comp_id);
 	enum compiler_type t = comp->type;
 
 	obj args;
 	make_obj(wk, &args, obj_array);
-	if (get_obj_type(wk, arg) == obj_string) {
-		obj_array_push(wk, args, arg);
+	if (get_obj_type(wk, *arg) == obj_string) {
+		obj_array_push(wk, args, *arg);
 	} else {
-		obj_array_extend(wk, args, arg);
+		obj_array_extend(wk, args, *arg);
 
 		obj str;
-		obj_array_join(wk, true, arg, make_str(wk, " "), &str);
-		arg = str;
+		obj_array_join(wk, true, *arg, make_str(wk, " "), &str);
+		*arg = str;
 	}
 
 	push_args(wk, args, compilers[t].args.werror());
 
-	struct compiler_check_opts opts = {
+	*opts = (struct compiler_check_opts) {
 		.mode = mode,
 		.comp_id = comp_id,
 		.args = args,
 	};
+}
 
-	const char *src = "int main(void){}\n";
-	if (!compiler_check(wk, &opts, src, err_node, has_argument)) {
-		return false;
-	}
+static const char *compiler_has_argument_src = "int main(void){}\n";
 
-	compiler_check_log(wk, &opts,
+static void
+compiler_has_argument_log(struct workspace *wk, struct compiler_check_opts *opts, obj arg, bool has_argument)
+{
+	compiler_check_log(wk, opts,
 		"supports argument '%s': %s",
 		get_cstr(wk, arg),
-		bool_to_yn(*has_argument)
+		bool_to_yn(has_argument)
 		);
+}
+
+static bool
+compiler_has_argument(struct workspace *wk, obj comp_id, uint32_t err_node, obj arg, bool *has_argument, enum compile_mode mode)
+{
+	struct compiler_check_opts opts;
+	compiler_has_argument_opts(wk, comp_id, &arg, mode, &opts);
 
+	if (!compiler_check(wk, &opts, compiler_has_argument_src, err_node, has_argument)) {
+		return false;
+	}
+
+	compiler_has_argument_log(wk, &opts, arg, *has_argument);
 	return true;
 }
 
-struct func_compiler_get_supported_arguments_iter_ctx {
-	uint32_t node;
-	obj arr, compiler;
-	enum compile_mode mode;
-};
-
-static enum iteration_result
-func_compiler_get_supported_arguments_iter(struct workspace *wk, void *_ctx, obj val_id)
+/*
+ * Check every argument in arr at once.  On success, the caller is
+ * responsible for logging results and destroying the batch.
+ */
+static bool
+compiler_has_arguments(struct workspace *wk, obj comp_id, uint32_t err_node, obj arr,
+	enum compile_mode mode, enum compiler_check_stop stop, struct compiler_check_batch *batch)
 {
-	struct func_compiler_get_supported_arguments_iter_ctx *ctx = _ctx;
-	bool has_argument;
+	compiler_check_batch_init(wk, batch, arr);
+	batch->stop = stop;
 
-	if (!compiler_has_argument(wk, ctx->compiler, ctx->node, val_id, &has_argument, ctx->mode)) {
-		return false;
+	uint32_t i;
+	for (i = 0; i < batch->len; ++i) {
+		struct compiler_check_batch_elem *elem = compiler_check_batch_get(batch, i);
+		compiler_has_argument_opts(wk, comp_id, &elem->val, mode, &elem->opts);
+		batch->jobs[i].src = compiler_has_argument_src;
+		batch->jobs[i].err_node = err_node;
 	}
 
-	if (has_argument) {
-		obj_array_push(wk, ctx->arr, val_id);
+	if (!compiler_check_batch_run(wk, batch)) {
+		compiler_check_batch_destroy(batch);
+		return false;
 	}
 
-	return ir_cont;
+	return true;
 }
 
 static bool
@@ -1781,13 +2224,24 @@ compiler_get_supported_arguments(struct workspace *wk, obj rcvr, uint32_t args_n
 
 	make_obj(wk, res, obj_array);
 
-	return obj_array_foreach_flat(wk, an[0].val,
-		&(struct func_compiler_get_supported_arguments_iter_ctx) {
-		.compiler = rcvr,
-		.arr = *res,
-		.node = an[0].node,
-		.mode = mode,
-	}, func_compiler_get_supported_arguments_iter);
+	struct compiler_check_batch batch;
+	if (!compiler_has_arguments(wk, rcvr, an[0].node, an[0].val, mode, compiler_check_stop_never, &batch)) {
+		return false;
+	}
+
+	uint32_t i;
+	for (i = 0; i < batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = compiler_check_batch_get(&batch, i);
+
+		compiler_has_argument_log(wk, &elem->opts, elem->val, elem->res);
+
+		if (elem->res) {
+			obj_array_push(wk, *res, elem->val);
+		}
+	}
+
+	compiler_check_batch_destroy(&batch);
+	return true;
 }
 
 static bool
@@ -1802,25 +2256,6 @@ func_compiler_get_supported_link_arguments(struct workspace *wk, obj rcvr, uint3
 	return compiler_get_supported_arguments(wk, rcvr, args_node, res, compile_mode_link);
 }
 
-static enum iteration_result
-func_compiler_first_supported_argument_iter(struct workspace *wk, void *_ctx, obj val_id)
-{
-	struct func_compiler_get_supported_arguments_iter_ctx *ctx = _ctx;
-	bool has_argument;
-
-	if (!compiler_has_argument(wk, ctx->compiler, ctx->node, val_id, &has_argument, ctx->mode)) {
-		return false;
-	}
-
-	if (has_argument) {
-		compiler_log(wk, ctx->compiler, "first supported argument: '%s'", get_cstr(wk, val_id));
-		obj_array_push(wk, ctx->arr, val_id);
-		return ir_done;
-	}
-
-	return ir_cont;
-}
-
 static bool
 compiler_first_supported_argument(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res, enum compile_mode mode)
 {
@@ -1832,13 +2267,26 @@ compiler_first_supported_argument(struct workspace *wk, obj rcvr, uint32_t args_
 
 	make_obj(wk, res, obj_array);
 
-	return obj_array_foreach_flat(wk, an[0].val,
-		&(struct func_compiler_get_supported_arguments_iter_ctx) {
-		.compiler = rcvr,
-		.arr = *res,
-		.node = an[0].node,
-		.mode = mode,
-	}, func_compiler_first_supported_argument_iter);
+	struct compiler_check_batch batch;
+	if (!compiler_has_arguments(wk, rcvr, an[0].node, an[0].val, mode, compiler_check_stop_on_pass, &batch)) {
+		return false;
+	}
+
+	uint32_t i;
+	for (i = 0; i < batch.len; ++i) {
+		struct compiler_check_batch_elem *elem = compiler_check_batch_get(&batch, i);
+
+		compiler_has_argument_log(wk, &elem->opts, elem->val, elem->res);
+
+		if (elem->res) {
+			compiler_log(wk, rcvr, "first supported argument: '%s'", get_cstr(wk, elem->val));
+			obj_array_push(wk, *res, elem->val);
+			break;
+		}
+	}
+
+	compiler_check_batch_destroy(&batch);
+	return true;
 }
 
 static bool
@@ -5,33 +5,23 @@
 
 #include "compat.h"
 
-#include "args.h"
 #include "functions/common.h"
 #include "functions/external_program.h"
 #include "guess.h"
 #include "lang/interpreter.h"
 #include "lang/typecheck.h"
 #include "log.h"
-#include "platform/run_cmd.h"
+#include "toolchain_cache.h"
 
 void
 find_program_guess_version(struct workspace *wk, obj cmd_array, obj *ver)
 {
 	*ver = 0;
-	struct run_cmd_ctx cmd_ctx = { 0 };
-	obj args;
-	obj_array_dup(wk, cmd_array, &args);
-	obj_array_push(wk, args, make_str(wk, "--version"));
+	struct toolchain_cmd_result cmd_res;
 
-	const char *argstr;
-	uint32_t argc;
-	join_args_argstr(wk, &argstr, &argc, args);
-
-	if (run_cmd(&cmd_ctx, argstr, argc, NULL, 0) && cmd_ctx.status == 0) {
-		guess_version(wk, cmd_ctx.out.buf, ver);
+	if (toolchain_run_cmd(wk, cmd_array, "--version", &cmd_res) && cmd_res.status == 0) {
+		guess_version(wk, get_cstr(wk, cmd_res.out), ver);
 	}
-
-	run_cmd_ctx_destroy(&cmd_ctx);
 }
 
 
@@ -1658,7 +1658,7 @@ func_set_variable(struct workspace *wk, obj _, uint32_t args_node, obj *res)
 	}
 	disabler_among_args_immunity = false;
 
-	wk->assign_variable(wk, get_cstr(wk, an[0].val), an[1].val, args_node, assign_local);
+	wk->assign_variable(wk, make_sym(wk, get_cstr(wk, an[0].val)), an[1].val, args_node, assign_local);
 	return true;
 }
 
@@ -1670,7 +1670,7 @@ func_unset_variable(struct workspace *wk, obj _, uint32_t args_node, obj *res)
 		return false;
 	}
 
-	const char *varname = get_cstr(wk, an[0].val);
+	obj varname = make_sym(wk, get_cstr(wk, an[0].val));
 	obj _val;
 
 	if (wk->get_variable(wk, varname, &_val, wk->cur_project)) {
@@ -1701,7 +1701,7 @@ func_get_variable(struct workspace *wk, obj _, uint32_t args_node, obj *res)
 		return false;
 	}
 
-	if (!wk->get_variable(wk, get_cstr(wk, an[0].val), res, wk->cur_project)) {
+	if (!wk->get_variable(wk, make_sym(wk, get_cstr(wk, an[0].val)), res, wk->cur_project)) {
 		if (ao[0].set) {
 			*res = ao[0].val;
 		} else {
@@ -1726,7 +1726,7 @@ func_is_variable(struct workspace *wk, obj _, uint32_t args_node, obj *res)
 	obj dont_care;
 
 	make_obj(wk, res, obj_bool);
-	set_obj_bool(wk, *res, wk->get_variable(wk, get_cstr(wk, an[0].val), &dont_care, wk->cur_project));
+	set_obj_bool(wk, *res, wk->get_variable(wk, make_sym(wk, get_cstr(wk, an[0].val)), &dont_care, wk->cur_project));
 	return true;
 }
 
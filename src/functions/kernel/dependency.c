@@ -829,21 +829,6 @@ func_declare_dependency(struct workspace *wk, obj _, uint32_t args_node, obj *re
 	return true;
 }
 
-/*
- */
-
-static bool
-skip_if_present(struct workspace *wk, obj arr, obj val)
-{
-	if (hash_get(&wk->obj_hash, &val)) {
-		return true;
-	}
-
-	hash_set(&wk->obj_hash, &val, true);
-
-	return false;
-}
-
 struct dep_process_includes_ctx {
 	obj dest;
 	enum include_type include_type;
@@ -934,52 +919,54 @@ build_dep_init(struct workspace *wk, struct build_dep *dep)
 	}
 }
 
+/*
+ * Dependencies are merged into ordered sets so that duplicates are dropped as
+ * they are pushed rather than piling up in the destination arrays.  The sets
+ * are seeded with the current contents of the destination, whose arrays are
+ * replaced by the deduplicated ones.
+ */
+struct build_dep_merge {
+	struct build_dep *dest;
+	struct hash visited;
+	struct obj_ordered_set link_with, link_with_not_found, link_whole,
+			       include_directories, rpath, order_deps, sources, objects;
+};
+
 static void
-merge_build_deps(struct workspace *wk, struct build_dep *src, struct build_dep *dest, bool dep)
+build_dep_merge_set_init(struct workspace *wk, struct obj_ordered_set *set, obj *arr)
 {
-	build_dep_init(wk, dest);
-
-	dest->link_language = coalesce_link_languages(src->link_language, dest->link_language);
-
-	if (src->link_with) {
-		obj_array_extend(wk, dest->link_with, src->link_with);
-	}
-
-	if (src->link_with_not_found) {
-		obj_array_extend(wk, dest->link_with_not_found, src->link_with_not_found);
-	}
-
-	if (src->link_whole) {
-		obj_array_extend(wk, dest->link_whole, src->link_whole);
-	}
-
-	if (dep && src->include_directories) {
-		obj_array_extend(wk, dest->include_directories, src->include_directories);
-	}
-
-	if (src->link_args) {
-		obj_array_extend(wk, dest->link_args, src->link_args);
-	}
-
-	if (dep && src->compile_args) {
-		obj_array_extend(wk, dest->compile_args, src->compile_args);
-	}
+	obj_ordered_set_init(wk, set);
+	obj_ordered_set_extend(wk, set, *arr);
+	*arr = set->arr;
+}
 
-	if (src->rpath) {
-		obj_array_extend(wk, dest->rpath, src->rpath);
-	}
+static void
+build_dep_merge_init(struct workspace *wk, struct build_dep_merge *m, struct build_dep *dest)
+{
+	build_dep_init(wk, dest);
 
-	if (src->order_deps) {
-		obj_array_extend(wk, dest->order_deps, src->order_deps);
-	}
+	m->dest = dest;
+	hash_init(&m->visited, 64, sizeof(obj));
+
+	build_dep_merge_set_init(wk, &m->link_with, &dest->link_with);
+	build_dep_merge_set_init(wk, &m->link_with_not_found, &dest->link_with_not_found);
+	build_dep_merge_set_init(wk, &m->link_whole, &dest->link_whole);
+	build_dep_merge_set_init(wk, &m->include_directories, &dest->include_directories);
+	build_dep_merge_set_init(wk, &m->rpath, &dest->rpath);
+	build_dep_merge_set_init(wk, &m->order_deps, &dest->order_deps);
+	build_dep_merge_set_init(wk, &m->sources, &dest->sources);
+	build_dep_merge_set_init(wk, &m->objects, &dest->objects);
+}
 
-	if (dep && src->sources) {
-		obj_array_extend(wk, dest->sources, src->sources);
+static bool
+build_dep_merge_skip_visited(struct build_dep_merge *m, obj val)
+{
+	if (hash_get(&m->visited, &val)) {
+		return true;
 	}
 
-	if (dep && src->objects) {
-		obj_array_extend(wk, dest->objects, src->objects);
-	}
+	hash_set(&m->visited, &val, true);
+	return false;
 }
 
 static enum iteration_result
@@ -1009,19 +996,13 @@ dedup_link_args_iter(struct workspace *wk, void *_ctx, obj val)
 }
 
 static void
-dedup_build_dep(struct workspace *wk, struct build_dep *dep)
+build_dep_merge_finish(struct workspace *wk, struct build_dep_merge *m)
 {
-	obj_array_dedup_in_place(wk, &dep->link_with);
-	obj_array_dedup_in_place(wk, &dep->link_with_not_found);
-	obj_array_dedup_in_place(wk, &dep->link_whole);
+	struct build_dep *dep = m->dest;
+
 	obj_array_dedup_in_place(wk, &dep->raw.deps);
 	obj_array_dedup_in_place(wk, &dep->raw.link_with);
 	obj_array_dedup_in_place(wk, &dep->raw.link_whole);
-	obj_array_dedup_in_place(wk, &dep->include_directories);
-	obj_array_dedup_in_place(wk, &dep->rpath);
-	obj_array_dedup_in_place(wk, &dep->order_deps);
-	obj_array_dedup_in_place(wk, &dep->sources);
-	obj_array_dedup_in_place(wk, &dep->objects);
 
 	obj new_link_args;
 	make_obj(wk, &new_link_args, obj_array);
@@ -1032,10 +1013,52 @@ dedup_build_dep(struct workspace *wk, struct build_dep *dep)
 	make_obj(wk, &new_compile_args, obj_array);
 	obj_array_foreach(wk, dep->compile_args, &new_compile_args, dedup_link_args_iter);
 	dep->compile_args = new_compile_args;
+
+	hash_destroy(&m->visited);
+	obj_ordered_set_destroy(&m->link_with);
+	obj_ordered_set_destroy(&m->link_with_not_found);
+	obj_ordered_set_destroy(&m->link_whole);
+	obj_ordered_set_destroy(&m->include_directories);
+	obj_ordered_set_destroy(&m->rpath);
+	obj_ordered_set_destroy(&m->order_deps);
+	obj_ordered_set_destroy(&m->sources);
+	obj_ordered_set_destroy(&m->objects);
+}
+
+static void
+merge_build_deps(struct workspace *wk, struct build_dep *src, struct build_dep_merge *m, bool dep)
+{
+	struct build_dep *dest = m->dest;
+
+	dest->link_language = coalesce_link_languages(src->link_language, dest->link_language);
+
+	obj_ordered_set_extend(wk, &m->link_with, src->link_with);
+	obj_ordered_set_extend(wk, &m->link_with_not_found, src->link_with_not_found);
+	obj_ordered_set_extend(wk, &m->link_whole, src->link_whole);
+
+	if (dep) {
+		obj_ordered_set_extend(wk, &m->include_directories, src->include_directories);
+	}
+
+	if (src->link_args) {
+		obj_array_extend(wk, dest->link_args, src->link_args);
+	}
+
+	if (dep && src->compile_args) {
+		obj_array_extend(wk, dest->compile_args, src->compile_args);
+	}
+
+	obj_ordered_set_extend(wk, &m->rpath, src->rpath);
+	obj_ordered_set_extend(wk, &m->order_deps, src->order_deps);
+
+	if (dep) {
+		obj_ordered_set_extend(wk, &m->sources, src->sources);
+		obj_ordered_set_extend(wk, &m->objects, src->objects);
+	}
 }
 
 struct dep_process_link_with_ctx {
-	struct build_dep *dest;
+	struct build_dep_merge merge;
 	bool link_whole;
 	uint32_t err_node;
 };
@@ -1045,7 +1068,7 @@ dep_process_link_with_iter(struct workspace *wk, void *_ctx, obj val)
 {
 	struct dep_process_link_with_ctx *ctx = _ctx;
 
-	if (skip_if_present(wk, ctx->dest->raw.link_with, val)) {
+	if (build_dep_merge_skip_visited(&ctx->merge, val)) {
 		return ir_cont;
 	}
 
@@ -1053,12 +1076,12 @@ dep_process_link_with_iter(struct workspace *wk, void *_ctx, obj val)
 
 	/* obj_fprintf(wk, log_file(), "link_with: %o\n", val); */
 
-	obj dest_link_with;
+	struct obj_ordered_set *dest_link_with;
 
 	if (ctx->link_whole) {
-		dest_link_with = ctx->dest->link_whole;
+		dest_link_with = &ctx->merge.link_whole;
 	} else {
-		dest_link_with = ctx->dest->link_with;
+		dest_link_with = &ctx->merge.link_with;
 	}
 
 	switch (t) {
@@ -1075,7 +1098,7 @@ dep_process_link_with_iter(struct workspace *wk, void *_ctx, obj val)
 		}
 
 		if (tgt->type != tgt_executable) {
-			obj_array_push(wk, dest_link_with, make_str(wk, path));
+			obj_ordered_set_push(wk, dest_link_with, make_str(wk, path));
 		}
 
 		// calculate rpath for this target
@@ -1094,14 +1117,10 @@ dep_process_link_with_iter(struct workspace *wk, void *_ctx, obj val)
 				p = abs.buf;
 			}
 
-			obj s = make_str(wk, p);
-
-			if (!obj_array_in(wk, ctx->dest->rpath, s)) {
-				obj_array_push(wk, ctx->dest->rpath, s);
-			}
+			obj_ordered_set_push(wk, &ctx->merge.rpath, make_str(wk, p));
 		}
 
-		merge_build_deps(wk, &tgt->dep, ctx->dest, false);
+		merge_build_deps(wk, &tgt->dep, &ctx->merge, false);
 		break;
 	}
 	case obj_custom_target: {
@@ -1109,11 +1128,11 @@ dep_process_link_with_iter(struct workspace *wk, void *_ctx, obj val)
 		break;
 	}
 	case obj_file: {
-		obj_array_push(wk, dest_link_with, *get_obj_file(wk, val));
+		obj_ordered_set_push(wk, dest_link_with, *get_obj_file(wk, val));
 		break;
 	}
 	case obj_string:
-		obj_array_push(wk, dest_link_with, val);
+		obj_ordered_set_push(wk, dest_link_with, val);
 		break;
 	default:
 		interp_error(wk, ctx->err_node, "invalid type for link_with: '%s'", obj_type_to_s(t));
@@ -1123,53 +1142,44 @@ dep_process_link_with_iter(struct workspace *wk, void *_ctx, obj val)
 	return ir_cont;
 }
 
-bool
-dep_process_link_with(struct workspace *wk, uint32_t err_node, obj arr, struct build_dep *dest)
+static bool
+dep_process_link_with_common(struct workspace *wk, uint32_t err_node, obj arr, struct build_dep *dest, bool link_whole)
 {
-	build_dep_init(wk, dest);
-	dest->raw.link_with = arr;
+	struct dep_process_link_with_ctx ctx = {
+		.link_whole = link_whole,
+		.err_node = err_node,
+	};
 
-	hash_clear(&wk->obj_hash);
+	build_dep_merge_init(wk, &ctx.merge, dest);
 
-	if (!obj_array_foreach_flat(wk, arr, &(struct dep_process_link_with_ctx) {
-		.dest = dest,
-		.err_node = err_node,
-	}, dep_process_link_with_iter)) {
-		return false;
-	}
+	bool ok = obj_array_foreach_flat(wk, arr, &ctx, dep_process_link_with_iter);
 
-	dedup_build_dep(wk, dest);
-	return true;
+	build_dep_merge_finish(wk, &ctx.merge);
+	return ok;
+}
+
+bool
+dep_process_link_with(struct workspace *wk, uint32_t err_node, obj arr, struct build_dep *dest)
+{
+	dest->raw.link_with = arr;
+	return dep_process_link_with_common(wk, err_node, arr, dest, false);
 }
 
 bool
 dep_process_link_whole(struct workspace *wk, uint32_t err_node, obj arr, struct build_dep *dest)
 {
-	build_dep_init(wk, dest);
 	dest->raw.link_whole = arr;
-
-	hash_clear(&wk->obj_hash);
-
-	if (!obj_array_foreach_flat(wk, arr, &(struct dep_process_link_with_ctx) {
-		.dest = dest,
-		.link_whole = true,
-		.err_node = err_node,
-	}, dep_process_link_with_iter)) {
-		return false;
-	}
-
-	dedup_build_dep(wk, dest);
-	return true;
+	return dep_process_link_with_common(wk, err_node, arr, dest, true);
 }
 
 static enum iteration_result
 dep_process_deps_iter(struct workspace *wk, void *_ctx, obj val)
 {
-	struct build_dep *dest = _ctx;
+	struct build_dep_merge *m = _ctx;
 
 	/* obj_fprintf(wk, log_file(), "dep: %o\n", val); */
 
-	if (skip_if_present(wk, dest->raw.deps, val)) {
+	if (build_dep_merge_skip_visited(m, val)) {
 		return ir_cont;
 	}
 
@@ -1178,20 +1188,90 @@ dep_process_deps_iter(struct workspace *wk, void *_ctx, obj val)
 		return ir_cont;
 	}
 
-	merge_build_deps(wk, &dep->dep, dest, true);
+	merge_build_deps(wk, &dep->dep, m, true);
 
 	return ir_cont;
 }
 
+/*
+ * The flattened result of merging a list of dependencies is memoized, keyed
+ * by the ids of the dependencies in the list.  Dependency objects are never
+ * modified once they have been created, so an entry stays valid for as long
+ * as the workspace does.  A list is only flattened on its own once it has
+ * been seen twice, so that lists which are used only once don't pay for an
+ * extra copy.
+ */
+static bool
+dep_process_deps_memo(struct workspace *wk, obj deps, struct build_dep *res)
+{
+	struct obj_array *a = get_obj_array(wk, deps);
+	if (a->len < 2 || wk->obj_clear_mark_set) {
+		return false;
+	}
+
+	SBUF(key);
+	uint32_t i;
+	for (i = 0; i < a->len; ++i) {
+		obj d;
+		obj_array_index(wk, deps, i, &d);
+		sbuf_pushn(wk, &key, (const char *)&d, sizeof(obj));
+	}
+
+	uint64_t *v;
+	if (!(v = hash_get_strn(&wk->dep_memo, key.buf, key.len))) {
+		const struct str *k = get_str(wk, make_strn(wk, key.buf, key.len));
+		hash_set_strn(&wk->dep_memo, k->s, k->len, 0);
+		return false;
+	} else if (*v) {
+		*res = get_obj_dependency(wk, *v)->dep;
+		return true;
+	}
+
+	struct build_dep flat = { 0 };
+	struct build_dep_merge m;
+	build_dep_merge_init(wk, &m, &flat);
+	obj_array_foreach(wk, deps, &m, dep_process_deps_iter);
+	build_dep_merge_finish(wk, &m);
+
+	obj memo;
+	make_obj(wk, &memo, obj_dependency);
+	get_obj_dependency(wk, memo)->dep = flat;
+	hash_set_strn(&wk->dep_memo, key.buf, key.len, memo);
+
+	*res = flat;
+	return true;
+}
+
 void
 dep_process_deps(struct workspace *wk, obj deps, struct build_dep *dest)
 {
-	build_dep_init(wk, dest);
+	struct build_dep_merge m;
+	struct build_dep flat;
+
 	dest->raw.deps = deps;
+	build_dep_merge_init(wk, &m, dest);
+
+	if (dep_process_deps_memo(wk, deps, &flat)) {
+		enum compiler_language link_language = dest->link_language;
 
-	hash_clear(&wk->obj_hash);
+		merge_build_deps(wk, &flat, &m, true);
+
+		// coalescing link languages isn't associative, so redo it one
+		// dependency at a time
+		uint32_t i;
+		for (i = 0; i < get_obj_array(wk, deps)->len; ++i) {
+			obj d;
+			obj_array_index(wk, deps, i, &d);
+			struct obj_dependency *dep = get_obj_dependency(wk, d);
+			if (dep->flags & dep_flag_found) {
+				link_language = coalesce_link_languages(dep->dep.link_language, link_language);
+			}
+		}
 
-	obj_array_foreach(wk, deps, dest, dep_process_deps_iter);
+		dest->link_language = link_language;
+	} else {
+		obj_array_foreach(wk, deps, &m, dep_process_deps_iter);
+	}
 
-	dedup_build_dep(wk, dest);
+	build_dep_merge_finish(wk, &m);
 }
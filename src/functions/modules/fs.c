@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "args.h"
+#include "digest.h"
 #include "functions/common.h"
 #include "functions/kernel/custom_target.h"
 #include "functions/modules/fs.h"
@@ -17,7 +18,6 @@
 #include "log.h"
 #include "platform/filesystem.h"
 #include "platform/path.h"
-#include "sha_256.h"
 
 enum fix_file_path_opts {
 	fix_file_path_allow_file = 1 << 0,
@@ -313,8 +313,9 @@ func_module_fs_hash(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res
 		return false;
 	}
 
-	if (!str_eql(get_str(wk, an[1].val), &WKSTR("sha256"))) {
-		interp_error(wk, an[1].node, "only sha256 is supported");
+	enum digest_algo algo;
+	if (!digest_algo_from_s(get_cstr(wk, an[1].val), &algo)) {
+		interp_error(wk, an[1].node, "unsupported hash algorithm %o", an[1].val);
 		return false;
 	}
 
@@ -323,24 +324,15 @@ func_module_fs_hash(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res
 		return false;
 	}
 
-	struct source src = { 0 };
-	if (!fs_read_entire_file(path.buf, &src)) {
+	uint8_t hash[DIGEST_MAX_LEN];
+	if (!digest_file(algo, path.buf, hash)) {
 		return false;
 	}
 
-	uint8_t hash[32] = { 0 };
-	calc_sha_256(hash, src.src, src.len); // TODO: other hash algos
-
-	char buf[65] = { 0 };
-	uint32_t i, bufi = 0;
-	for (i = 0; i < 32; ++i) {
-		snprintf(&buf[bufi], 3, "%x", hash[i]);
-		bufi += 2;
-	}
+	char buf[DIGEST_MAX_LEN * 2 + 1];
+	digest_to_hex(hash, digest_len(algo), buf);
 
 	*res = make_str(wk, buf);
-
-	fs_source_destroy(&src);
 	return true;
 }
 
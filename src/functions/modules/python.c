@@ -6,127 +6,215 @@
 #include "compat.h"
 #include "coerce.h"
 
+#include <inttypes.h>
 #include <string.h>
+#include <sys/stat.h>
 
+#include "backend/output.h"
 #include "external/tinyjson.h"
 #include "functions/external_program.h"
 #include "functions/modules/python.h"
 #include "lang/interpreter.h"
+#include "lang/serial.h"
 #include "lang/typecheck.h"
+#include "log.h"
 #include "platform/filesystem.h"
+#include "platform/mem.h"
+#include "platform/path.h"
 #include "platform/run_cmd.h"
 
-static const char *introspect_version =
-	"import sysconfig\n"
-	"print(sysconfig.get_python_version())\n";
-
-static const char *introspect_paths =
-	"import sysconfig\n"
+/*
+ * Everything muon needs to know about an interpreter, including which of the
+ * requested modules can be imported, is gathered in a single run as one json
+ * document.  Anything printed while importing modules goes to stderr so that
+ * it can't end up in the json.
+ */
+static const char *introspect_script =
+	"import importlib\n"
 	"import json\n"
-	"print(json.dumps(sysconfig.get_paths()))\n";
-
-static const char *introspect_vars =
+	"import sys\n"
 	"import sysconfig\n"
-	"import json\n"
-	"print(json.dumps(sysconfig.get_config_vars()))\n";
+	"res = {\n"
+	"    'version': sysconfig.get_python_version(),\n"
+	"    'paths': sysconfig.get_paths(),\n"
+	"    'vars': dict(sysconfig.get_config_vars()),\n"
+	"    'modules': {},\n"
+	"}\n"
+	"stdout = sys.stdout\n"
+	"sys.stdout = sys.stderr\n"
+	"for mod in sys.argv[1:]:\n"
+	"    try:\n"
+	"        importlib.import_module(mod)\n"
+	"        res['modules'][mod] = True\n"
+	"    except BaseException:\n"
+	"        res['modules'][mod] = False\n"
+	"sys.stdout = stdout\n"
+	"print(json.dumps(res))\n";
 
 static bool
-query_version(struct workspace *wk, const char *path,
-	struct obj_python_installation *python)
+introspection_valid(struct workspace *wk, obj info)
 {
-	struct run_cmd_ctx cmd_ctx = { 0 };
-	char *const args[] = { (char *)path, "-c", (char *)introspect_version, 0 };
-	if (!run_cmd_argv(&cmd_ctx, args, NULL, 0) || cmd_ctx.status != 0) {
-		return false;
-	}
-
-	size_t index = 0, buf_index = 0, max_buf_index = cmd_ctx.out.len;
-	char *buf = cmd_ctx.out.buf, *entry = cmd_ctx.out.buf;
-	while (buf_index != max_buf_index) {
-		if (buf[buf_index] == '\n') {
-			buf[buf_index] = '\0';
+	obj v;
+	return get_obj_type(wk, info) == obj_dict
+	       && obj_dict_index_str(wk, info, "version", &v) && get_obj_type(wk, v) == obj_string
+	       && obj_dict_index_str(wk, info, "paths", &v) && get_obj_type(wk, v) == obj_dict
+	       && obj_dict_index_str(wk, info, "vars", &v) && get_obj_type(wk, v) == obj_dict
+	       && obj_dict_index_str(wk, info, "modules", &v) && get_obj_type(wk, v) == obj_dict;
+}
 
-			if (index == 0) {  /* language_version */
-				python->language_version = make_str(wk, entry);
-			}
+static bool
+run_introspection(struct workspace *wk, const char *path, obj modules, obj *res)
+{
+	bool ret = false;
+	uint32_t argc = 0, len = modules ? get_obj_array(wk, modules)->len : 0;
+	const char **argv = z_calloc(len + 4, sizeof(const char *));
+	argv[argc++] = path;
+	argv[argc++] = "-c";
+	argv[argc++] = introspect_script;
 
-			entry = &buf[buf_index + 1];
-			index++;
-		} else {
-			buf_index++;
-		}
+	uint32_t i;
+	for (i = 0; i < len; ++i) {
+		obj mod;
+		obj_array_index(wk, modules, i, &mod);
+		argv[argc++] = get_cstr(wk, mod);
 	}
 
-	bool success = buf[buf_index] == '\0';
+	struct run_cmd_ctx cmd_ctx = { 0 };
+	if (!run_cmd_argv(&cmd_ctx, (char *const *)argv, NULL, 0) || cmd_ctx.status != 0) {
+		goto ret;
+	}
 
+	ret = muon_json_to_dict(wk, cmd_ctx.out.buf, res) && introspection_valid(wk, *res);
+ret:
 	run_cmd_ctx_destroy(&cmd_ctx);
-	return success;
+	z_free((void *)argv);
+	return ret;
 }
 
-static bool
-query_paths(struct workspace *wk, const char *path,
-	struct obj_python_installation *python)
+/*
+ * Introspection results are kept in the build dir, keyed by the path of the
+ * interpreter and stamped with its modification time and size, so that
+ * reconfiguring doesn't run python at all unless it changed.  Modules may be
+ * installed or removed at any time, so they are never cached, and python is
+ * always run when modules are requested.
+ */
+static obj
+introspection_cache_load(struct workspace *wk)
 {
-	struct run_cmd_ctx cmd_ctx = { 0 };
-	char *const path_args[] = { (char *)path, "-c", (char *)introspect_paths, 0 };
-	if (!run_cmd_argv(&cmd_ctx, path_args, NULL, 0) || cmd_ctx.status != 0) {
-		return false;
+	SBUF(path);
+	path_join(wk, &path, wk->muon_private, output_path.python_introspection);
+
+	obj cache;
+	FILE *f;
+	if (!fs_file_exists(path.buf) || !(f = fs_fopen(path.buf, "rb"))) {
+		goto empty;
 	}
 
-	bool success = muon_json_to_dict(wk, cmd_ctx.out.buf, &python->sysconfig_paths);
+	bool ok = serial_load(wk, &cache, f);
 
-	run_cmd_ctx_destroy(&cmd_ctx);
-	return success;
+	if (!fs_fclose(f) || !ok || get_obj_type(wk, cache) != obj_dict) {
+		goto empty;
+	}
+
+	return cache;
+empty:
+	make_obj(wk, &cache, obj_dict);
+	return cache;
 }
 
 static bool
-query_vars(struct workspace *wk, const char *path,
-	struct obj_python_installation *python)
+introspection_cache_write(struct workspace *wk, void *ctx, FILE *out)
 {
-	struct run_cmd_ctx cmd_ctx = { 0 };
-	char *const var_args[] = { (char *)path, "-c", (char *)introspect_vars, 0 };
-	if (!run_cmd_argv(&cmd_ctx, var_args, NULL, 0) || cmd_ctx.status != 0) {
+	return serial_dump(wk, *(obj *)ctx, out);
+}
+
+/*
+ * Cache entries are [stamp, introspection result without modules].
+ */
+static bool
+introspection_cache_entry(struct workspace *wk, obj cache, obj key, obj stamp, obj *res)
+{
+	obj entry, v;
+	if (!obj_dict_index(wk, cache, key, &entry)
+	    || get_obj_type(wk, entry) != obj_array
+	    || get_obj_array(wk, entry)->len != 2) {
 		return false;
 	}
 
-	bool success = muon_json_to_dict(wk, cmd_ctx.out.buf, &python->sysconfig_vars);
+	obj_array_index(wk, entry, 0, &v);
+	if (get_obj_type(wk, v) != obj_string || !str_eql(get_str(wk, v), get_str(wk, stamp))) {
+		return false;
+	}
 
-	run_cmd_ctx_destroy(&cmd_ctx);
-	return success;
+	obj_array_index(wk, entry, 1, res);
+	return introspection_valid(wk, *res);
 }
 
-static bool
-introspect_python_interpreter(struct workspace *wk, const char *path,
-	struct obj_python_installation *python)
+static void
+introspection_cache_set(struct workspace *wk, obj cache, obj key, obj stamp, obj info)
 {
-	return query_version(wk, path, python) && query_paths(wk, path, python)
-	       && query_vars(wk, path, python);
+	obj cached, v;
+	make_obj(wk, &cached, obj_dict);
+	obj_dict_index_str(wk, info, "version", &v);
+	obj_dict_set(wk, cached, make_str(wk, "version"), v);
+	obj_dict_index_str(wk, info, "paths", &v);
+	obj_dict_set(wk, cached, make_str(wk, "paths"), v);
+	obj_dict_index_str(wk, info, "vars", &v);
+	obj_dict_set(wk, cached, make_str(wk, "vars"), v);
+	make_obj(wk, &v, obj_dict);
+	obj_dict_set(wk, cached, make_str(wk, "modules"), v);
+
+	obj entry;
+	make_obj(wk, &entry, obj_array);
+	obj_array_push(wk, entry, stamp);
+	obj_array_push(wk, entry, cached);
+	obj_dict_set(wk, cache, key, entry);
+
+	if (!with_open(wk->muon_private, output_path.python_introspection, wk, &cache, introspection_cache_write)) {
+		LOG_W("failed to write python introspection cache");
+	}
 }
 
+/*
+ * Sets info to the introspection result and present to a dict of module
+ * names to whether they were found, which has at least the requested modules.
+ */
 static bool
-python_module_present(struct workspace *wk, const char *pythonpath, const char *mod)
+introspect_python_interpreter(struct workspace *wk, const char *path, obj modules, obj *info, obj *present)
 {
-	struct run_cmd_ctx cmd_ctx = { 0 };
+	obj cache = 0, key = 0, stamp = 0, cached_info;
+	bool cached = false;
 
-	SBUF(importstr);
-	sbuf_pushf(wk, &importstr, "import %s", mod);
+	struct stat sb;
+	if (fs_file_exists(path) && fs_stat(path, &sb)) {
+		cache = introspection_cache_load(wk);
+		key = make_str(wk, path);
+		stamp = make_strf(wk, "%" PRId64 " %" PRIu64, fs_stat_mtime_ns(&sb), (uint64_t)sb.st_size);
 
-	char *const *args = (char *const []){
-		(char *)pythonpath,
-		"-c",
-		importstr.buf,
-		0
-	};
+		cached = introspection_cache_entry(wk, cache, key, stamp, &cached_info);
 
-	bool present = run_cmd_argv(&cmd_ctx, args, NULL, 0) && cmd_ctx.status == 0;
+		if (cached && !modules) {
+			*info = cached_info;
+			obj_dict_index_str(wk, *info, "modules", present);
+			return true;
+		}
+	}
 
-	run_cmd_ctx_destroy(&cmd_ctx);
+	if (!run_introspection(wk, path, modules, info)) {
+		return false;
+	}
+
+	obj_dict_index_str(wk, *info, "modules", present);
 
-	return present;
+	if (key && !cached) {
+		introspection_cache_set(wk, cache, key, stamp, *info);
+	}
+
+	return true;
 }
 
 struct iter_mod_ctx {
-	const char *pythonpath;
+	obj present;
 	uint32_t node;
 	enum requirement_type requirement;
 };
@@ -137,7 +225,8 @@ iterate_required_module_list(struct workspace *wk, void *ctx, obj val)
 	struct iter_mod_ctx *_ctx = ctx;
 	const char *mod = get_cstr(wk, val);
 
-	if (python_module_present(wk, _ctx->pythonpath, mod)) {
+	obj present;
+	if (obj_dict_index(wk, _ctx->present, val, &present) && get_obj_bool(wk, present)) {
 		return ir_cont;
 	}
 
@@ -192,11 +281,17 @@ func_module_python_find_installation(struct workspace *wk,
 		return true;
 	}
 
+	obj info, present;
+	if (!introspect_python_interpreter(wk, cmd_path.buf, akw[kw_modules].set && found ? akw[kw_modules].val : 0, &info, &present)) {
+		interp_error(wk, args_node, "failed to introspect python");
+		return false;
+	}
+
 	if (akw[kw_modules].set && found) {
 		bool all_present = obj_array_foreach(wk,
 			akw[kw_modules].val,
 			&(struct iter_mod_ctx){
-			.pythonpath = cmd_path.buf,
+			.present = present,
 			.node = akw[kw_modules].node,
 			.requirement = requirement,
 		},
@@ -224,11 +319,9 @@ func_module_python_find_installation(struct workspace *wk,
 	make_obj(wk, &ep->cmd_array, obj_array);
 	obj_array_push(wk, ep->cmd_array, sbuf_into_str(wk, &cmd_path));
 
-	if (!introspect_python_interpreter(wk, cmd_path.buf, python)) {
-		interp_error(wk, args_node, "failed to introspect python");
-		return false;
-	}
-
+	obj_dict_index_str(wk, info, "version", &python->language_version);
+	obj_dict_index_str(wk, info, "paths", &python->sysconfig_paths);
+	obj_dict_index_str(wk, info, "vars", &python->sysconfig_vars);
 	return true;
 }
 
@@ -15,7 +15,7 @@ bool
 subproject_get_variable(struct workspace *wk, uint32_t node, obj name_id,
 	obj fallback, obj subproj, obj *res)
 {
-	const char *name = get_cstr(wk, name_id);
+	obj name = make_sym(wk, get_cstr(wk, name_id));
 	struct obj_subproject *sub = get_obj_subproject(wk, subproj);
 
 	if (!sub->found) {
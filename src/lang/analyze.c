@@ -236,7 +236,7 @@ analyze_for_each_type(struct workspace *wk, struct analyze_ctx *ctx, uint32_t n_
  */
 
 struct check_analyze_scope_ctx {
-	const char *name;
+	obj sym;
 	uint32_t i;
 	obj res, scope;
 	bool found;
@@ -265,7 +265,7 @@ analyze_check_scope_stack(struct workspace *wk, void *_ctx, obj local_scope)
 			obj_array_index(wk, local_scope, i, &scope_group);
 			obj scope = obj_array_get_tail(wk, scope_group);
 
-			if (obj_dict_index_str(wk, scope, ctx->name, &ctx->res)) {
+			if (obj_dict_geti(wk, scope, ctx->sym, &ctx->res)) {
 				ctx->scope = scope;
 				ctx->found = true;
 				break;
@@ -274,7 +274,7 @@ analyze_check_scope_stack(struct workspace *wk, void *_ctx, obj local_scope)
 	}
 
 	if (!ctx->found) {
-		if (obj_dict_index_str(wk, base, ctx->name, &ctx->res)) {
+		if (obj_dict_geti(wk, base, ctx->sym, &ctx->res)) {
 			ctx->scope = base;
 			ctx->found = true;
 		}
@@ -286,10 +286,10 @@ analyze_check_scope_stack(struct workspace *wk, void *_ctx, obj local_scope)
 
 // example scope_stack: [[{a: 1}, [{b: 2}, {b: 3}], [{c: 4}]]]
 static struct assignment *
-assign_lookup(struct workspace *wk, const char *name)
+assign_lookup(struct workspace *wk, obj sym)
 {
 	TracyCZoneAutoS;
-	struct check_analyze_scope_ctx ctx = { .name = name };
+	struct check_analyze_scope_ctx ctx = { .sym = sym };
 	obj_array_foreach(wk, current_project(wk)->scope_stack, &ctx, analyze_check_scope_stack);
 
 	if (ctx.found) {
@@ -302,10 +302,10 @@ assign_lookup(struct workspace *wk, const char *name)
 }
 
 static obj
-assign_lookup_scope(struct workspace *wk, const char *name)
+assign_lookup_scope(struct workspace *wk, obj sym)
 {
 	TracyCZoneAutoS;
-	struct check_analyze_scope_ctx ctx = { .name = name };
+	struct check_analyze_scope_ctx ctx = { .sym = sym };
 	obj_array_foreach(wk, current_project(wk)->scope_stack, &ctx, analyze_check_scope_stack);
 
 	if (ctx.found) {
@@ -318,11 +318,11 @@ assign_lookup_scope(struct workspace *wk, const char *name)
 }
 
 static void
-analyze_unassign(struct workspace *wk, const char *name)
+analyze_unassign(struct workspace *wk, obj sym)
 {
-	obj scope = assign_lookup_scope(wk, name);
+	obj scope = assign_lookup_scope(wk, sym);
 	if (scope) {
-		obj_dict_del_strn(wk, scope, name, strlen(name));
+		obj_dict_deli(wk, scope, sym);
 	}
 }
 
@@ -387,12 +387,12 @@ push_assignment(struct workspace *wk, const char *name, obj o, uint32_t n_id)
 }
 
 static struct assignment *
-scope_assign(struct workspace *wk, const char *name, obj o, uint32_t n_id, enum variable_assignment_mode mode)
+scope_assign(struct workspace *wk, obj sym, obj o, uint32_t n_id, enum variable_assignment_mode mode)
 {
 	TracyCZoneAutoS;
 	obj scope = 0;
 	if (mode == assign_reassign) {
-		if (!(scope = assign_lookup_scope(wk, name))) {
+		if (!(scope = assign_lookup_scope(wk, sym))) {
 			mode = assign_local;
 		}
 	}
@@ -410,7 +410,7 @@ scope_assign(struct workspace *wk, const char *name, obj o, uint32_t n_id, enum
 	assert(scope);
 
 	struct assignment *a = 0;
-	if (analyzer.impure_loop_depth && (a = assign_lookup(wk, name))) {
+	if (analyzer.impure_loop_depth && (a = assign_lookup(wk, sym))) {
 		// When overwriting a variable in a loop turn it into a
 		// typeinfo so that it gets marked as impure.
 		enum obj_type new_type = get_obj_type(wk, o);
@@ -420,7 +420,7 @@ scope_assign(struct workspace *wk, const char *name, obj o, uint32_t n_id, enum
 	}
 
 	obj aid;
-	if (obj_dict_index(wk, scope, make_str(wk, name), &aid)) {
+	if (obj_dict_geti(wk, scope, sym, &aid)) {
 		// The assignment was found so just reassign it here
 		a = bucket_arr_get(&assignments, aid);
 		check_reassign_to_different_type(wk, a, o, NULL, n_id);
@@ -430,8 +430,8 @@ scope_assign(struct workspace *wk, const char *name, obj o, uint32_t n_id, enum
 		return a;
 	}
 
-	aid = push_assignment(wk, name, o, n_id);
-	obj_dict_set(wk, scope, make_str(wk, name), aid);
+	aid = push_assignment(wk, get_cstr(wk, sym), o, n_id);
+	obj_dict_seti(wk, scope, sym, aid);
 
 	TracyCZoneAutoE;
 	return bucket_arr_get(&assignments, aid);
@@ -454,7 +454,7 @@ push_scope_group_scope(struct workspace *wk)
 	    scope_group = obj_array_get_tail(wk, local_scope),
 	    scope;
 
-	make_obj(wk, &scope, obj_dict);
+	make_scope(wk, &scope);
 	obj_array_push(wk, scope_group, scope);
 }
 
@@ -494,11 +494,11 @@ merge_scope_group_scope_iter(struct workspace *wk, void *_ctx, obj k, obj aid)
 
 	obj bid;
 	struct assignment *b, *a = bucket_arr_get(&assignments, aid);
-	if (obj_dict_index(wk, ctx->merged, k, &bid)) {
+	if (obj_dict_geti(wk, ctx->merged, k, &bid)) {
 		b = bucket_arr_get(&assignments, bid);
 		merge_objects(wk, b, a);
 	} else {
-		obj_dict_set(wk, ctx->merged, k, aid);
+		obj_dict_seti(wk, ctx->merged, k, aid);
 	}
 
 	return ir_cont;
@@ -522,7 +522,7 @@ static enum iteration_result
 merge_scope_group_scope_with_base_iter(struct workspace *wk, void *_ctx, obj k, obj aid)
 {
 	struct assignment *a = bucket_arr_get(&assignments, aid), *b;
-	if ((b = assign_lookup(wk, a->name))) {
+	if ((b = assign_lookup(wk, k))) {
 		merge_objects(wk, b, a);
 	} else {
 		type_tag type = get_obj_type(wk, a->o);
@@ -530,7 +530,7 @@ merge_scope_group_scope_with_base_iter(struct workspace *wk, void *_ctx, obj k,
 			a->o = make_typeinfo(wk, obj_type_to_tc_type(type), 0);
 		}
 
-		b = scope_assign(wk, a->name, a->o, 0, assign_local);
+		b = scope_assign(wk, k, a->o, 0, assign_local);
 		b->accessed = a->accessed;
 		b->line = a->line;
 		b->col = a->col;
@@ -829,7 +829,7 @@ analyze_method(struct workspace *wk, struct analyze_ctx *ctx, uint32_t n_id, typ
 			return;
 		}
 
-		if (!(fi = func_lookup(impl_tbl, wk->lang_mode, name))) {
+		if (!(fi = func_lookup_node(wk, impl_tbl, rcvr_type, n->r))) {
 			return;
 		}
 	}
@@ -891,7 +891,7 @@ analyze_func(struct workspace *wk, uint32_t n_id, bool chained, obj l_id, obj *r
 	const char *name = 0;
 	if (!chained) {
 		struct node *l = get_node(wk->ast, n->l);
-		if (l->type == node_id && func_lookup(kernel_func_tbl, wk->lang_mode, l->dat.s)) {
+		if (l->type == node_id && func_lookup_node(wk, kernel_func_tbl, 0, n->l)) {
 			name = l->dat.s;
 			mark_node_visited(get_node(wk->ast, n->l));
 		} else {
@@ -904,7 +904,7 @@ analyze_func(struct workspace *wk, uint32_t n_id, bool chained, obj l_id, obj *r
 
 	const struct func_impl *fi = 0;
 	if (name) {
-		fi = func_lookup(kernel_func_tbl, wk->lang_mode, name);
+		fi = func_lookup_node(wk, kernel_func_tbl, 0, n->l);
 	} else {
 		if (!typecheck(wk, n->l, l_id, obj_func)) {
 			l_id = 0;
@@ -1486,10 +1486,10 @@ analyze_foreach(struct workspace *wk, uint32_t n_id, obj *res)
 		// two variables
 		n_r = get_node(wk->ast, args->r)->l;
 
-		scope_assign(wk, get_node(wk->ast, n_l)->dat.s, make_typeinfo(wk, tc_string, 0), n_l, assign_local);
-		scope_assign(wk, get_node(wk->ast, n_r)->dat.s, make_typeinfo(wk, tc_any, 0), n_r, assign_local);
+		scope_assign(wk, get_node(wk->ast, n_l)->l, make_typeinfo(wk, tc_string, 0), n_l, assign_local);
+		scope_assign(wk, get_node(wk->ast, n_r)->l, make_typeinfo(wk, tc_any, 0), n_r, assign_local);
 	} else {
-		scope_assign(wk, get_node(wk->ast, n_l)->dat.s, make_typeinfo(wk, tc_any, 0), n_l, assign_local);
+		scope_assign(wk, get_node(wk->ast, n_l)->l, make_typeinfo(wk, tc_any, 0), n_l, assign_local);
 	}
 
 	++analyzer.impure_loop_depth;
@@ -1548,7 +1548,7 @@ analyze_assign(struct workspace *wk, struct node *n)
 		ret = false;
 	}
 
-	scope_assign(wk, get_node(wk->ast, n->l)->dat.s, rhs, n->l, n->subtype);
+	scope_assign(wk, get_node(wk->ast, n->l)->l, rhs, n->l, n->subtype);
 	return ret;
 }
 
@@ -1562,7 +1562,7 @@ analyze_plusassign(struct workspace *wk, uint32_t n_id, obj *_)
 		return false;
 	}
 
-	scope_assign(wk, get_node(wk->ast, n->l)->dat.s, rhs, n->l, assign_reassign);
+	scope_assign(wk, get_node(wk->ast, n->l)->l, rhs, n->l, assign_reassign);
 	return true;
 }
 
@@ -1662,7 +1662,7 @@ analyze_node(struct workspace *wk, uint32_t n_id, obj *res)
 		break;
 	case node_id: {
 		struct assignment *a;
-		if (!(a = assign_lookup(wk, n->dat.s))) {
+		if (!(a = assign_lookup(wk, n->l))) {
 			interp_error(wk, n_id, "undefined object %s", n->dat.s);
 			*res = make_typeinfo(wk, tc_any, 0);
 			ret = false;
@@ -1758,15 +1758,15 @@ analyze_check_dead_code(struct workspace *wk, struct ast *ast)
 }
 
 static void
-analyze_assign_wrapper(struct workspace *wk, const char *name, obj o, uint32_t n_id, enum variable_assignment_mode mode)
+analyze_assign_wrapper(struct workspace *wk, obj sym, obj o, uint32_t n_id, enum variable_assignment_mode mode)
 {
-	scope_assign(wk, name, o, n_id, mode);
+	scope_assign(wk, sym, o, n_id, mode);
 }
 
 static bool
-analyze_lookup_wrapper(struct workspace *wk, const char *name, obj *res, uint32_t proj_id)
+analyze_lookup_wrapper(struct workspace *wk, obj sym, obj *res, uint32_t proj_id)
 {
-	struct assignment *a = assign_lookup(wk, name);
+	struct assignment *a = assign_lookup(wk, sym);
 	if (a) {
 		a->accessed = true;
 		*res = a->o;
@@ -1782,7 +1782,7 @@ analyze_push_local_scope(struct workspace *wk)
 	obj scope_group;
 	make_obj(wk, &scope_group, obj_array);
 	obj scope;
-	make_obj(wk, &scope, obj_dict);
+	make_scope(wk, &scope);
 	obj_array_push(wk, scope_group, scope);
 	obj_array_push(wk, current_project(wk)->scope_stack, scope_group);
 }
@@ -1893,7 +1893,7 @@ reassign_default_var(struct workspace *wk, void *_ctx, obj k, obj v)
 	struct assignment *a = bucket_arr_get(&assignments, aid);
 	a->default_var = true;
 
-	obj_dict_set(wk, *scope, k, aid);
+	obj_dict_seti(wk, *scope, k, aid);
 	return ir_cont;
 }
 
@@ -1983,7 +1983,7 @@ do_analyze(struct analyze_opts *opts)
 		obj_array_index(&wk, wk.default_scope, 0, &default_scope);
 		make_obj(&wk, &wk.default_scope, obj_array);
 		make_obj(&wk, &scope_group, obj_array);
-		make_obj(&wk, &scope, obj_dict);
+		make_scope(&wk, &scope);
 		obj_array_push(&wk, scope_group, scope);
 		obj_array_push(&wk, wk.default_scope, scope_group);
 		obj_dict_foreach(&wk, default_scope, &scope, reassign_default_var);
@@ -2025,7 +2025,7 @@ do_analyze(struct analyze_opts *opts)
 		uint32_t proj_id;
 		make_project(&wk, &proj_id, "dummy", wk.source_root, wk.build_root);
 
-		struct assignment *a = scope_assign(&wk, "argv", make_typeinfo(&wk, tc_array, 0), 0, assign_local);
+		struct assignment *a = scope_assign(&wk, make_sym(&wk, "argv"), make_typeinfo(&wk, tc_array, 0), 0, assign_local);
 		a->default_var = true;
 
 		wk.lang_mode = language_extended;
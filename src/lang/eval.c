@@ -19,6 +19,7 @@
 #include "platform/filesystem.h"
 #include "platform/mem.h"
 #include "platform/path.h"
+#include "profile.h"
 #include "tracy.h"
 #include "wrap.h"
 
@@ -117,6 +118,7 @@ bool
 eval(struct workspace *wk, struct source *src, enum eval_mode mode, obj *res)
 {
 	TracyCZoneAutoS;
+	profile_begin("eval", src->label);
 	/* L("evaluating '%s'", src->label); */
 	interpreter_init();
 
@@ -172,6 +174,7 @@ eval(struct workspace *wk, struct source *src, enum eval_mode mode, obj *res)
 	wk->src = old_src;
 	wk->ast = old_ast;
 ret:
+	profile_end();
 	TracyCZoneAutoE;
 	return ret;
 }
@@ -385,7 +388,7 @@ cmd_found:
 
 			if (repl_res) {
 				obj_fprintf(wk, out, "%o\n", repl_res);
-				wk->assign_variable(wk, "_", repl_res, 0, assign_local);
+				wk->assign_variable(wk, make_sym(wk, "_"), repl_res, 0, assign_local);
 			}
 		}
 cont:
@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "buf_size.h"
+#include "datastructures/hash.h"
 #include "error.h"
 #include "formats/editorconfig.h"
 #include "formats/ini.h"
@@ -34,11 +35,8 @@ struct fmt_ctx {
 	uint32_t indent, col, enclosed;
 	bool force_ml;
 	bool trailing_comment;
-
-	/* options */
-	bool space_array, kwa_ml, wide_colon, no_single_comma_function;
-	uint32_t max_line_len;
-	const char *indent_by;
+	struct hash measured;
+	struct fmt_opts opts;
 };
 
 enum special_fmt {
@@ -109,6 +107,77 @@ fmt_setup_fst(const struct fmt_stack *pfst)
 	return &fst;
 }
 
+/*
+ * Everything that the result of measuring a node can depend on.  While
+ * measuring nothing is written and nodes are laid out on a single line, so
+ * the column stays fixed and only matters through fmt_breaking_space, and
+ * neither the indentation nor ctx->enclosed matter at all.
+ */
+struct fmt_measure_key {
+	fmt_func func;
+	const char *node_sep, *arg_container;
+	uint32_t n_id, parent, special_fmt, flags;
+};
+
+enum fmt_measure_key_flag {
+	fmt_measure_key_flag_and_or_force_ml = 1 << 0,
+	fmt_measure_key_flag_trailing_comment = 1 << 1,
+	fmt_measure_key_flag_past_max_line_len = 1 << 2,
+};
+
+enum fmt_measure_result_flag {
+	fmt_measure_result_flag_force_ml = 1 << 0,
+	fmt_measure_result_flag_trailing_comment = 1 << 1,
+};
+
+/*
+ * Measure the width of a node without writing it.  fmt_check measures every
+ * node before writing it, and since writing a node measures all of its
+ * children again, results are memoized so that each node is only measured
+ * once per context.  Along with the width, the effects measuring has on
+ * force_ml and trailing_comment are recorded so that a cached result leaves
+ * ctx in the same state as measuring again would.
+ */
+static uint32_t
+fmt_measure(struct fmt_ctx *ctx, const struct fmt_stack *fst, fmt_func func, uint32_t n_id)
+{
+	assert(!fst->write && !fst->ml);
+
+	struct fmt_measure_key key;
+	memset(&key, 0, sizeof(key));
+	key.func = func;
+	key.node_sep = fst->node_sep;
+	key.arg_container = fst->arg_container;
+	key.n_id = n_id;
+	key.parent = fst->parent;
+	key.special_fmt = fst->special_fmt;
+	key.flags = (fst->fmt_and_or_force_ml ? fmt_measure_key_flag_and_or_force_ml : 0)
+		    | (ctx->trailing_comment ? fmt_measure_key_flag_trailing_comment : 0)
+		    | (ctx->col >= ctx->opts.max_line_len ? fmt_measure_key_flag_past_max_line_len : 0);
+
+	const uint64_t *v;
+	if ((v = hash_get(&ctx->measured, &key))) {
+		uint32_t flags = *v >> 32;
+		if (flags & fmt_measure_result_flag_force_ml) {
+			ctx->force_ml = true;
+		}
+		ctx->trailing_comment = flags & fmt_measure_result_flag_trailing_comment;
+		return (uint32_t)*v;
+	}
+
+	bool old_force_ml = ctx->force_ml;
+	ctx->force_ml = false;
+
+	uint32_t len = func(ctx, fst, n_id);
+
+	uint32_t flags = (ctx->force_ml ? fmt_measure_result_flag_force_ml : 0)
+			 | (ctx->trailing_comment ? fmt_measure_result_flag_trailing_comment : 0);
+	hash_set(&ctx->measured, &key, ((uint64_t)flags << 32) | len);
+
+	ctx->force_ml |= old_force_ml;
+	return len;
+}
+
 static uint32_t
 fmt_check(struct fmt_ctx *ctx, const struct fmt_stack *pfst, fmt_func func, uint32_t n_id)
 {
@@ -116,7 +185,7 @@ fmt_check(struct fmt_ctx *ctx, const struct fmt_stack *pfst, fmt_func func, uint
 	fst.node_sep = pfst->node_sep;
 
 	if (!fst.write) {
-		return func(ctx, &fst, n_id);
+		return fmt_measure(ctx, &fst, func, n_id);
 	}
 
 	bool old_force_ml = ctx->force_ml;
@@ -126,9 +195,9 @@ fmt_check(struct fmt_ctx *ctx, const struct fmt_stack *pfst, fmt_func func, uint
 	tmp.write = false;
 	tmp.ml = false;
 
-	uint32_t len = func(ctx, &tmp, n_id);
+	uint32_t len = fmt_measure(ctx, &tmp, func, n_id);
 
-	fst.ml = ctx->force_ml || (len + ctx->col > ctx->max_line_len);
+	fst.ml = ctx->force_ml || (len + ctx->col > ctx->opts.max_line_len);
 
 	len = func(ctx, &fst, n_id);
 
@@ -209,7 +278,7 @@ fmt_newline(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t next)
 		}
 
 		for (i = 0; i < ctx->indent; ++i) {
-			fmt_writes(ctx, pfst, ctx->indent_by);
+			fmt_writes(ctx, pfst, ctx->opts.indent_by);
 		}
 	}
 }
@@ -237,7 +306,7 @@ fmt_newline_or_space(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t
 static uint32_t
 fmt_breaking_space(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t next)
 {
-	if (ctx->col >= ctx->max_line_len) {
+	if (ctx->col >= ctx->opts.max_line_len) {
 		fmt_newline_force(ctx, pfst, next);
 		ctx->force_ml = true;
 		return 0;
@@ -390,7 +459,7 @@ fmt_args(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t n_args)
 
 	++ctx->enclosed;
 	fmt_begin_block(ctx);
-	if (pfst->arg_container[0] == '[' && ctx->space_array) {
+	if (pfst->arg_container[0] == '[' && ctx->opts.space_array) {
 		fmt_newline_or_space(ctx, &fst, n_args);
 	} else {
 		fmt_newline(ctx, &fst, n_args);
@@ -434,7 +503,7 @@ fmt_args(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t n_args)
 			break;
 		}
 	}
-	if (kwa > 1 && ctx->kwa_ml) {
+	if (kwa > 1 && ctx->opts.kwa_ml) {
 		ctx->force_ml = true;
 	}
 
@@ -456,7 +525,7 @@ fmt_args(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t n_args)
 				fst.special_fmt |= special_fmt_cmd_array;
 			}
 
-			const char *kw_sep = ctx->wide_colon ? " : " : ": ";
+			const char *kw_sep = ctx->opts.wide_colon ? " : " : ": ";
 
 			if (ae->type) {
 				fst.node_sep = 0;
@@ -476,7 +545,7 @@ fmt_args(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t n_args)
 			// never put commas on empty lines
 			need_comma = false;
 		} else if (pfst->arg_container[0] == '('
-			   && ctx->no_single_comma_function
+			   && ctx->opts.no_single_comma_function
 			   && args.len == 1
 			   && !ae->kw) {
 			need_comma = false;
@@ -516,7 +585,7 @@ fmt_args(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t n_args)
 
 	--ctx->enclosed;
 	fmt_end_block(ctx);
-	if (pfst->arg_container[1] == ']' && ctx->space_array) {
+	if (pfst->arg_container[1] == ']' && ctx->opts.space_array) {
 		fmt_newline_or_space(ctx, &fst, 0);
 	}else {
 		fmt_newline(ctx, &fst, 0);
@@ -1000,7 +1069,7 @@ static bool
 fmt_cfg_parse_cb(void *_ctx, struct source *src, const char *sect,
 	const char *k, const char *v, uint32_t line)
 {
-	struct fmt_ctx *ctx = _ctx;
+	struct fmt_opts *opts = _ctx;
 
 	enum val_type {
 		type_uint,
@@ -1009,13 +1078,13 @@ fmt_cfg_parse_cb(void *_ctx, struct source *src, const char *sect,
 	};
 
 	static const struct { const char *name; enum val_type type; uint32_t off; } keys[] = {
-		{ "max_line_len", type_uint, offsetof(struct fmt_ctx, max_line_len) },
-		{ "indent_by", type_str, offsetof(struct fmt_ctx, indent_by) },
-		{ "space_array", type_bool, offsetof(struct fmt_ctx, space_array) },
-		{ "kwargs_force_multiline", type_bool, offsetof(struct fmt_ctx, kwa_ml) },
-		{ "kwa_ml", type_bool, offsetof(struct fmt_ctx, kwa_ml) }, // kept for backwards compat
-		{ "wide_colon", type_bool, offsetof(struct fmt_ctx, wide_colon) },
-		{ "no_single_comma_function", type_bool, offsetof(struct fmt_ctx, no_single_comma_function) },
+		{ "max_line_len", type_uint, offsetof(struct fmt_opts, max_line_len) },
+		{ "indent_by", type_str, offsetof(struct fmt_opts, indent_by) },
+		{ "space_array", type_bool, offsetof(struct fmt_opts, space_array) },
+		{ "kwargs_force_multiline", type_bool, offsetof(struct fmt_opts, kwa_ml) },
+		{ "kwa_ml", type_bool, offsetof(struct fmt_opts, kwa_ml) }, // kept for backwards compat
+		{ "wide_colon", type_bool, offsetof(struct fmt_opts, wide_colon) },
+		{ "no_single_comma_function", type_bool, offsetof(struct fmt_opts, no_single_comma_function) },
 		0
 	};
 
@@ -1033,7 +1102,7 @@ fmt_cfg_parse_cb(void *_ctx, struct source *src, const char *sect,
 	uint32_t i;
 	for (i = 0; keys[i].name; ++i) {
 		if (strcmp(k, keys[i].name) == 0) {
-			void *val_dest = ((uint8_t *)ctx + keys[i].off);
+			void *val_dest = ((uint8_t *)opts + keys[i].off);
 
 			switch (keys[i].type) {
 			case type_uint: {
@@ -1088,8 +1157,64 @@ fmt_cfg_parse_cb(void *_ctx, struct source *src, const char *sect,
 	return true;
 }
 
+void
+fmt_opts_init(struct fmt_opts *opts)
+{
+	*opts = (struct fmt_opts) {
+		.max_line_len = 80,
+		.indent_by = "    ",
+		.space_array = false,
+		.kwa_ml = false,
+		.wide_colon = false,
+		.no_single_comma_function = false,
+	};
+}
+
 bool
-fmt(struct source *src, FILE *out, const char *cfg_path, bool check_only, bool editorconfig)
+fmt_opts_load(struct fmt_opts *opts, const char *cfg_path)
+{
+	const char *indent_by = opts->indent_by;
+	if (!fs_read_entire_file(cfg_path, &opts->cfg_src)) {
+		return false;
+	} else if (!ini_parse(cfg_path, &opts->cfg_src, &opts->cfg_buf, fmt_cfg_parse_cb, opts)) {
+		return false;
+	}
+
+	opts->cfg_sets_indent_by = opts->indent_by != indent_by;
+	return true;
+}
+
+void
+fmt_opts_destroy(struct fmt_opts *opts)
+{
+	if (opts->cfg_buf) {
+		z_free(opts->cfg_buf);
+	}
+	fs_source_destroy(&opts->cfg_src);
+}
+
+/*
+ * The indentation from .editorconfig applies unless the config file sets
+ * indent_by.  The returned opts are only valid until the next call.
+ */
+void
+fmt_opts_for_file(const struct fmt_opts *opts, struct source *src, struct fmt_opts *res)
+{
+	*res = *opts;
+
+	if (opts->cfg_sets_indent_by) {
+		return;
+	}
+
+	struct editorconfig_opts editorconfig_opts = { 0 };
+	try_parse_editorconfig(src, &editorconfig_opts);
+	if (editorconfig_opts.indent_by) {
+		res->indent_by = editorconfig_opts.indent_by;
+	}
+}
+
+bool
+fmt(struct source *src, FILE *out, const struct fmt_opts *opts, bool check_only)
 {
 	bool ret = false;
 	struct ast ast = { 0 };
@@ -1101,12 +1226,7 @@ fmt(struct source *src, FILE *out, const char *cfg_path, bool check_only, bool e
 		.ast = &ast,
 		.wk = &wk,
 		.out_buf = &out_buf,
-		.max_line_len = 80,
-		.indent_by = "    ",
-		.space_array = false,
-		.kwa_ml = false,
-		.wide_colon = false,
-		.no_single_comma_function = false,
+		.opts = *opts,
 	};
 	struct fmt_stack fst = {
 		.write = true,
@@ -1119,24 +1239,7 @@ fmt(struct source *src, FILE *out, const char *cfg_path, bool check_only, bool e
 		out_buf.buf = (void *)out;
 	}
 
-	if (editorconfig) {
-		struct editorconfig_opts editorconfig_opts;
-		try_parse_editorconfig(src, &editorconfig_opts);
-		if (editorconfig_opts.indent_by) {
-			ctx.indent_by = editorconfig_opts.indent_by;
-		}
-	}
-
-	char *cfg_buf = NULL;
-	struct source cfg_src = { 0 };
-	if (cfg_path) {
-		if (!fs_read_entire_file(cfg_path, &cfg_src)) {
-			goto ret;
-		} else if (!ini_parse(cfg_path, &cfg_src, &cfg_buf, fmt_cfg_parse_cb, &ctx)) {
-			goto ret;
-		}
-	}
-
+	hash_init(&ctx.measured, 1024, sizeof(struct fmt_measure_key));
 	enum parse_mode parse_mode = pm_keep_formatting | pm_ignore_statement_with_no_effect;
 	if (str_endswith(&WKSTR(src->label), &WKSTR(".meson"))) {
 		parse_mode |= pm_functions;
@@ -1160,12 +1263,9 @@ fmt(struct source *src, FILE *out, const char *cfg_path, bool check_only, bool e
 
 	ret = true;
 ret:
+	hash_destroy(&ctx.measured);
 	workspace_destroy_bare(&wk);
-	if (cfg_buf) {
-		z_free(cfg_buf);
-	}
 	sbuf_destroy(&out_buf);
-	fs_source_destroy(&cfg_src);
 	ast_destroy(&ast);
 	source_data_destroy(&sdata);
 	return ret;
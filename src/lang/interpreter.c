@@ -92,44 +92,33 @@ rangecheck(struct workspace *wk, uint32_t n_id, int64_t min, int64_t max, int64_
 	return true;
 }
 
-struct check_scope_ctx {
-	const char *name;
-	obj res, scope;
-	bool found;
-};
-
-static enum iteration_result
-check_scope(struct workspace *wk, void *_ctx, obj scope)
-{
-	struct check_scope_ctx *ctx = _ctx;
-	if (obj_dict_index_str(wk, scope, ctx->name, &ctx->res)) {
-		ctx->scope = scope;
-		ctx->found = true;
-	}
-	return ir_cont;
-}
-
+/*
+ * Scopes are dicts keyed by symbol, see make_sym().  Lookups start at the
+ * innermost scope.
+ */
 static bool
-get_local_variable(struct workspace *wk, const char *name, struct project *proj, obj *res, obj *scope)
+get_local_variable(struct workspace *wk, obj sym, struct project *proj, obj *res, obj *scope)
 {
-	struct check_scope_ctx ctx = { .name = name };
-	obj_array_foreach(wk, proj->scope_stack, &ctx, check_scope);
+	uint32_t i = get_obj_array(wk, proj->scope_stack)->len;
 
-	if (ctx.found) {
-		*res = ctx.res;
-		*scope = ctx.scope;
-		return true;
+	while (i) {
+		--i;
+		obj_array_index(wk, proj->scope_stack, i, scope);
+
+		if (obj_dict_geti(wk, *scope, sym, res)) {
+			return true;
+		}
 	}
 
 	return false;
 }
 
 bool
-get_variable(struct workspace *wk, const char *name, obj *res, uint32_t proj_id)
+get_variable(struct workspace *wk, obj sym, obj *res, uint32_t proj_id)
 {
 	obj o, _scope;
 
-	if (get_local_variable(wk, name, arr_get(&wk->projects, proj_id), &o, &_scope)) {
+	if (get_local_variable(wk, sym, arr_get(&wk->projects, proj_id), &o, &_scope)) {
 		*res = o;
 		return true;
 	} else {
@@ -157,11 +146,18 @@ scope_stack_dup(struct workspace *wk, obj scope_stack)
 	return r;
 }
 
+void
+make_scope(struct workspace *wk, obj *res)
+{
+	make_obj(wk, res, obj_dict);
+	get_obj_dict(wk, *res)->flags |= obj_dict_flag_int_key;
+}
+
 void
 push_local_scope(struct workspace *wk)
 {
 	obj scope;
-	make_obj(wk, &scope, obj_dict);
+	make_scope(wk, &scope);
 	obj_array_push(wk, current_project(wk)->scope_stack, scope);
 }
 
@@ -172,37 +168,36 @@ pop_local_scope(struct workspace *wk)
 }
 
 void
-assign_variable(struct workspace *wk, const char *name, obj o, uint32_t _n_id, enum variable_assignment_mode mode)
+assign_variable(struct workspace *wk, obj sym, obj o, uint32_t _n_id, enum variable_assignment_mode mode)
 {
 	struct project *proj = current_project(wk);
 	obj scope = 0;
 	if (mode == assign_reassign) {
 		obj _;
-		if (!get_local_variable(wk, name, current_project(wk), &_, &scope)) {
+		if (!get_local_variable(wk, sym, current_project(wk), &_, &scope)) {
 			UNREACHABLE;
 		}
 	} else {
-		uint32_t len = get_obj_array(wk, proj->scope_stack)->len;
-		obj_array_index(wk, proj->scope_stack, len - 1, &scope);
+		scope = obj_array_get_tail(wk, proj->scope_stack);
 	}
 
-	obj_dict_set(wk, scope, make_str(wk, name), o);
+	obj_dict_seti(wk, scope, sym, o);
 
-	if (wk->dbg.watched && obj_array_in(wk, wk->dbg.watched, make_str(wk, name))) {
-		LOG_I("watched variable \"%s\" changed", name);
+	if (wk->dbg.watched && obj_array_in(wk, wk->dbg.watched, sym)) {
+		LOG_I("watched variable \"%s\" changed", get_cstr(wk, sym));
 		repl(wk, true);
 	}
 }
 
 void
-unassign_variable(struct workspace *wk, const char *name)
+unassign_variable(struct workspace *wk, obj sym)
 {
 	obj _, scope;
-	if (!get_local_variable(wk, name, current_project(wk), &_, &scope)) {
+	if (!get_local_variable(wk, sym, current_project(wk), &_, &scope)) {
 		return;
 	}
 
-	obj_dict_del_str(wk, scope, name);
+	obj_dict_deli(wk, scope, sym);
 }
 
 static bool interp_chained(struct workspace *wk, uint32_t node_id, obj l_id, obj *res);
@@ -218,7 +213,7 @@ interp_func(struct workspace *wk, uint32_t n_id, bool chained, obj l_id, obj *re
 		// NOTE: This is to simulate looking up function objects for
 		// builtins.
 		struct node *l = get_node(wk->ast, n->l);
-		if (l->type == node_id && func_lookup(kernel_func_tbl, wk->lang_mode, l->dat.s)) {
+		if (l->type == node_id && func_lookup_node(wk, kernel_func_tbl, 0, n->l)) {
 			have_rcvr = false;
 			l_id = 0;
 		} else {
@@ -571,7 +566,7 @@ interp_assign(struct workspace *wk, struct node *n, obj *_)
 		return false;
 	}
 
-	wk->assign_variable(wk, get_node(wk->ast, n->l)->dat.s, rhs, 0, assign_local);
+	wk->assign_variable(wk, get_node(wk->ast, n->l)->l, rhs, 0, assign_local);
 	return true;
 }
 
@@ -585,59 +580,48 @@ interp_plusassign(struct workspace *wk, uint32_t n_id, obj *_)
 		return false;
 	}
 
-	wk->assign_variable(wk, get_node(wk->ast, n->l)->dat.s, rhs, 0, assign_reassign);
+	wk->assign_variable(wk, get_node(wk->ast, n->l)->l, rhs, 0, assign_reassign);
 	return true;
 }
 
 static bool
 interp_array(struct workspace *wk, uint32_t n_id, obj *res)
 {
-	obj l, r;
-
-	struct node *n = get_node(wk->ast, n_id);
-	n->chflg |= node_visited;
+	// res isn't set until all elements are evaluated, since it may be
+	// e.g. wk->returned, which a function call in an element overwrites
+	obj l, arr;
+	make_obj(wk, &arr, obj_array);
 
-	if (n->type == node_empty) {
-		make_obj(wk, res, obj_array);
-		struct obj_array *arr = get_obj_array(wk, *res);
-		arr->len = 0;
-		arr->tail = *res;
-		return true;
-	}
+	while (true) {
+		struct node *n = get_node(wk->ast, n_id);
+		n->chflg |= node_visited;
 
-	if (n->subtype == arg_kwarg) {
-		interp_error(wk, n->l, "kwarg not valid in array constructor");
-		return false;
-	}
+		if (n->type == node_empty) {
+			*res = arr;
+			return true;
+		}
 
-	bool have_c = n->chflg & node_child_c && get_node(wk->ast, n->c)->type != node_empty;
+		if (n->subtype == arg_kwarg) {
+			interp_error(wk, n->l, "kwarg not valid in array constructor");
+			return false;
+		}
 
-	if (!wk->interp_node(wk, n->l, &l)) {
-		return false;
-	}
+		bool have_c = n->chflg & node_child_c && get_node(wk->ast, n->c)->type != node_empty;
+		uint32_t c = n->c;
 
-	if (have_c) {
-		if (!interp_array(wk, n->c, &r)) {
+		if (!wk->interp_node(wk, n->l, &l)) {
 			return false;
 		}
-	}
 
-	make_obj(wk, res, obj_array);
-	struct obj_array *arr = get_obj_array(wk, *res);
-	arr->val = l;
+		obj_array_push(wk, arr, l);
 
-	if ((arr->have_next = have_c)) {
-		struct obj_array *arr_r = get_obj_array(wk, r);
+		if (!have_c) {
+			*res = arr;
+			return true;
+		}
 
-		arr->len = arr_r->len + 1;
-		arr->tail = arr_r->tail;
-		arr->next = r;
-	} else {
-		arr->len = 1;
-		arr->tail = *res;
+		n_id = c;
 	}
-
-	return true;
 }
 
 static bool
@@ -922,7 +906,7 @@ interp_if(struct workspace *wk, struct node *n, obj *res)
 }
 
 struct interp_foreach_ctx {
-	const char *id1, *id2;
+	obj id1, id2;
 	uint32_t n_l, n_r;
 	uint32_t block_node;
 };
@@ -997,7 +981,7 @@ interp_foreach(struct workspace *wk, struct node *n, obj *res)
 			}
 
 			struct interp_foreach_ctx ctx = {
-				.id1 = get_node(wk->ast, args->l)->dat.s,
+				.id1 = get_node(wk->ast, args->l)->l,
 				.n_l = args->l,
 				.block_node = n->c,
 			};
@@ -1048,7 +1032,7 @@ interp_foreach(struct workspace *wk, struct node *n, obj *res)
 		}
 
 		struct interp_foreach_ctx ctx = {
-			.id1 = get_node(wk->ast, args->l)->dat.s,
+			.id1 = get_node(wk->ast, args->l)->l,
 			.n_l = args->l,
 			.block_node = n->c,
 		};
@@ -1069,8 +1053,8 @@ interp_foreach(struct workspace *wk, struct node *n, obj *res)
 		assert(get_node(wk->ast, get_node(wk->ast, args->r)->type == node_foreach_args));
 
 		struct interp_foreach_ctx ctx = {
-			.id1 = get_node(wk->ast, args->l)->dat.s,
-			.id2 = get_node(wk->ast, get_node(wk->ast, args->r)->l)->dat.s,
+			.id1 = get_node(wk->ast, args->l)->l,
+			.id2 = get_node(wk->ast, get_node(wk->ast, args->r)->l)->l,
 			.n_l = args->l,
 			.n_r = get_node(wk->ast, args->r)->l,
 			.block_node = n->c,
@@ -1139,7 +1123,7 @@ interp_func_def(struct workspace *wk, struct node *n, obj *res)
 	}
 
 	f->name = get_node(wk->ast, n->l)->dat.s;
-	wk->assign_variable(wk, f->name, *res, n->l, assign_local);
+	wk->assign_variable(wk, get_node(wk->ast, n->l)->l, *res, n->l, assign_local);
 	return true;
 }
 
@@ -1189,7 +1173,7 @@ interp_node(struct workspace *wk, uint32_t n_id, obj *res)
 		ret = interp_dict(wk, n->l, res);
 		break;
 	case node_id:
-		if (!wk->get_variable(wk, n->dat.s, res, wk->cur_project)) {
+		if (!wk->get_variable(wk, n->l, res, wk->cur_project)) {
 			interp_error(wk, n_id, "undefined object");
 			ret = false;
 			break;
@@ -256,6 +256,7 @@ make_obj(struct workspace *wk, obj *id, enum obj_type type)
 	if (wk->tracy.is_master_workspace) {
 		uint64_t mem = 0;
 		mem += bucket_arr_size(&wk->objs);
+		mem += wk->array_elems.cap * wk->array_elems.item_size;
 		uint32_t i;
 		for (i = 0; i < obj_type_count - _obj_aos_start; ++i) {
 			mem += bucket_arr_size(&wk->obj_aos[i]);
@@ -274,6 +275,7 @@ obj_set_clear_mark(struct workspace *wk, struct obj_clear_mark *mk)
 {
 	wk->obj_clear_mark_set = true;
 	mk->obji = wk->objs.len;
+	mk->array_elems = wk->array_elems.len;
 
 	bucket_arr_save(&wk->chrs, &mk->chrs);
 	bucket_arr_save(&wk->objs, &mk->objs);
@@ -303,6 +305,7 @@ obj_clear(struct workspace *wk, const struct obj_clear_mark *mk)
 
 	bucket_arr_restore(&wk->objs, &mk->objs);
 	bucket_arr_restore(&wk->chrs, &mk->chrs);
+	wk->array_elems.len = mk->array_elems;
 
 	for (i = 0; i < obj_type_count - _obj_aos_start; ++i) {
 		bucket_arr_restore(&wk->obj_aos[i], &mk->obj_aos[i]);
@@ -494,17 +497,53 @@ obj_equal(struct workspace *wk, obj left, obj right)
  * arrays
  */
 
+static obj *
+obj_array_elem(struct workspace *wk, const struct obj_array *a, uint32_t i)
+{
+	assert(i < a->len);
+	return arr_get(&wk->array_elems, a->data + i);
+}
+
+/*
+ * Make room for at least cap elements.  If the array is the last one in
+ * wk->array_elems it is grown in place, otherwise it is moved to the end.
+ * The space it occupied is not reused, but since capacity is doubled when
+ * pushing this wastes at most as many elements as are in use.
+ */
+static void
+obj_array_reserve(struct workspace *wk, struct obj_array *a, uint32_t cap)
+{
+	if (cap <= a->cap) {
+		return;
+	}
+
+	struct arr *elems = &wk->array_elems;
+
+	if (a->cap && a->data + a->cap == elems->len) {
+		arr_grow_by(elems, cap - a->cap);
+	} else {
+		uint32_t data = elems->len;
+		arr_grow_by(elems, cap);
+
+		if (a->len) {
+			memcpy(arr_get(elems, data), arr_get(elems, a->data), a->len * sizeof(obj));
+		}
+
+		a->data = data;
+	}
+
+	a->cap = cap;
+}
+
 bool
 obj_array_foreach(struct workspace *wk, obj arr, void *ctx, obj_array_iterator cb)
 {
 	struct obj_array *a = get_obj_array(wk, arr);
 
-	if (!a->len) {
-		return true;
-	}
-
-	while (true) {
-		switch (cb(wk, ctx, a->val)) {
+	uint32_t i;
+	// the callback may push to this array, so its storage can move
+	for (i = 0; i < a->len; ++i) {
+		switch (cb(wk, ctx, *obj_array_elem(wk, a, i))) {
 		case ir_cont:
 			break;
 		case ir_done:
@@ -512,12 +551,6 @@ obj_array_foreach(struct workspace *wk, obj arr, void *ctx, obj_array_iterator c
 		case ir_err:
 			return false;
 		}
-
-		if (!a->have_next) {
-			break;
-		}
-
-		a = get_obj_array(wk, a->next);
 	}
 
 	return true;
@@ -565,30 +598,14 @@ obj_array_foreach_flat(struct workspace *wk, obj arr, void *usr_ctx, obj_array_i
 void
 obj_array_push(struct workspace *wk, obj arr, obj child)
 {
-	obj child_arr;
-	struct obj_array *a, *tail, *c;
+	struct obj_array *a = get_obj_array(wk, arr);
 
-	if (!(a = get_obj_array(wk, arr))->len) {
-		a->tail = arr;
-		a->len = 1;
-		a->val = child;
-		a->have_next = false;
-		return;
+	if (a->len == a->cap) {
+		obj_array_reserve(wk, a, a->cap ? a->cap * 2 : 4);
 	}
 
-	make_obj(wk, &child_arr, obj_array);
-	c = get_obj_array(wk, child_arr);
-	c->val = child;
-
-	a = get_obj_array(wk, arr);
-	tail = get_obj_array(wk, a->tail);
-	assert(!tail->have_next);
-
-	tail->have_next = true;
-	tail->next = child_arr;
-
-	a->tail = child_arr;
 	++a->len;
+	*obj_array_elem(wk, a, a->len - 1) = child;
 }
 
 void
@@ -596,39 +613,27 @@ obj_array_prepend(struct workspace *wk, obj *arr, obj val)
 {
 	obj prepend;
 	make_obj(wk, &prepend, obj_array);
+	obj_array_reserve(wk, get_obj_array(wk, prepend), get_obj_array(wk, *arr)->len + 1);
 	obj_array_push(wk, prepend, val);
 	obj_array_extend_nodup(wk, prepend, *arr);
 	*arr = prepend;
 }
 
-struct obj_array_index_of_iter_ctx {
-	obj l;
-	bool res;
-	uint32_t i;
-};
-
-static enum iteration_result
-obj_array_index_of_iter(struct workspace *wk, void *_ctx, obj v)
-{
-	struct obj_array_index_of_iter_ctx *ctx = _ctx;
-
-	if (obj_equal(wk, ctx->l, v)) {
-		ctx->res = true;
-		return ir_done;
-	}
-
-	++ctx->i;
-	return ir_cont;
-}
-
 bool
 obj_array_index_of(struct workspace *wk, obj arr, obj val, uint32_t *idx)
 {
-	struct obj_array_index_of_iter_ctx ctx = { .l = val };
-	obj_array_foreach(wk, arr, &ctx, obj_array_index_of_iter);
+	struct obj_array *a = get_obj_array(wk, arr);
+
+	uint32_t i;
+	for (i = 0; i < a->len; ++i) {
+		if (obj_equal(wk, val, *obj_array_elem(wk, a, i))) {
+			*idx = i;
+			return true;
+		}
+	}
 
-	*idx = ctx.i;
-	return ctx.res;
+	*idx = i;
+	return false;
 }
 
 bool
@@ -638,85 +643,56 @@ obj_array_in(struct workspace *wk, obj arr, obj val)
 	return obj_array_index_of(wk, arr, val, &_);
 }
 
-struct obj_array_index_iter_ctx { obj res, i, tgt; };
-
-static enum iteration_result
-obj_array_index_iter(struct workspace *wk, void *_ctx, obj v)
-{
-	struct obj_array_index_iter_ctx *ctx = _ctx;
-
-	if (ctx->i == ctx->tgt) {
-		ctx->res = v;
-		return ir_done;
-	}
-
-	++ctx->i;
-	return ir_cont;
-}
-
 void
 obj_array_index(struct workspace *wk, obj arr, int64_t i, obj *res)
 {
-	struct obj_array_index_iter_ctx ctx = { .tgt = i };
-	assert(i >= 0 && i < get_obj_array(wk, arr)->len);
-	obj_array_foreach(wk, arr, &ctx, obj_array_index_iter);
-	*res = ctx.res;
+	struct obj_array *a = get_obj_array(wk, arr);
+	assert(i >= 0 && i < a->len);
+	*res = *obj_array_elem(wk, a, i);
 }
 
 obj
 obj_array_get_tail(struct workspace *wk, obj arr)
 {
-	return get_obj_array(wk, get_obj_array(wk, arr)->tail)->val;
-}
-
-struct obj_array_dup_ctx { obj *arr; };
-
-static enum iteration_result
-obj_array_dup_iter(struct workspace *wk, void *_ctx, obj v)
-{
-	struct obj_array_dup_ctx *ctx = _ctx;
-	obj_array_push(wk, *ctx->arr, v);
-	return ir_cont;
+	struct obj_array *a = get_obj_array(wk, arr);
+	return *obj_array_elem(wk, a, a->len - 1);
 }
 
 void
 obj_array_dup(struct workspace *wk, obj arr, obj *res)
 {
-	struct obj_array_dup_ctx ctx = { .arr = res };
 	make_obj(wk, res, obj_array);
-	obj_array_foreach(wk, arr, &ctx, obj_array_dup_iter);
+	obj_array_extend_nodup(wk, *res, arr);
 }
 
+/*
+ * Since arrays no longer share storage, this is the same as
+ * obj_array_extend().
+ */
 void
 obj_array_extend_nodup(struct workspace *wk, obj arr, obj arr2)
 {
-	struct obj_array *a, *b, *tail;
+	struct obj_array *a = get_obj_array(wk, arr),
+			 *b = get_obj_array(wk, arr2);
 
-	if (!(b = get_obj_array(wk, arr2))->len) {
+	uint32_t len = b->len;
+	if (!len) {
 		return;
 	}
 
-	if (!(a = get_obj_array(wk, arr))->len) {
-		struct obj_array_dup_ctx ctx = { .arr = &arr };
-		obj_array_foreach(wk, arr2, &ctx, obj_array_dup_iter);
-		return;
-	}
+	obj_array_reserve(wk, a, a->len + len);
 
-	tail = get_obj_array(wk, a->tail);
-	assert(!tail->have_next);
-	tail->have_next = true;
-	tail->next = arr2;
+	memmove(arr_get(&wk->array_elems, a->data + a->len),
+		arr_get(&wk->array_elems, b->data),
+		len * sizeof(obj));
 
-	a->tail = b->tail;
-	a->len += b->len;
+	a->len += len;
 }
 
 void
 obj_array_extend(struct workspace *wk, obj arr, obj arr2)
 {
-	obj dup;
-	obj_array_dup(wk, arr2, &dup);
-	obj_array_extend_nodup(wk, arr, dup);
+	obj_array_extend_nodup(wk, arr, arr2);
 }
 
 struct obj_array_join_ctx {
@@ -789,13 +765,10 @@ obj_array_join(struct workspace *wk, bool flat, obj arr, obj join, obj *res)
 void
 obj_array_tail(struct workspace *wk, obj arr, obj *res)
 {
-	const struct obj_array *a = get_obj_array(wk, arr);
+	uint32_t len = get_obj_array(wk, arr)->len;
 
-	if (a->have_next) {
-		struct obj_array *n = get_obj_array(wk, a->next);
-		n->tail = a->tail;
-		n->len = a->len;
-		*res = a->next;
+	if (len > 1) {
+		*res = obj_array_slice(wk, arr, 1, -1);
 	} else {
 		// the tail of a zero or single element array is an empty array
 		make_obj(wk, res, obj_array);
@@ -805,103 +778,174 @@ obj_array_tail(struct workspace *wk, obj arr, obj *res)
 void
 obj_array_set(struct workspace *wk, obj arr, int64_t i, obj v)
 {
-	assert(i >= 0 && i < get_obj_array(wk, arr)->len);
-
-	uint32_t j = 0;
+	struct obj_array *a = get_obj_array(wk, arr);
+	assert(i >= 0 && i < a->len);
+	*obj_array_elem(wk, a, i) = v;
+}
 
-	while (true) {
-		if (j == i) {
-			get_obj_array(wk, arr)->val = v;
-			return;
-		}
+void
+obj_array_del(struct workspace *wk, obj arr, int64_t i)
+{
+	struct obj_array *a = get_obj_array(wk, arr);
+	assert(i >= 0 && i < a->len);
 
-		assert(get_obj_array(wk, arr)->have_next);
-		arr = get_obj_array(wk, arr)->next;
-		++j;
+	if (i < a->len - 1) {
+		memmove(obj_array_elem(wk, a, i), obj_array_elem(wk, a, i + 1),
+			(a->len - 1 - i) * sizeof(obj));
 	}
 
-	assert(false && "unreachable");
+	--a->len;
 }
 
-void
-obj_array_del(struct workspace *wk, obj arr, int64_t i)
+obj
+obj_array_pop(struct workspace *wk, obj arr)
 {
-	uint32_t j = 0;
-	obj p = arr;
-	struct obj_array *head = get_obj_array(wk, arr),
-			 *prev, *next,
-			 *del;
+	obj t = obj_array_get_tail(wk, arr);
+	obj_array_del(wk, arr, get_obj_array(wk, arr)->len - 1);
+	return t;
+}
 
-	assert(i >= 0 && i < head->len);
+/*
+ * ordered sets
+ *
+ * An array paired with a hash index of its elements, keyed by value so that
+ * elements are unique according to obj_equal.  This makes pushing into a
+ * deduplicated array O(1) rather than having to scan it with obj_array_in.
+ */
 
-	if (i == 0) {
-		if (head->have_next) {
-			next = get_obj_array(wk, head->next);
-			next->len = head->len - 1;
-			next->tail = head->tail;
-			*head = *next;
-		} else {
-			*head = (struct obj_array) { 0 };
-		}
+struct obj_ordered_set_key {
+	struct workspace *wk;
+	obj val;
+};
 
-		return;
+static uint64_t
+obj_hash_mix(uint64_t h, uint64_t v)
+{
+	return (h ^ v) * 1099511628211u;
+}
+
+static uint64_t
+obj_hash_str(uint64_t h, const struct str *s)
+{
+	uint32_t i;
+	for (i = 0; i < s->len; ++i) {
+		h = obj_hash_mix(h, (uint8_t)s->s[i]);
 	}
 
-	while (true) {
-		if (j == i) {
-			del = get_obj_array(wk, arr);
-			break;
-		}
+	return h;
+}
 
-		p = arr;
-		assert(get_obj_array(wk, arr)->have_next);
-		arr = get_obj_array(wk, arr)->next;
-		++j;
-	}
+/*
+ * Must be consistent with obj_equal: objects that compare equal have to hash
+ * to the same value.
+ */
+static uint64_t
+obj_hash_value(struct workspace *wk, obj val)
+{
+	enum obj_type t = get_obj_type(wk, val);
+	uint64_t h = obj_hash_mix(14695981039346656037u, t);
 
-	prev = get_obj_array(wk, p);
+	switch (t) {
+	case obj_string:
+		return obj_hash_str(h, get_str(wk, val));
+	case obj_file:
+		return obj_hash_str(h, get_str(wk, *get_obj_file(wk, val)));
+	case obj_number:
+		return obj_hash_mix(h, get_obj_number(wk, val));
+	case obj_bool:
+		return obj_hash_mix(h, get_obj_bool(wk, val));
+	case obj_feature_opt:
+		return obj_hash_mix(h, get_obj_feature_opt(wk, val));
+	case obj_array: {
+		struct obj_array *a = get_obj_array(wk, val);
 
-	if (del->have_next) {
-		prev->next = del->next;
-	} else {
-		head->tail = p;
-		prev->have_next = false;
+		uint32_t i;
+		for (i = 0; i < a->len; ++i) {
+			h = obj_hash_mix(h, obj_hash_value(wk, *obj_array_elem(wk, a, i)));
+		}
+		return h;
 	}
+	case obj_include_directory: {
+		struct obj_include_directory *inc = get_obj_include_directory(wk, val);
+		return obj_hash_mix(obj_hash_value(wk, inc->path), inc->is_system);
+	}
+	case obj_dict:
+		// equal dicts may have their keys in a different order
+		return obj_hash_mix(h, get_obj_dict(wk, val)->len);
+	default:
+		return obj_hash_mix(h, val);
+	}
+}
 
-	--head->len;
+static uint64_t
+obj_ordered_set_hash(const struct hash *h, const void *_key)
+{
+	const struct obj_ordered_set_key *key = _key;
+	return obj_hash_value(key->wk, key->val);
 }
 
-obj
-obj_array_pop(struct workspace *wk, obj arr)
+static bool
+obj_ordered_set_keycmp(const struct hash *h, const void *_a, const void *_b)
 {
-	obj t = obj_array_get_tail(wk, arr);
-	obj_array_del(wk, arr, get_obj_array(wk, arr)->len - 1);
-	return t;
+	const struct obj_ordered_set_key *a = _a, *b = _b;
+	return obj_equal(a->wk, a->val, b->val);
 }
 
-static enum iteration_result
-obj_array_dedup_iter(struct workspace *wk, void *_ctx, obj val)
+void
+obj_ordered_set_init(struct workspace *wk, struct obj_ordered_set *set)
 {
-	if (hash_get(&wk->obj_hash, &val)) {
-		return ir_cont;
-	}
-	hash_set(&wk->obj_hash, &val, true);
+	make_obj(wk, &set->arr, obj_array);
+	hash_init(&set->index, 16, sizeof(struct obj_ordered_set_key));
+	set->index.hash_func = obj_ordered_set_hash;
+	set->index.keycmp = obj_ordered_set_keycmp;
+}
 
-	obj *res = _ctx;
-	if (!obj_array_in(wk, *res, val)) {
-		obj_array_push(wk, *res, val);
+void
+obj_ordered_set_destroy(struct obj_ordered_set *set)
+{
+	hash_destroy(&set->index);
+}
+
+bool
+obj_ordered_set_push(struct workspace *wk, struct obj_ordered_set *set, obj val)
+{
+	struct obj_ordered_set_key key = { .wk = wk, .val = val };
+
+	if (hash_get(&set->index, &key)) {
+		return false;
 	}
 
+	hash_set(&set->index, &key, true);
+	obj_array_push(wk, set->arr, val);
+	return true;
+}
+
+static enum iteration_result
+obj_ordered_set_extend_iter(struct workspace *wk, void *_ctx, obj val)
+{
+	obj_ordered_set_push(wk, _ctx, val);
 	return ir_cont;
 }
 
+void
+obj_ordered_set_extend(struct workspace *wk, struct obj_ordered_set *set, obj arr)
+{
+	if (!arr) {
+		return;
+	}
+
+	obj_array_foreach(wk, arr, set, obj_ordered_set_extend_iter);
+}
+
 void
 obj_array_dedup(struct workspace *wk, obj arr, obj *res)
 {
-	hash_clear(&wk->obj_hash);
+	struct obj_ordered_set set;
+	obj_ordered_set_init(wk, &set);
+	obj_ordered_set_extend(wk, &set, arr);
+	obj_ordered_set_destroy(&set);
 
-	make_obj(wk, res, obj_array);
-	obj_array_foreach(wk, arr, res, obj_array_dedup_iter);
+	*res = set.arr;
 }
 
 void
@@ -988,6 +1032,7 @@ obj_array_sort(struct workspace *wk, void *usr_ctx, obj arr, obj_array_sort_func
 	arr_sort(&da, &ctx, obj_array_sort_wrapper);
 
 	make_obj(wk, res, obj_array);
+	obj_array_reserve(wk, get_obj_array(wk, *res), da.len);
 
 	uint32_t i;
 	for (i = 0; i < da.len; ++i) {
@@ -997,47 +1042,32 @@ obj_array_sort(struct workspace *wk, void *usr_ctx, obj arr, obj_array_sort_func
 	arr_destroy(&da);
 }
 
-struct obj_array_slice_ctx {
-	int64_t i, i0, i1;
-	obj res;
-};
-
-static enum iteration_result
-obj_array_slice_iter(struct workspace *wk, void *_ctx, obj v)
-{
-	struct obj_array_slice_ctx *ctx = _ctx;
-
-	if (ctx->i >= ctx->i0) {
-		obj_array_push(wk, ctx->res, v);
-	}
-
-	++ctx->i;
-
-	if (ctx->i > ctx->i1) {
-		return ir_done;
-	}
-
-	return ir_cont;
-}
-
 obj
 obj_array_slice(struct workspace *wk, obj a, int64_t i0, int64_t i1)
 {
-	struct obj_array *arr = get_obj_array(wk, a);
-	if (!(bounds_adjust(wk, arr->len, &i0) && bounds_adjust(wk, arr->len, &i1))) {
+	uint32_t len = get_obj_array(wk, a)->len;
+	if (!(bounds_adjust(wk, len, &i0) && bounds_adjust(wk, len, &i1))) {
 		assert(false && "index out of bounds");
 	}
 
-	struct obj_array_slice_ctx ctx = {
-		.i0 = i0,
-		.i1 = i1,
-	};
+	obj res;
+	make_obj(wk, &res, obj_array);
+
+	// i1 is inclusive
+	if (i1 < i0) {
+		return res;
+	}
+
+	len = i1 - i0 + 1;
 
-	make_obj(wk, &ctx.res, obj_array);
+	struct obj_array *arr = get_obj_array(wk, a),
+			 *r = get_obj_array(wk, res);
 
-	obj_array_foreach(wk, a, &ctx, obj_array_slice_iter);
+	obj_array_reserve(wk, r, len);
+	memcpy(arr_get(&wk->array_elems, r->data), obj_array_elem(wk, arr, i0), len * sizeof(obj));
+	r->len = len;
 
-	return ctx.res;
+	return res;
 }
 
 /*
@@ -1058,6 +1088,11 @@ obj_dict_foreach(struct workspace *wk, obj dict, void *ctx, obj_dict_iterator cb
 		for (i = 0; i < h->keys.len; ++i) {
 			void *_key = arr_get(&h->keys, i);
 			uint64_t *_val = hash_get(h, _key);
+			if (!_val) {
+				// deleted
+				continue;
+			}
+
 			obj key = *_val >> 32;
 			obj val = *_val & 0xffffffff;
 
@@ -1103,12 +1138,26 @@ obj_dict_dup_iter(struct workspace *wk, void *_ctx, obj key, obj val)
 	return ir_cont;
 }
 
+static enum iteration_result
+obj_dict_dup_int_key_iter(struct workspace *wk, void *_ctx, obj key, obj val)
+{
+	struct obj_dict_dup_ctx *ctx = _ctx;
+	obj_dict_seti(wk, *ctx->dict, key, val);
+	return ir_cont;
+}
+
 void
 obj_dict_dup(struct workspace *wk, obj dict, obj *res)
 {
 	struct obj_dict_dup_ctx ctx = { .dict = res };
 	make_obj(wk, res, obj_dict);
-	obj_dict_foreach(wk, dict, &ctx, obj_dict_dup_iter);
+
+	if (get_obj_dict(wk, dict)->flags & obj_dict_flag_int_key) {
+		get_obj_dict(wk, *res)->flags |= obj_dict_flag_int_key;
+		obj_dict_foreach(wk, dict, &ctx, obj_dict_dup_int_key_iter);
+	} else {
+		obj_dict_foreach(wk, dict, &ctx, obj_dict_dup_iter);
+	}
 }
 
 static enum iteration_result
@@ -1278,7 +1327,7 @@ _obj_dict_set(struct workspace *wk, obj dict,
 			uint64_t uv = ((uint64_t)(e->key) << 32) | e->val;
 
 			if (d->flags & obj_dict_flag_int_key) {
-				hash_set(h, &key, uv);
+				hash_set(h, &e->key, uv);
 			} else {
 				const struct str *ss = get_str(wk, e->key);
 				/* LO("setting %s, %d to %ld, (%o=%o)\n", ss->s, ss->len, uv, (obj)(uv >> 32), (obj)(uv & 0xffffffff)); */
@@ -1308,7 +1357,7 @@ _obj_dict_set(struct workspace *wk, obj dict,
 	if ((d->flags & obj_dict_flag_big)) {
 		struct hash *h = bucket_arr_get(&wk->dict_hashes, d->data);
 		if (d->flags & obj_dict_flag_int_key) {
-			hash_set(h, &key, val);
+			hash_set(h, &key, ((uint64_t)key << 32) | val);
 		} else {
 			const struct str *ss = get_str(wk, key);
 			hash_set_strn(h, ss->s, ss->len, ((uint64_t)key << 32) | val);
@@ -1354,6 +1403,7 @@ _obj_dict_del(struct workspace *wk, obj dict,
 			hash_unset_strn(h, key->string.s, key->string.len);
 		}
 
+		d->len = h->len;
 		return;
 	}
 
@@ -1413,6 +1463,13 @@ obj_dict_del(struct workspace *wk, obj dict, obj key)
 	obj_dict_del_strn(wk, dict, k->s, k->len);
 }
 
+void
+obj_dict_deli(struct workspace *wk, obj dict, uint32_t key)
+{
+	union obj_dict_key_comparison_key k = { .num = key };
+	_obj_dict_del(wk, dict, &k, obj_dict_key_comparison_func_int);
+}
+
 /* dict convienence functions */
 
 void
@@ -1541,6 +1598,7 @@ obj_clone(struct workspace *wk_src, struct workspace *wk_dest, obj val, obj *ret
 		return true;
 	case obj_array:
 		make_obj(wk_dest, ret, t);
+		obj_array_reserve(wk_dest, get_obj_array(wk_dest, *ret), get_obj_array(wk_src, val)->len);
 		return obj_array_foreach(wk_src, val, &(struct obj_clone_ctx) {
 			.container = *ret, .wk_dest = wk_dest
 		}, obj_clone_array_iter);
@@ -1628,6 +1686,7 @@ obj_clone(struct workspace *wk_src, struct workspace *wk_dest, obj val, obj *ret
 
 		o->source = opt->source;
 		o->type = opt->type;
+		o->kind = opt->kind;
 		o->builtin = opt->builtin;
 		o->yield = opt->yield;
 
@@ -196,6 +196,12 @@ make_node(struct parser *p, uint32_t *idx, enum node_type t)
 		n->line = p->last_last->line;
 		n->col = p->last_last->col;
 		n->dat = p->last_last->dat;
+
+		if (t == node_id && p->wk) {
+			// resolve identifiers to symbols up front, so that
+			// variable lookups don't need to hash the name
+			n->l = make_sym(p->wk, n->dat.s);
+		}
 	}
 
 	return n;
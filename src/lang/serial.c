@@ -18,7 +18,7 @@
 
 #define SERIAL_MAGIC_LEN 8
 static const char serial_magic[SERIAL_MAGIC_LEN] = "muondump";
-static const uint32_t serial_version = 7;
+static const uint32_t serial_version = 8;
 
 static bool
 corrupted_dump(void)
@@ -28,6 +28,32 @@ corrupted_dump(void)
 }
 
 
+/*
+ * Dumps are loaded either from a file or from a buffer in memory, e.g. one
+ * that was embedded at build time.
+ */
+struct serial_reader {
+	FILE *f;
+	const uint8_t *buf;
+	uint64_t len, off;
+};
+
+static bool
+serial_read(struct serial_reader *r, void *dst, uint64_t size)
+{
+	if (r->f) {
+		return fs_fread(dst, size, r->f);
+	}
+
+	if (size > r->len - r->off) {
+		return corrupted_dump();
+	}
+
+	memcpy(dst, &r->buf[r->off], size);
+	r->off += size;
+	return true;
+}
+
 static bool
 dump_uint32(uint32_t v, FILE *f)
 {
@@ -41,15 +67,15 @@ dump_uint64(uint64_t v, FILE *f)
 }
 
 static bool
-load_uint32(uint32_t *v, FILE *f)
+load_uint32(uint32_t *v, struct serial_reader *r)
 {
-	return fs_fread(v, sizeof(uint32_t), f);
+	return serial_read(r, v, sizeof(uint32_t));
 }
 
 static bool
-load_uint64(uint64_t *v, FILE *f)
+load_uint64(uint64_t *v, struct serial_reader *r)
 {
-	return fs_fread(v, sizeof(uint64_t), f);
+	return serial_read(r, v, sizeof(uint64_t));
 }
 
 static bool
@@ -77,7 +103,7 @@ dump_bucket_arr(const struct bucket_arr *ba, FILE *f)
 }
 
 static bool
-load_bucket_arr(struct bucket_arr *ba, FILE *f)
+load_bucket_arr(struct bucket_arr *ba, struct serial_reader *r)
 {
 	uint32_t buckets_len;
 	uint32_t i;
@@ -85,7 +111,7 @@ load_bucket_arr(struct bucket_arr *ba, FILE *f)
 
 	assert(ba->len == 0);
 
-	if (!load_uint32(&buckets_len, f)) {
+	if (!load_uint32(&buckets_len, r)) {
 		return false;
 	}
 
@@ -95,7 +121,7 @@ load_bucket_arr(struct bucket_arr *ba, FILE *f)
 	for (i = 0; i < buckets_len; ++i) {
 		init_bucket(ba, &b);
 
-		if (!load_uint32(&b.len, f)) {
+		if (!load_uint32(&b.len, r)) {
 			goto done;
 		}
 
@@ -106,7 +132,7 @@ load_bucket_arr(struct bucket_arr *ba, FILE *f)
 
 		ba->len += b.len;
 
-		if (!fs_fread(b.mem, ba->item_size * b.len, f)) {
+		if (!serial_read(r, b.mem, ba->item_size * b.len)) {
 			goto done;
 		}
 
@@ -120,6 +146,50 @@ done:
 	return true;
 }
 
+uint32_t
+serial_format_version(void)
+{
+	return serial_version;
+}
+
+static bool
+dump_array_elems(const struct arr *elems, FILE *f)
+{
+	return dump_uint32(elems->len, f)
+	       && fs_fwrite(elems->e, elems->item_size * elems->len, f);
+}
+
+static bool
+load_array_elems(struct workspace *wk, struct serial_reader *r)
+{
+	uint32_t len;
+	if (!load_uint32(&len, r)) {
+		return false;
+	}
+
+	struct arr *elems = &wk->array_elems;
+	assert(elems->len == 0);
+
+	if (len) {
+		arr_grow_by(elems, len);
+
+		if (!serial_read(r, elems->e, elems->item_size * len)) {
+			return false;
+		}
+	}
+
+	uint32_t i;
+	const struct bucket_arr *ba = &wk->obj_aos[obj_array - _obj_aos_start];
+	for (i = 0; i < ba->len; ++i) {
+		const struct obj_array *a = bucket_arr_get(ba, i);
+		if (a->len > a->cap || a->cap > len || a->data > len - a->cap) {
+			return corrupted_dump();
+		}
+	}
+
+	return true;
+}
+
 static bool
 dump_serial_header(FILE *f)
 {
@@ -128,11 +198,11 @@ dump_serial_header(FILE *f)
 }
 
 static bool
-load_serial_header(FILE *f)
+load_serial_header(struct serial_reader *r)
 {
 	char buf[SERIAL_MAGIC_LEN] = { 0 };
 
-	if (!fs_fread(buf, SERIAL_MAGIC_LEN, f)) {
+	if (!serial_read(r, buf, SERIAL_MAGIC_LEN)) {
 		return false;
 	}
 
@@ -142,7 +212,7 @@ load_serial_header(FILE *f)
 	}
 
 	uint32_t v;
-	if (!load_uint32(&v, f)) {
+	if (!load_uint32(&v, r)) {
 		return false;
 	}
 
@@ -204,11 +274,11 @@ struct big_string_table {
 };
 
 static bool
-load_big_strings(struct workspace *wk, struct big_string_table *bst, FILE *f)
+load_big_strings(struct workspace *wk, struct big_string_table *bst, struct serial_reader *r)
 {
 	uint64_t len;
 	uint8_t *buf = NULL;
-	if (!load_uint64(&len, f)) {
+	if (!load_uint64(&len, r)) {
 		return false;
 	}
 
@@ -218,7 +288,7 @@ load_big_strings(struct workspace *wk, struct big_string_table *bst, FILE *f)
 		}
 
 		buf = z_calloc(1, len);
-		if (!fs_fread(buf, len, f)) {
+		if (!serial_read(r, buf, len)) {
 			return false;
 		}
 	}
@@ -323,10 +393,10 @@ dump_objs(struct workspace *wk, struct arr *big_string_offsets, FILE *f)
 }
 
 static bool
-load_objs(struct workspace *wk, const struct big_string_table *bst, FILE *f)
+load_objs(struct workspace *wk, const struct big_string_table *bst, struct serial_reader *r)
 {
 	uint32_t len;
-	if (!load_uint32(&len, f)) {
+	if (!load_uint32(&len, r)) {
 		return false;
 	}
 
@@ -340,7 +410,7 @@ load_objs(struct workspace *wk, const struct big_string_table *bst, FILE *f)
 
 	uint32_t i;
 	for (i = 0; i < len; ++i) {
-		if (!fs_fread(&type_tag, sizeof(uint8_t), f)) {
+		if (!serial_read(r, &type_tag, sizeof(uint8_t))) {
 			return false;
 		}
 
@@ -350,7 +420,7 @@ load_objs(struct workspace *wk, const struct big_string_table *bst, FILE *f)
 		*o = (struct obj_internal) { .t = type_tag, };
 
 		if (type_tag < _obj_aos_start) {
-			if (!fs_fread(&o->val, sizeof(uint32_t), f)) {
+			if (!serial_read(r, &o->val, sizeof(uint32_t))) {
 				return false;
 			}
 			continue;
@@ -365,7 +435,7 @@ load_objs(struct workspace *wk, const struct big_string_table *bst, FILE *f)
 		bucket_arr_pushn(ba, NULL, 0, 1);
 
 		if (type_tag == obj_string) {
-			if (!fs_fread(&ser_s, sizeof(struct serial_str), f)) {
+			if (!serial_read(r, &ser_s, sizeof(struct serial_str))) {
 				return false;
 			}
 
@@ -390,7 +460,7 @@ load_objs(struct workspace *wk, const struct big_string_table *bst, FILE *f)
 				};
 			}
 		} else {
-			if (!fs_fread(bucket_arr_get(ba, o->val), ba->item_size, f)) {
+			if (!serial_read(r, bucket_arr_get(ba, o->val), ba->item_size)) {
 				return false;
 			}
 		}
@@ -421,7 +491,8 @@ serial_dump(struct workspace *wk_src, obj o, FILE *f)
 	      && dump_bucket_arr(&wk_dest.chrs, f)
 	      && dump_big_strings(&wk_dest, &big_string_offsets, f)
 	      && dump_objs(&wk_dest, &big_string_offsets, f)
-	      && dump_bucket_arr(&wk_dest.dict_elems, f))) {
+	      && dump_bucket_arr(&wk_dest.dict_elems, f)
+	      && dump_array_elems(&wk_dest.array_elems, f))) {
 		goto ret;
 	}
 
@@ -432,8 +503,8 @@ ret:
 	return ret;
 }
 
-bool
-serial_load(struct workspace *wk, obj *res, FILE *f)
+static bool
+serial_load_reader(struct workspace *wk, obj *res, struct serial_reader *r)
 {
 	bool ret = false;
 	struct workspace wk_src = { 0 };
@@ -443,12 +514,13 @@ serial_load(struct workspace *wk, obj *res, FILE *f)
 	struct big_string_table bst = { 0 };
 
 	obj obj_src;
-	if (!(load_serial_header(f)
-	      && load_uint32(&obj_src, f)
-	      && load_bucket_arr(&wk_src.chrs, f)
-	      && load_big_strings(&wk_src, &bst, f)
-	      && load_objs(&wk_src, &bst, f)
-	      && load_bucket_arr(&wk_src.dict_elems, f))) {
+	if (!(load_serial_header(r)
+	      && load_uint32(&obj_src, r)
+	      && load_bucket_arr(&wk_src.chrs, r)
+	      && load_big_strings(&wk_src, &bst, r)
+	      && load_objs(&wk_src, &bst, r)
+	      && load_bucket_arr(&wk_src.dict_elems, r)
+	      && load_array_elems(&wk_src, r))) {
 		goto ret;
 	}
 
@@ -468,6 +540,18 @@ ret:
 	return ret;
 }
 
+bool
+serial_load(struct workspace *wk, obj *res, FILE *f)
+{
+	return serial_load_reader(wk, res, &(struct serial_reader) { .f = f });
+}
+
+bool
+serial_load_buf(struct workspace *wk, obj *res, const uint8_t *buf, uint64_t len)
+{
+	return serial_load_reader(wk, res, &(struct serial_reader) { .buf = buf, .len = len });
+}
+
 bool
 serial_load_from_private_dir(struct workspace *wk, obj *res, const char *file)
 {
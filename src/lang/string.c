@@ -147,9 +147,13 @@ _make_str(struct workspace *wk, const char *p, uint32_t len, bool mutable)
 	}
 
 	uint64_t *v;
-	if (!mutable && len <= SMALL_STR_LEN && (v = hash_get_strn(&wk->str_hash, p, len))) {
-		s = *v;
-		return s;
+	if (!mutable && len <= SMALL_STR_LEN) {
+		++wk->intern_stats.str_lookups;
+
+		if ((v = hash_get_strn(&wk->str_hash, p, len))) {
+			++wk->intern_stats.str_hits;
+			return *v;
+		}
 	}
 
 	struct str *str = reserve_str(wk, &s, len);
@@ -175,6 +179,33 @@ make_str(struct workspace *wk, const char *str)
 	return _make_str(wk, str, strlen(str), false);
 }
 
+/*
+ * Symbols are strings that are always interned, regardless of length, so that
+ * they can be compared by id.  They are used as the keys of variable scopes.
+ */
+obj
+make_sym(struct workspace *wk, const char *name)
+{
+	uint32_t len = strlen(name);
+
+	uint64_t *v;
+	++wk->intern_stats.sym_lookups;
+	if ((v = hash_get_strn(&wk->str_hash, name, len))) {
+		++wk->intern_stats.sym_hits;
+		return *v;
+	}
+
+	obj s = make_strn(wk, name, len);
+
+	// objects created while a clear mark is set don't outlive it, so
+	// they can't be interned
+	if (!wk->obj_clear_mark_set) {
+		hash_set_strn(&wk->str_hash, get_str(wk, s)->s, len, s);
+	}
+
+	return s;
+}
+
 obj
 make_strf(struct workspace *wk, const char *fmt, ...)
 {
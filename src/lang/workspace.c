@@ -5,15 +5,18 @@
 
 #include "compat.h"
 
+#include <inttypes.h>
 #include <string.h>
 
 #include "backend/output.h"
 #include "error.h"
+#include "formats/json.h"
 #include "lang/interpreter.h"
 #include "lang/workspace.h"
 #include "log.h"
 #include "options.h"
 #include "platform/mem.h"
+#include "platform/os.h"
 #include "platform/path.h"
 
 struct project *
@@ -89,6 +92,7 @@ workspace_init_bare(struct workspace *wk)
 	bucket_arr_init(&wk->objs, 1024, sizeof(struct obj_internal));
 	bucket_arr_init(&wk->dict_elems, 1024, sizeof(struct obj_dict_elem));
 	bucket_arr_init(&wk->dict_hashes, 16, sizeof(struct hash));
+	arr_init(&wk->array_elems, 4096, sizeof(obj));
 
 	const struct {
 		uint32_t item_size;
@@ -134,8 +138,8 @@ workspace_init_bare(struct workspace *wk)
 
 	bucket_arr_pushn(&wk->dict_elems, 0, 0, 1); // reserve dict_elem 0 as a null element
 
-	hash_init(&wk->obj_hash, 128, sizeof(obj));
 	hash_init_str(&wk->str_hash, 128);
+	hash_init_str(&wk->dep_memo, 16);
 }
 
 void
@@ -168,16 +172,16 @@ workspace_init(struct workspace *wk)
 
 	make_obj(wk, &wk->default_scope, obj_array);
 	obj scope;
-	make_obj(wk, &scope, obj_dict);
+	make_scope(wk, &scope);
 	obj_array_push(wk, wk->default_scope, scope);
 
 	make_obj(wk, &id, obj_meson);
-	obj_dict_set(wk, scope, make_str(wk, "meson"), id);
+	obj_dict_seti(wk, scope, make_sym(wk, "meson"), id);
 
 	make_obj(wk, &id, obj_machine);
-	obj_dict_set(wk, scope, make_str(wk, "host_machine"), id);
-	obj_dict_set(wk, scope, make_str(wk, "build_machine"), id);
-	obj_dict_set(wk, scope, make_str(wk, "target_machine"), id);
+	obj_dict_seti(wk, scope, make_sym(wk, "host_machine"), id);
+	obj_dict_seti(wk, scope, make_sym(wk, "build_machine"), id);
+	obj_dict_seti(wk, scope, make_sym(wk, "target_machine"), id);
 
 	make_obj(wk, &wk->binaries, obj_dict);
 	make_obj(wk, &wk->host_machine, obj_dict);
@@ -193,6 +197,9 @@ workspace_init(struct workspace *wk)
 	make_obj(wk, &wk->find_program_overrides, obj_dict);
 	make_obj(wk, &wk->global_opts, obj_dict);
 	make_obj(wk, &wk->compiler_check_cache, obj_dict);
+	wk->compiler_check_jobs = 4;
+	make_obj(wk, &wk->compiler_check_shared_keys, obj_dict);
+	make_obj(wk, &wk->toolchain_cmd_cache, obj_dict);
 
 	if (!init_global_options(wk)) {
 		UNREACHABLE;
@@ -224,9 +231,10 @@ workspace_destroy_bare(struct workspace *wk)
 	bucket_arr_destroy(&wk->objs);
 	bucket_arr_destroy(&wk->dict_elems);
 	bucket_arr_destroy(&wk->dict_hashes);
+	arr_destroy(&wk->array_elems);
 
-	hash_destroy(&wk->obj_hash);
 	hash_destroy(&wk->str_hash);
+	hash_destroy(&wk->dep_memo);
 }
 
 void
@@ -348,6 +356,120 @@ workspace_print_summaries(struct workspace *wk, FILE *out)
 	}
 }
 
+static uint64_t
+write_bucket_arr_stats(FILE *out, const struct bucket_arr *ba)
+{
+	uint64_t cap = (uint64_t)ba->buckets.len * ba->bucket_size;
+
+	fprintf(out, "{\"count\":%" PRIu32 ",\"item_size\":%" PRIu32 ",\"bucket_size\":%" PRIu32
+		",\"buckets\":%" PRIu64 ",\"bytes\":%" PRIu64 ",\"utilization\":%.4f}",
+		ba->len,
+		ba->item_size,
+		ba->bucket_size,
+		(uint64_t)ba->buckets.len,
+		bucket_arr_size((struct bucket_arr *)ba),
+		cap ? (double)ba->len / cap : 0.0);
+
+	return bucket_arr_size((struct bucket_arr *)ba);
+}
+
+static uint64_t
+hash_heap_size(const struct hash *h)
+{
+	return h->meta.cap * h->meta.item_size
+	       + h->e.cap * h->e.item_size
+	       + h->keys.cap * h->keys.item_size;
+}
+
+static void
+write_hit_rate(FILE *out, const char *name, uint64_t lookups, uint64_t hits)
+{
+	fprintf(out, ",\"%s_lookups\":%" PRIu64 ",\"%s_hits\":%" PRIu64 ",\"%s_hit_rate\":%.4f",
+		name, lookups, name, hits, name, lookups ? (double)hits / lookups : 0.0);
+}
+
+/*
+ * Write statistics about the objects in the workspace and the memory used to
+ * store them as a json object.  Bytes are what is allocated, which includes
+ * unused space at the end of buckets.  phase names the point at which the
+ * statistics were taken.
+ */
+void
+workspace_write_stats(struct workspace *wk, FILE *out, const char *phase)
+{
+	uint64_t counts[obj_type_count] = { 0 }, big_strs = 0, big_str_bytes = 0, dict_hash_bytes = 0, total = 0;
+	uint32_t i;
+
+	for (i = 0; i < wk->objs.len; ++i) {
+		const struct obj_internal *o = bucket_arr_get(&wk->objs, i);
+		++counts[o->t];
+
+		if (o->t == obj_string) {
+			const struct str *s = bucket_arr_get(&wk->obj_aos[obj_string - _obj_aos_start], o->val);
+			if (s->flags & str_flag_big) {
+				++big_strs;
+				big_str_bytes += s->len + 1;
+			}
+		}
+	}
+
+	for (i = 0; i < wk->dict_hashes.len; ++i) {
+		dict_hash_bytes += hash_heap_size(bucket_arr_get(&wk->dict_hashes, i));
+	}
+
+	fputs("{\"phase\":", out);
+	json_write_str(out, phase);
+	fprintf(out, ",\n\"objects\":%" PRIu32 ",\n\"types\":{", wk->objs.len);
+	for (i = 0; i < obj_type_count; ++i) {
+		fprintf(out, "%s\n", i ? "," : "");
+		json_write_str(out, obj_type_to_s(i));
+
+		if (i < _obj_aos_start) {
+			fprintf(out, ":{\"count\":%" PRIu64 "}", counts[i]);
+		} else {
+			fputc(':', out);
+			total += write_bucket_arr_stats(out, &wk->obj_aos[i - _obj_aos_start]);
+		}
+	}
+
+	fputs("},\n\"arenas\":{\n\"objs\":", out);
+	total += write_bucket_arr_stats(out, &wk->objs);
+	fputs(",\n\"chrs\":", out);
+	total += write_bucket_arr_stats(out, &wk->chrs);
+	fputs(",\n\"dict_elems\":", out);
+	total += write_bucket_arr_stats(out, &wk->dict_elems);
+	fputs(",\n\"dict_hashes\":", out);
+	total += write_bucket_arr_stats(out, &wk->dict_hashes);
+
+	uint64_t array_elems_bytes = (uint64_t)wk->array_elems.cap * wk->array_elems.item_size;
+	fprintf(out, ",\n\"array_elems\":{\"count\":%" PRIu64 ",\"item_size\":%" PRIu64
+		",\"capacity\":%" PRIu64 ",\"bytes\":%" PRIu64 "}",
+		(uint64_t)wk->array_elems.len,
+		(uint64_t)wk->array_elems.item_size,
+		(uint64_t)wk->array_elems.cap,
+		array_elems_bytes);
+	fprintf(out, ",\n\"dict_hash_tables\":{\"bytes\":%" PRIu64 "}", dict_hash_bytes);
+	fprintf(out, ",\n\"big_strings\":{\"count\":%" PRIu64 ",\"bytes\":%" PRIu64 "}", big_strs, big_str_bytes);
+	total += array_elems_bytes + dict_hash_bytes + big_str_bytes;
+
+	fprintf(out, "},\n\"interning\":{\"entries\":%" PRIu64 ",\"bytes\":%" PRIu64,
+		(uint64_t)wk->str_hash.len, hash_heap_size(&wk->str_hash));
+	write_hit_rate(out, "str", wk->intern_stats.str_lookups, wk->intern_stats.str_hits);
+	write_hit_rate(out, "sym", wk->intern_stats.sym_lookups, wk->intern_stats.sym_hits);
+	total += hash_heap_size(&wk->str_hash);
+
+	fprintf(out, "},\n\"total_bytes\":%" PRIu64 ",\n\"peak_rss\":", total);
+
+	uint64_t rss;
+	if (os_peak_rss(&rss)) {
+		fprintf(out, "%" PRIu64, rss);
+	} else {
+		fputs("null", out);
+	}
+
+	fputs("}\n", out);
+}
+
 static enum iteration_result
 workspace_add_regenerate_deps_iter(struct workspace *wk, void *_ctx, obj v)
 {
@@ -13,15 +13,17 @@
 #include "args.h"
 #include "backend/backend.h"
 #include "cmd_install.h"
+#include "cmd_fmt.h"
 #include "cmd_test.h"
+#include "datastructures/arr.h"
 #include "embedded.h"
 #include "external/libarchive.h"
 #include "external/libcurl.h"
 #include "external/libpkgconf.h"
 #include "external/samurai.h"
 #include "functions/common.h"
+#include "functions/compiler.h"
 #include "lang/analyze.h"
-#include "lang/fmt.h"
 #include "lang/interpreter.h"
 #include "lang/serial.h"
 #include "machine_file.h"
@@ -32,6 +34,8 @@
 #include "platform/mem.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
+#include "profile.h"
+#include "toolchain_cache.h"
 #include "tracy.h"
 #include "version.h"
 #include "wrap.h"
@@ -116,7 +120,10 @@ cmd_exe(uint32_t argc, uint32_t argi, char *const argv[])
 	struct run_cmd_ctx ctx = { 0 };
 	ctx.stdin_path = opts.feed;
 
-	if (!opts.capture) {
+	if (opts.capture) {
+		// the output only needs to end up in a file
+		ctx.capture_max = RUN_CMD_CAPTURE_SPILL_SIZE;
+	} else {
 		ctx.flags |= run_cmd_ctx_flag_dont_capture;
 	}
 
@@ -170,7 +177,7 @@ cmd_exe(uint32_t argc, uint32_t argi, char *const argv[])
 	}
 
 	if (opts.capture) {
-		ret = fs_write(opts.capture, (uint8_t *)ctx.out.buf, ctx.out.len);
+		ret = run_cmd_pipe_write(&ctx.out, opts.capture);
 	} else {
 		ret = true;
 	}
@@ -430,10 +437,69 @@ ret:
 	return ret;
 }
 
+struct cmd_subprojects_download_wrap {
+	char *name;
+	// source_filename and patch_filename, which share the packagecache
+	char *files[2];
+	// index of the first wrap that has to be fetched by the same job
+	uint32_t group;
+};
+
 struct cmd_subprojects_download_ctx {
 	const char *subprojects;
+	struct arr wraps;
+	bool collect, failed;
 };
 
+static char *
+cmd_subprojects_download_dup(const char *s, uint32_t len)
+{
+	char *res = z_malloc(len + 1);
+	memcpy(res, s, len);
+	res[len] = 0;
+	return res;
+}
+
+/*
+ * Wraps that download into the same packagecache file would race on it, so
+ * they are put in the same group and fetched one after the other.
+ */
+static void
+cmd_subprojects_download_group(struct cmd_subprojects_download_ctx *ctx, struct cmd_subprojects_download_wrap *w)
+{
+	uint32_t i, j, k, group = ctx->wraps.len;
+
+	for (i = 0; i < ctx->wraps.len; ++i) {
+		struct cmd_subprojects_download_wrap *prev = arr_get(&ctx->wraps, i);
+
+		for (j = 0; j < ARRAY_LEN(w->files); ++j) {
+			for (k = 0; k < ARRAY_LEN(prev->files); ++k) {
+				if (!w->files[j] || !prev->files[k] || strcmp(w->files[j], prev->files[k]) != 0) {
+					continue;
+				}
+
+				if (group == ctx->wraps.len) {
+					group = prev->group;
+				} else if (prev->group != group) {
+					// w joins two groups, merge them
+					uint32_t from = prev->group > group ? prev->group : group,
+						 to = prev->group > group ? group : prev->group, l;
+
+					for (l = 0; l < ctx->wraps.len; ++l) {
+						struct cmd_subprojects_download_wrap *o = arr_get(&ctx->wraps, l);
+						if (o->group == from) {
+							o->group = to;
+						}
+					}
+					group = to;
+				}
+			}
+		}
+	}
+
+	w->group = group;
+}
+
 static enum iteration_result
 cmd_subprojects_download_iter(void *_ctx, const char *name)
 {
@@ -451,9 +517,35 @@ cmd_subprojects_download_iter(void *_ctx, const char *name)
 		goto cont;
 	}
 
-	LOG_I("fetching %s", name);
 	struct wrap wrap = { 0 };
+
+	if (ctx->collect) {
+		if (!wrap_parse(path.buf, &wrap)) {
+			ctx->failed = true;
+			goto cont;
+		}
+
+		struct cmd_subprojects_download_wrap w = { 0 };
+		const enum wrap_fields fields[] = { wf_source_filename, wf_patch_filename };
+		uint32_t i;
+		for (i = 0; i < ARRAY_LEN(fields); ++i) {
+			if (wrap.fields[fields[i]]) {
+				w.files[i] = cmd_subprojects_download_dup(wrap.fields[fields[i]], strlen(wrap.fields[fields[i]]));
+			}
+		}
+		wrap_destroy(&wrap);
+
+		path_basename(NULL, &path, name);
+		w.name = cmd_subprojects_download_dup(path.buf, path.len - 5);
+
+		cmd_subprojects_download_group(ctx, &w);
+		arr_push(&ctx->wraps, &w);
+		goto cont;
+	}
+
+	LOG_I("fetching %s", name);
 	if (!wrap_handle(path.buf, ctx->subprojects, &wrap, true)) {
+		ctx->failed = true;
 		goto cont;
 	}
 
@@ -463,20 +555,131 @@ cont:
 	return ir_cont;
 }
 
+struct cmd_subprojects_download_jobs_ctx {
+	struct cmd_subprojects_download_ctx *ctx;
+	const char **argv;
+	// the first wrap of each group
+	uint32_t *groups;
+	uint32_t done, failed, total;
+};
+
+static const char *const *
+cmd_subprojects_download_jobs_argv(void *_ctx, uint32_t i)
+{
+	struct cmd_subprojects_download_jobs_ctx *ctx = _ctx;
+	uint32_t j, argc = 5;
+
+	for (j = ctx->groups[i]; j < ctx->ctx->wraps.len; ++j) {
+		struct cmd_subprojects_download_wrap *w = arr_get(&ctx->ctx->wraps, j);
+		if (w->group == ctx->groups[i]) {
+			ctx->argv[argc++] = w->name;
+		}
+	}
+	ctx->argv[argc] = NULL;
+
+	return ctx->argv;
+}
+
+static void
+cmd_subprojects_download_jobs_done(void *_ctx, uint32_t i, const struct run_cmd_ctx *cmd_ctx, bool ok)
+{
+	struct cmd_subprojects_download_jobs_ctx *ctx = _ctx;
+	uint32_t j, n = 0;
+	SBUF_manual(names);
+
+	for (j = ctx->groups[i]; j < ctx->ctx->wraps.len; ++j) {
+		struct cmd_subprojects_download_wrap *w = arr_get(&ctx->ctx->wraps, j);
+		if (w->group == ctx->groups[i]) {
+			sbuf_pushf(NULL, &names, "%s%s", n ? ", " : "", w->name);
+			++n;
+		}
+	}
+
+	++ctx->done;
+	if (ok) {
+		LOG_I("[%d/%d] fetched %s", ctx->done, ctx->total, names.buf);
+	} else {
+		ctx->failed += n;
+		LOG_E("[%d/%d] failed to fetch %s%s%s", ctx->done, ctx->total, names.buf,
+			cmd_ctx->err_msg ? ": " : "",
+			cmd_ctx->err_msg ? cmd_ctx->err_msg : "");
+	}
+
+	sbuf_destroy(&names);
+}
+
+/*
+ * Each group of wraps is fetched by a separate muon process, so that
+ * downloads and git clones for independent subprojects overlap.  The output
+ * of every process is buffered and printed as a whole once it is done.
+ */
+static bool
+cmd_subprojects_download_jobs(struct cmd_subprojects_download_ctx *ctx, const char *argv0, uint32_t jobs)
+{
+	uint32_t i;
+	struct cmd_subprojects_download_jobs_ctx jobs_ctx = {
+		.ctx = ctx,
+		.argv = z_calloc(ctx->wraps.len + 6, sizeof(const char *)),
+		.groups = z_calloc(ctx->wraps.len, sizeof(uint32_t)),
+	};
+
+	jobs_ctx.argv[0] = argv0;
+	jobs_ctx.argv[1] = "subprojects";
+	jobs_ctx.argv[2] = "-d";
+	jobs_ctx.argv[3] = ctx->subprojects;
+	jobs_ctx.argv[4] = "download";
+
+	for (i = 0; i < ctx->wraps.len; ++i) {
+		struct cmd_subprojects_download_wrap *w = arr_get(&ctx->wraps, i);
+		if (w->group == i) {
+			jobs_ctx.groups[jobs_ctx.total++] = i;
+		}
+	}
+
+	run_cmd_jobs(jobs_ctx.total, jobs, &jobs_ctx, cmd_subprojects_download_jobs_argv, cmd_subprojects_download_jobs_done);
+
+	z_free(jobs_ctx.groups);
+	z_free((void *)jobs_ctx.argv);
+
+	if (jobs_ctx.failed) {
+		LOG_E("failed to fetch %d of %d subprojects", jobs_ctx.failed, (uint32_t)ctx->wraps.len);
+		return false;
+	}
+
+	return true;
+}
+
 static bool
 cmd_subprojects_download(uint32_t argc, uint32_t argi, char *const argv[])
 {
 	bool res = false;
+	uint32_t i, j, jobs = 1;
 
-	OPTSTART("") {
-	} OPTEND(argv[argi], " <list of subprojects>", "", NULL, -1)
+	OPTSTART("j:") {
+		case 'j': {
+			char *endptr;
+			unsigned long n = strtoul(optarg, &endptr, 10);
+
+			if (n == 0 || n > UINT32_MAX || *endptr) {
+				LOG_E("invalid number of jobs: %s", optarg);
+				return false;
+			}
+
+			jobs = n;
+			break;
+		}
+	} OPTEND(argv[argi], " <list of subprojects>",
+		"  -j <jobs> - fetch up to this many subprojects in parallel\n",
+		NULL, -1)
 
 	SBUF_manual(path);
 	path_make_absolute(NULL, &path, cmd_subprojects_subprojects_dir);
 
 	struct cmd_subprojects_download_ctx ctx = {
 		.subprojects = path.buf,
+		.collect = jobs > 1,
 	};
+	arr_init(&ctx.wraps, 16, sizeof(struct cmd_subprojects_download_wrap));
 
 	if (argc > argi) {
 		SBUF_manual(wrap_file);
@@ -488,10 +691,12 @@ cmd_subprojects_download(uint32_t argc, uint32_t argi, char *const argv[])
 
 			if (!fs_file_exists(wrap_file.buf)) {
 				LOG_E("wrap file for '%s' not found", argv[argi]);
+				sbuf_destroy(&wrap_file);
 				goto ret;
 			}
 
 			if (cmd_subprojects_download_iter(&ctx, wrap_file.buf) == ir_err) {
+				sbuf_destroy(&wrap_file);
 				goto ret;
 			}
 		}
@@ -502,7 +707,25 @@ cmd_subprojects_download(uint32_t argc, uint32_t argi, char *const argv[])
 		res = fs_dir_foreach(path.buf, &ctx, cmd_subprojects_download_iter);
 	}
 
+	if (res && ctx.collect && ctx.wraps.len) {
+		res = cmd_subprojects_download_jobs(&ctx, argv[0], jobs);
+	}
+
+	if (ctx.failed) {
+		res = false;
+	}
+
 ret:
+	for (i = 0; i < ctx.wraps.len; ++i) {
+		struct cmd_subprojects_download_wrap *w = arr_get(&ctx.wraps, i);
+		z_free(w->name);
+		for (j = 0; j < ARRAY_LEN(w->files); ++j) {
+			if (w->files[j]) {
+				z_free(w->files[j]);
+			}
+		}
+	}
+	arr_destroy(&ctx.wraps);
 	sbuf_destroy(&path);
 	return res;
 }
@@ -533,7 +756,29 @@ cmd_subprojects(uint32_t argc, uint32_t argi, char *const argv[])
 }
 
 static bool
-eval_internal(const char *filename, bool embedded, const char *argv0, char *const argv[], uint32_t argc)
+write_stats(struct workspace *wk, const char *path, const char *phase)
+{
+	if (!path) {
+		workspace_write_stats(wk, stdout, phase);
+		return true;
+	}
+
+	FILE *f;
+	if (!(f = fs_fopen(path, "wb"))) {
+		return false;
+	}
+
+	workspace_write_stats(wk, f, phase);
+	return fs_fclose(f);
+}
+
+/*
+ * If stats is set, workspace statistics are written to stats_path, or
+ * stdout if it is NULL, once evaluation is done.
+ */
+static bool
+eval_internal(const char *filename, bool embedded, const char *argv0, char *const argv[], uint32_t argc,
+	bool stats, const char *stats_path)
 {
 	bool ret = false;
 
@@ -566,7 +811,7 @@ eval_internal(const char *filename, bool embedded, const char *argv0, char *cons
 	{ // populate argv array
 		obj argv_obj;
 		make_obj(&wk, &argv_obj, obj_array);
-		wk.assign_variable(&wk, "argv", argv_obj, 0, assign_local);
+		wk.assign_variable(&wk, make_sym(&wk, "argv"), argv_obj, 0, assign_local);
 
 		uint32_t i;
 		for (i = 0; i < argc; ++i) {
@@ -579,6 +824,10 @@ eval_internal(const char *filename, bool embedded, const char *argv0, char *cons
 		goto ret;
 	}
 
+	if (stats && !write_stats(&wk, stats_path, "evaluation")) {
+		goto ret;
+	}
+
 	ret = true;
 ret:
 	if (src_allocd) {
@@ -613,7 +862,33 @@ cmd_eval(uint32_t argc, uint32_t argi, char *const argv[])
 
 	filename = argv[argi];
 
-	return eval_internal(filename, embedded, argv[0], &argv[argi], argc - argi);
+	return eval_internal(filename, embedded, argv[0], &argv[argi], argc - argi, false, NULL);
+}
+
+static bool
+cmd_stats(uint32_t argc, uint32_t argi, char *const argv[])
+{
+	bool embedded = false;
+	const char *out = NULL;
+
+	OPTSTART("eo:") {
+		case 'e':
+			embedded = true;
+			break;
+		case 'o':
+			out = optarg;
+			break;
+	} OPTEND(argv[argi], " <filename> [args]",
+		"  -e - lookup <filename> as an embedded script\n"
+		"  -o <file> - write statistics to file instead of stdout\n",
+		NULL, -1)
+
+	if (argi >= argc) {
+		LOG_E("missing required filename argument");
+		return false;
+	}
+
+	return eval_internal(argv[argi], embedded, argv[0], &argv[argi], argc - argi, true, out);
 }
 
 static bool
@@ -653,6 +928,15 @@ cmd_dump_signatures(uint32_t argc, uint32_t argi, char *const argv[])
 	return true;
 }
 
+static bool
+cmd_options_snapshot(uint32_t argc, uint32_t argi, char *const argv[])
+{
+	OPTSTART("") {
+	} OPTEND(argv[argi], " <output>", "", NULL, 1)
+
+	return options_snapshot_write(argv[argi]);
+}
+
 static bool
 cmd_internal(uint32_t argc, uint32_t argi, char *const argv[])
 {
@@ -661,6 +945,8 @@ cmd_internal(uint32_t argc, uint32_t argi, char *const argv[])
 		{ "exe", cmd_exe, "run an external command" },
 		{ "repl", cmd_repl, "start a meson language repl" },
 		{ "dump_funcs", cmd_dump_signatures, "output all supported functions and arguments" },
+		{ "options_snapshot", cmd_options_snapshot, "write the builtin options snapshot" },
+		{ "stats", cmd_stats, "evaluate a file and output object and memory statistics" },
 		0,
 	};
 
@@ -685,14 +971,16 @@ cmd_samu(uint32_t argc, uint32_t argi, char *const argv[])
 static bool
 cmd_test(uint32_t argc, uint32_t argi, char *const argv[])
 {
-	struct test_options test_opts = { 0 };
+	struct test_options test_opts = {
+		.output_max = TEST_DEFAULT_OUTPUT_MAX_KIB * 1024,
+	};
 
 	if (strcmp(argv[argi], "benchmark") == 0) {
 		test_opts.cat = test_category_benchmark;
 		test_opts.print_summary = true;
 	}
 
-	OPTSTART("s:d:Sfj:lvRe:") {
+	OPTSTART("s:d:SfFj:lo:vRe:") {
 		case 'l':
 			test_opts.list = true;
 			break;
@@ -722,6 +1010,9 @@ cmd_test(uint32_t argc, uint32_t argi, char *const argv[])
 		case 'f':
 			test_opts.fail_fast = true;
 			break;
+		case 'F':
+			test_opts.failed_first = true;
+			break;
 		case 'S':
 			test_opts.print_summary = true;
 			break;
@@ -737,6 +1028,18 @@ cmd_test(uint32_t argc, uint32_t argi, char *const argv[])
 			test_opts.jobs = n;
 			break;
 		}
+		case 'o': {
+			char *endptr;
+			unsigned long n = strtoul(optarg, &endptr, 10);
+
+			if (n > UINT32_MAX / 1024 || !*optarg || *endptr) {
+				LOG_E("invalid output limit: %s", optarg);
+				return false;
+			}
+
+			test_opts.output_max = n * 1024;
+			break;
+		}
 		case 'v':
 			++test_opts.verbosity;
 			break;
@@ -747,8 +1050,10 @@ cmd_test(uint32_t argc, uint32_t argi, char *const argv[])
 		"  -d <mode> - change progress display mode (auto|dots|bar)\n"
 		"  -e <setup> - use test setup <setup>\n"
 		"  -f - fail fast; exit after first failure\n"
+		"  -F - run tests that failed last time first\n"
 		"  -j <jobs> - set the number of test workers\n"
 		"  -l - list tests that would be run\n"
+		"  -o <kib> - keep at most the last <kib> KiB of each test's output\n"
 		"  -R - disable automatic rebuild\n"
 		"  -S - print a summary with elapsed time\n"
 		"  -s <suite> - only run items in <suite>, may be passed multiple times\n"
@@ -770,18 +1075,32 @@ cmd_install(uint32_t argc, uint32_t argi, char *const argv[])
 {
 	struct install_options opts = {
 		.destdir = getenv("DESTDIR"),
+		.jobs = 4,
 	};
 
-	OPTSTART("nd:") {
+	OPTSTART("nd:j:") {
 		case 'n':
 			opts.dry_run = true;
 			break;
 		case 'd':
 			opts.destdir = optarg;
 			break;
+		case 'j': {
+			char *endptr;
+			unsigned long n = strtoul(optarg, &endptr, 10);
+
+			if (n > UINT32_MAX || !n || *endptr) {
+				LOG_E("invalid number of jobs: %s", optarg);
+				return false;
+			}
+
+			opts.jobs = n;
+			break;
+		}
 	} OPTEND(argv[argi], "",
 		"  -n - dry run\n"
-		"  -d <destdir> - set destdir\n",
+		"  -d <destdir> - set destdir\n"
+		"  -j <jobs> - set the number of processes used to copy files\n",
 		NULL, 0)
 
 	if (!ensure_in_build_dir()) {
@@ -791,6 +1110,8 @@ cmd_install(uint32_t argc, uint32_t argi, char *const argv[])
 	return install_run(&opts);
 }
 
+#define SETUP_PROFILE_SLOWEST 20
+
 static bool
 cmd_setup(uint32_t argc, uint32_t argi, char *const argv[])
 {
@@ -798,10 +1119,12 @@ cmd_setup(uint32_t argc, uint32_t argi, char *const argv[])
 	bool res = false;
 	struct workspace wk;
 	workspace_init(&wk);
+	SBUF_manual(profile_path);
+	SBUF_manual(stats_path);
 
 	uint32_t original_argi = argi + 1;
 
-	OPTSTART("D:c:b") {
+	OPTSTART("D:c:bj:kp:S:") {
 		case 'D':
 			if (!parse_and_set_cmdline_option(&wk, optarg)) {
 				goto ret;
@@ -822,13 +1145,43 @@ cmd_setup(uint32_t argc, uint32_t argi, char *const argv[])
 		case 'b':
 			wk.dbg.break_on_err = true;
 			break;
+		case 'j': {
+			char *endptr;
+			unsigned long n = strtoul(optarg, &endptr, 10);
+
+			if (n > UINT32_MAX || !n || !*optarg || *endptr) {
+				LOG_E("invalid number of jobs: %s", optarg);
+				goto ret;
+			}
+
+			wk.compiler_check_jobs = n;
+			break;
+		}
+		case 'k':
+			wk.compiler_check_shared_cache = true;
+			break;
+		case 'p':
+			path_make_absolute(NULL, &profile_path, optarg);
+			break;
+		case 'S':
+			path_make_absolute(NULL, &stats_path, optarg);
+			break;
 	} OPTEND(argv[argi],
 		" <build dir>",
 		"  -D <option>=<value> - set project options\n"
 		"  -c <compiler_check_cache.dat> - path to compiler check cache dump\n"
-		"  -b - break on errors\n",
+		"  -b - break on errors\n"
+		"  -j <jobs> - set the number of concurrent compiler checks\n"
+		"  -k - share compiler check and toolchain detection results with other build dirs\n"
+		"  -p <file> - write a profile of setup to file\n"
+		"  -S <file> - write object and memory statistics to file\n",
 		NULL, 1)
 
+	if (profile_path.len) {
+		profile_init();
+		profile_begin("setup", "setup");
+	}
+
 	const char *build = argv[argi];
 	++argi;
 
@@ -839,7 +1192,15 @@ cmd_setup(uint32_t argc, uint32_t argi, char *const argv[])
 	}
 
 	uint32_t project_id;
-	if (!eval_project(&wk, NULL, wk.source_root, wk.build_root, &project_id)) {
+	bool evaluated = eval_project(&wk, NULL, wk.source_root, wk.build_root, &project_id);
+
+	// The backend throws away the objects it creates for each target once
+	// it is done with them, so the statistics are taken before it runs.
+	if (stats_path.len && !write_stats(&wk, stats_path.buf, "evaluation")) {
+		LOG_W("failed to write statistics to %s", stats_path.buf);
+	}
+
+	if (!evaluated) {
 		goto ret;
 	}
 
@@ -849,12 +1210,26 @@ cmd_setup(uint32_t argc, uint32_t argi, char *const argv[])
 		goto ret;
 	}
 
+	compiler_check_cache_persist(&wk);
+	toolchain_cache_evict(&wk);
+
 	workspace_print_summaries(&wk, log_file());
 
 	LOG_I("setup complete");
 
 	res = true;
 ret:
+	if (profile_path.len) {
+		if (!profile_write(profile_path.buf)) {
+			LOG_W("failed to write profile to %s", profile_path.buf);
+		}
+
+		profile_print_slowest(SETUP_PROFILE_SLOWEST);
+		profile_destroy();
+	}
+
+	sbuf_destroy(&stats_path);
+	sbuf_destroy(&profile_path);
 	workspace_destroy(&wk);
 	TracyCZoneAutoE;
 	return res;
@@ -867,13 +1242,9 @@ cmd_format(uint32_t argc, uint32_t argi, char *const argv[])
 		LOG_W("the subcommand name fmt_unstable is deprecated, please use fmt instead");
 	}
 
-	struct {
-		char *const *filenames;
-		const char *cfg_path;
-		bool in_place, check_only, editorconfig;
-	} opts = { 0 };
+	struct fmt_options opts = { 0 };
 
-	OPTSTART("ic:qe") {
+	OPTSTART("ic:qej:kK") {
 		case 'i':
 			opts.in_place = true;
 			break;
@@ -886,11 +1257,32 @@ cmd_format(uint32_t argc, uint32_t argi, char *const argv[])
 		case 'e':
 			opts.editorconfig = true;
 			break;
+		case 'j': {
+			char *endptr;
+			unsigned long n = strtoul(optarg, &endptr, 10);
+
+			if (n > UINT32_MAX || !n || *endptr) {
+				LOG_E("invalid number of jobs: %s", optarg);
+				return false;
+			}
+
+			opts.jobs = n;
+			break;
+		}
+		case 'K':
+			opts.no_evict = true;
+			// fallthrough
+		case 'k':
+			opts.cache = true;
+			break;
 	} OPTEND(argv[argi], " <file>[ <file>[...]]",
 		"  -q - exit with 1 if files would be modified by muon fmt\n"
 		"  -i - format files in-place\n"
 		"  -c <muon_fmt.ini> - read configuration from muon_fmt.ini\n"
-		"  -e - try to read configuration from .editorconfig\n",
+		"  -e - try to read configuration from .editorconfig\n"
+		"  -j <jobs> - set the number of files formatted concurrently\n"
+		"  -k - skip files that are unchanged since they were last formatted\n"
+		"  -K - like -k, but don't evict old entries from the cache\n",
 		NULL, -1)
 
 	if (opts.in_place && opts.check_only) {
@@ -899,48 +1291,9 @@ cmd_format(uint32_t argc, uint32_t argi, char *const argv[])
 	}
 
 	opts.filenames = &argv[argi];
-	const uint32_t num_files = argc - argi;
-
-	bool ret = true;
-	bool opened_out;
-	FILE *out;
-	uint32_t i;
-	for (i = 0; i < num_files; ++i) {
-		bool fmt_ret = true;
-		opened_out = false;
+	opts.filenames_len = argc - argi;
 
-		struct source src = { 0 };
-		if (!fs_read_entire_file(opts.filenames[i], &src)) {
-			ret = false;
-			goto cont;
-		}
-
-		if (opts.in_place) {
-			if (!(out = fs_fopen(opts.filenames[i], "wb"))) {
-				ret = false;
-				goto cont;
-			}
-			opened_out = true;
-		} else if (opts.check_only) {
-			out = NULL;
-		} else {
-			out = stdout;
-		}
-
-		fmt_ret = fmt(&src, out, opts.cfg_path, opts.check_only, opts.editorconfig);
-cont:
-		if (opened_out) {
-			fs_fclose(out);
-
-			if (!fmt_ret) {
-				fs_write(opts.filenames[i], (const uint8_t *)src.src, src.len);
-			}
-		}
-		fs_source_destroy(&src);
-		ret &= fmt_ret;
-	}
-
-	return ret;
+	return fmt_run(&opts, argv[0]);
 }
 
 static bool
@@ -1093,6 +1446,7 @@ main(int argc, char *argv[])
 
 	int ret = res ? 0 : 1;
 
+	muon_curl_deinit();
 	path_deinit();
 	return ret;
 }
@@ -5,6 +5,7 @@
 
 #include "compat.h"
 
+#include <errno.h>
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,6 +20,7 @@
 #include "log.h"
 #include "options.h"
 #include "platform/filesystem.h"
+#include "platform/mem.h"
 #include "platform/path.h"
 
 bool initializing_builtin_options = false;
@@ -674,9 +676,29 @@ set_str_opt_from_env(struct workspace *wk, const char *env_name, const char *opt
 	}
 }
 
+static enum iteration_result
+load_options_snapshot_iter(struct workspace *wk, void *_ctx, obj name, obj opt)
+{
+	obj *opts = _ctx;
+	obj_dict_set(wk, *opts, name, opt);
+	return ir_cont;
+}
+
 static bool
 init_builtin_options(struct workspace *wk, const char *script, const char *fallback)
 {
+	const uint8_t *snapshot = NULL;
+	uint64_t snapshot_len = 0;
+	if (options_snapshot_get(script, &snapshot, &snapshot_len)) {
+		obj loaded;
+		if (!serial_load_buf(wk, &loaded, snapshot, snapshot_len)) {
+			return false;
+		}
+
+		obj opts = wk->projects.len ? current_project(wk)->opts : wk->global_opts;
+		return obj_dict_foreach(wk, loaded, &opts, load_options_snapshot_iter);
+	}
+
 	const char *opts;
 	if (!(opts = embedded_get(script))) {
 		opts = fallback;
@@ -702,6 +724,29 @@ init_per_project_options(struct workspace *wk)
 		);
 }
 
+static bool
+init_builtin_global_options(struct workspace *wk)
+{
+	return init_builtin_options(wk, "global_options.meson",
+		"option('buildtype', type: 'string', value: 'debugoptimized')\n"
+		"option('prefix', type: 'string', value: '/usr/local')\n"
+		"option('bindir', type: 'string', value: 'bin')\n"
+		"option('mandir', type: 'string', value: 'share/man')\n"
+		"option('datadir', type: 'string', value: 'share')\n"
+		"option('libdir', type: 'string', value: 'lib')\n"
+		"option('includedir', type: 'string', value: 'include')\n"
+		"option('wrap_mode', type: 'string', value: 'nopromote')\n"
+		"option('force_fallback_for', type: 'array', value: [])\n"
+		"option('pkg_config_path', type: 'string', value: '')\n"
+		"option('c_args', type: 'array', value: [])\n"
+		"option('c_link_args', type: 'array', value: [])\n"
+		"option('werror', type: 'boolean', value: false)\n"
+
+		"option('env.CC', type: 'array', value: ['cc'])\n"
+		"option('env.NINJA', type: 'array', value: ['ninja'])\n"
+		);
+}
+
 static enum iteration_result
 set_yielding_project_options_iter(struct workspace *wk, void *_ctx, obj _k, obj opt)
 {
@@ -799,24 +844,7 @@ setup_project_options(struct workspace *wk, const char *cwd)
 bool
 init_global_options(struct workspace *wk)
 {
-	if (!init_builtin_options(wk, "global_options.meson",
-		"option('buildtype', type: 'string', value: 'debugoptimized')\n"
-		"option('prefix', type: 'string', value: '/usr/local')\n"
-		"option('bindir', type: 'string', value: 'bin')\n"
-		"option('mandir', type: 'string', value: 'share/man')\n"
-		"option('datadir', type: 'string', value: 'share')\n"
-		"option('libdir', type: 'string', value: 'lib')\n"
-		"option('includedir', type: 'string', value: 'include')\n"
-		"option('wrap_mode', type: 'string', value: 'nopromote')\n"
-		"option('force_fallback_for', type: 'array', value: [])\n"
-		"option('pkg_config_path', type: 'string', value: '')\n"
-		"option('c_args', type: 'array', value: [])\n"
-		"option('c_link_args', type: 'array', value: [])\n"
-		"option('werror', type: 'boolean', value: false)\n"
-
-		"option('env.CC', type: 'array', value: ['cc'])\n"
-		"option('env.NINJA', type: 'array', value: ['ninja'])\n"
-		)) {
+	if (!init_builtin_global_options(wk)) {
 		return false;
 	}
 
@@ -837,6 +865,90 @@ init_global_options(struct workspace *wk)
 	return true;
 }
 
+static bool
+write_options_snapshot(struct workspace *wk, FILE *out, const char *script, obj opts)
+{
+	bool ret = false;
+	FILE *tmp;
+	if (!(tmp = tmpfile())) {
+		LOG_E("failed to create temporary file: %s", strerror(errno));
+		return false;
+	}
+
+	uint64_t len, i;
+	if (!serial_dump(wk, opts, tmp)) {
+		goto ret;
+	} else if (!fs_ftell(tmp, &len)) {
+		goto ret;
+	} else if (!fs_fseek(tmp, 0)) {
+		goto ret;
+	}
+
+	uint8_t *buf = z_malloc(len);
+	if (!fs_fread(buf, len, tmp)) {
+		z_free(buf);
+		goto ret;
+	}
+
+	fprintf(out, "{ .name = \"%s\", .len = %" PRIu64 ", .data = (const uint8_t []){", script, len);
+	for (i = 0; i < len; ++i) {
+		fprintf(out, "%s0x%x,", (i % 14) == 0 ? "\n" : " ", buf[i]);
+	}
+	fputs("\n} },\n", out);
+
+	z_free(buf);
+	ret = true;
+ret:
+	fs_fclose(tmp);
+	return ret;
+}
+
+/*
+ * Serialize the options created by the builtin option scripts, before any
+ * values are taken from the environment.  The output is a C header that is
+ * compiled into muon so that workspaces can load the options directly rather
+ * than interpreting the scripts.
+ */
+bool
+options_snapshot_write(const char *path)
+{
+	bool ret = false;
+	struct workspace wk;
+	workspace_init(&wk);
+
+	FILE *out;
+	if (!(out = fs_fopen(path, "wb"))) {
+		goto ret;
+	}
+
+	fputs("static const struct options_snapshot options_snapshots[] = {\n", out);
+
+	make_obj(&wk, &wk.global_opts, obj_dict);
+	if (!init_builtin_global_options(&wk)) {
+		goto close;
+	} else if (!write_options_snapshot(&wk, out, "global_options.meson", wk.global_opts)) {
+		goto close;
+	}
+
+	obj id;
+	make_project(&wk, &id, NULL, wk.source_root, wk.build_root);
+	if (!init_per_project_options(&wk)) {
+		goto close;
+	} else if (!write_options_snapshot(&wk, out, "per_project_options.meson", current_project(&wk)->opts)) {
+		goto close;
+	}
+
+	fputs("};\n", out);
+	ret = true;
+close:
+	if (!fs_fclose(out)) {
+		ret = false;
+	}
+ret:
+	workspace_destroy(&wk);
+	return ret;
+}
+
 bool
 parse_and_set_cmdline_option(struct workspace *wk, char *lhs)
 {
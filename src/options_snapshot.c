@@ -0,0 +1,38 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <string.h>
+
+#include "buf_size.h"
+#include "options.h"
+
+struct options_snapshot {
+	const char *name;
+	uint64_t len;
+	const uint8_t *data;
+};
+
+#ifdef MUON_HAVE_OPTIONS_SNAPSHOT
+#include "options_snapshot.h"
+#else
+static const struct options_snapshot options_snapshots[] = { 0 };
+#endif
+
+bool
+options_snapshot_get(const char *script, const uint8_t **data, uint64_t *len)
+{
+	uint32_t i;
+	for (i = 0; i < ARRAY_LEN(options_snapshots); ++i) {
+		if (options_snapshots[i].name && strcmp(options_snapshots[i].name, script) == 0) {
+			*data = options_snapshots[i].data;
+			*len = options_snapshots[i].len;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -320,6 +320,36 @@ fs_fread(void *ptr, size_t size, FILE *f)
 	}
 }
 
+bool
+fs_remove(const char *path)
+{
+	if (remove(path) != 0) {
+		LOG_E("failed remove(\"%s\"): %s", path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+bool
+fs_rename(const char *old, const char *new)
+{
+#ifdef _WIN32
+	// rename() doesn't replace an existing destination on windows
+	if (fs_exists(new) && remove(new) != 0) {
+		LOG_E("failed remove(\"%s\"): %s", new, strerror(errno));
+		return false;
+	}
+#endif
+
+	if (rename(old, new) != 0) {
+		LOG_E("failed rename(\"%s\", \"%s\"): %s", old, new, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
 bool
 fs_write(const char *path, const uint8_t *buf, uint64_t buf_len)
 {
@@ -455,6 +485,45 @@ ret:
 	return res;
 }
 
+bool
+fs_same_contents(const char *a, const char *b)
+{
+	bool res = false;
+	FILE *f_a = NULL, *f_b = NULL;
+	size_t r_a, r_b;
+	char buf_a[BUF_SIZE_32k], buf_b[BUF_SIZE_32k];
+	struct stat sb_a, sb_b;
+
+	if (stat(a, &sb_a) != 0 || stat(b, &sb_b) != 0 || sb_a.st_size != sb_b.st_size) {
+		return false;
+	}
+
+	if (!(f_a = fs_fopen(a, "rb")) || !(f_b = fs_fopen(b, "rb"))) {
+		goto ret;
+	}
+
+	while (true) {
+		r_a = fread(buf_a, 1, BUF_SIZE_32k, f_a);
+		r_b = fread(buf_b, 1, BUF_SIZE_32k, f_b);
+
+		if (r_a != r_b || memcmp(buf_a, buf_b, r_a) != 0) {
+			goto ret;
+		} else if (r_a < BUF_SIZE_32k) {
+			break;
+		}
+	}
+
+	res = feof(f_a) && feof(f_b);
+ret:
+	if (f_a) {
+		fclose(f_a);
+	}
+	if (f_b) {
+		fclose(f_b);
+	}
+	return res;
+}
+
 bool
 fs_copy_dir(const char *src_base, const char *dest_base)
 {
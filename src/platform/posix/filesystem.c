@@ -13,6 +13,12 @@
 #include <unistd.h>
 #include <dirent.h>
 
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
 #include "buf_size.h"
 #include "log.h"
 #include "lang/string.h"
@@ -101,6 +107,11 @@ bool
 fs_mkdir(const char *path)
 {
 	if (mkdir(path, 0755) == -1) {
+		if (errno == EEXIST && fs_dir_exists(path)) {
+			// another process may have created it in the meantime
+			return true;
+		}
+
 		LOG_E("failed to create directory %s: %s", path, strerror(errno));
 		return false;
 	}
@@ -108,6 +119,17 @@ fs_mkdir(const char *path)
 	return true;
 }
 
+bool
+fs_rmdir(const char *path)
+{
+	if (rmdir(path) == -1) {
+		LOG_E("failed to remove directory %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
 static bool
 fs_copy_link(const char *src, const char *dest)
 {
@@ -141,12 +163,68 @@ ret:
 	return res;
 }
 
+/*
+ * Where the kernel can do the copy itself, either by sharing the extents of
+ * the source (a reflink) or by copying in kernel space, the data never has
+ * to pass through userspace.  Whatever isn't copied that way goes through a
+ * read/write loop.
+ */
+static bool
+fs_copy_fd(int f_src, int f_dest, const char *src, const char *dest, uint64_t size)
+{
+#ifdef __linux__
+#ifdef FICLONE
+	if (ioctl(f_dest, FICLONE, f_src) == 0) {
+		return true;
+	}
+#endif
+
+	while (size) {
+		ssize_t w = sendfile(f_dest, f_src, NULL, size);
+		if (w <= 0) {
+			// e.g. not supported between these filesystems, the
+			// loop below copies whatever is left
+			break;
+		}
+
+		size -= w;
+	}
+#endif
+
+	ssize_t r, w, off;
+	char buf[BUF_SIZE_32k];
+
+	while ((r = read(f_src, buf, BUF_SIZE_32k)) != 0) {
+		if (r == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			LOG_E("failed to read %s: %s", src, strerror(errno));
+			return false;
+		}
+
+		for (off = 0; off < r; off += w) {
+			if ((w = write(f_dest, &buf[off], r - off)) == -1) {
+				if (errno == EINTR) {
+					w = 0;
+					continue;
+				}
+
+				LOG_E("failed to write %s: %s", dest, strerror(errno));
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 bool
 fs_copy_file(const char *src, const char *dest)
 {
 	bool res = false;
-	FILE *f_src = NULL;
-	int f_dest = 0;
+	int f_src = -1, f_dest = -1;
 
 	struct stat st;
 	if (!fs_lstat(src, &st)) {
@@ -160,7 +238,8 @@ fs_copy_file(const char *src, const char *dest)
 		goto ret;
 	}
 
-	if (!(f_src = fs_fopen(src, "r"))) {
+	if ((f_src = open(src, O_RDONLY)) == -1) {
+		LOG_E("failed to open %s: %s", src, strerror(errno));
 		goto ret;
 	}
 
@@ -169,49 +248,102 @@ fs_copy_file(const char *src, const char *dest)
 		goto ret;
 	}
 
-	assert(f_dest != 0);
+	res = fs_copy_fd(f_src, f_dest, src, dest, st.st_size);
+ret:
+	if (f_src != -1) {
+		if (close(f_src) == -1) {
+			LOG_E("failed close(): %s", strerror(errno));
+			res = false;
+		}
+	}
 
-	size_t r;
-	ssize_t w;
-	char buf[BUF_SIZE_32k];
+	if (f_dest != -1) {
+		if (close(f_dest) == -1) {
+			LOG_E("failed close(): %s", strerror(errno));
+			res = false;
+		}
+	}
 
-	while ((r = fread(buf, 1, BUF_SIZE_32k, f_src)) > 0) {
-		errno = 0; // to ensure that we get the error from write() only
+	return res;
+}
 
-		if ((w = write(f_dest, buf, r)) == -1) {
-			LOG_E("failed write(): %s", strerror(errno));
-			goto ret;
-		} else {
-			assert(w >= 0);
+static struct timespec
+fs_stat_mtime(const struct stat *sb)
+{
+#ifdef __APPLE__
+	return sb->st_mtimespec;
+#else
+	return sb->st_mtim;
+#endif
+}
 
-			if ((size_t)w < r) {
-				LOG_E("incomplete write: %s", strerror(errno));
-				goto ret;
-			}
+int64_t
+fs_stat_mtime_ns(const struct stat *sb)
+{
+	struct timespec ts = fs_stat_mtime(sb);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+bool
+fs_copy_file_if_changed(const char *src, const char *dest, fs_copy_fixup_cb fixup, void *ctx, bool *copied)
+{
+	struct stat src_sb, dest_sb;
+	struct timespec src_mtime, dest_mtime;
+	*copied = false;
+
+	if (!fs_lstat(src, &src_sb)) {
+		return false;
+	}
+
+	src_mtime = fs_stat_mtime(&src_sb);
+
+	if (S_ISREG(src_sb.st_mode)
+	    && lstat(dest, &dest_sb) == 0
+	    && S_ISREG(dest_sb.st_mode)
+	    && src_sb.st_size == dest_sb.st_size) {
+		dest_mtime = fs_stat_mtime(&dest_sb);
+
+		if (src_mtime.tv_sec == dest_mtime.tv_sec && src_mtime.tv_nsec == dest_mtime.tv_nsec) {
+			return true;
+		} else if (!fixup && fs_same_contents(src, dest)) {
+			goto set_mtime;
 		}
 	}
 
-	if (!feof(f_src)) {
-		LOG_E("incomplete read: %s", strerror(errno));
-		goto ret;
+	if (!fs_copy_file(src, dest)) {
+		return false;
 	}
 
-	res = true;
-ret:
-	if (f_src) {
-		if (!fs_fclose(f_src)) {
-			res = false;
-		}
+	*copied = true;
+
+	if (!S_ISREG(src_sb.st_mode)) {
+		return true;
 	}
 
-	if (f_dest > 0) {
-		if (close(f_dest) == -1) {
-			LOG_E("failed close(): %s", strerror(errno));
-			res = false;
-		}
+	if (fixup && !fixup(ctx, dest)) {
+		return false;
 	}
 
-	return res;
+set_mtime:
+	// this comes last so that dest is only considered up to date once
+	// everything above has succeeded
+	if (utimensat(AT_FDCWD, dest, (struct timespec[2]) { { .tv_nsec = UTIME_OMIT }, src_mtime }, 0) == -1) {
+		LOG_E("failed to set modification time of %s: %s", dest, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+bool
+fs_touch(const char *path)
+{
+	if (utimensat(AT_FDCWD, path, NULL, 0) == -1) {
+		LOG_E("failed to set modification time of %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	return true;
 }
 
 bool
@@ -252,17 +384,6 @@ fs_dir_foreach(const char *path, void *_ctx, fs_dir_foreach_cb cb)
 	return res;
 }
 
-static bool
-fs_remove(const char *path)
-{
-	if (remove(path) != 0) {
-		LOG_E("failed remove(\"%s\"): %s", path, strerror(errno));
-		return false;
-	}
-
-	return true;
-}
-
 bool
 fs_make_symlink(const char *target, const char *path, bool force)
 {
@@ -6,9 +6,15 @@
 
 #include "compat.h"
 
+#include <errno.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
+#include "platform/mem.h"
 #include "platform/os.h"
+#include "platform/run_cmd.h"
 
 bool os_chdir(const char *path)
 {
@@ -24,3 +30,65 @@ int os_getopt(int argc, char * const argv[], const char *optstring)
 {
 	return getopt(argc, argv, optstring);
 }
+
+uint32_t os_getpid(void)
+{
+	return getpid();
+}
+
+bool
+os_peak_rss(uint64_t *bytes)
+{
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) != 0) {
+		return false;
+	}
+
+#ifdef __APPLE__
+	*bytes = ru.ru_maxrss;
+#else
+	// everywhere else, ru_maxrss is in kilobytes
+	*bytes = (uint64_t)ru.ru_maxrss * 1024;
+#endif
+	return true;
+}
+
+bool
+os_run_isolated(bool (*fn)(void *ctx, uint32_t i), void *ctx, uint32_t n, bool *res)
+{
+	bool ret = true;
+	uint32_t i, started;
+	pid_t *pids = z_calloc(n, sizeof(pid_t));
+
+	// anything still buffered would be written more than once otherwise
+	fflush(stdout);
+	fflush(stderr);
+
+	for (started = 0; started < n; ++started) {
+		if ((pids[started] = fork()) == -1) {
+			ret = false;
+			break;
+		} else if (pids[started] == 0) {
+			run_cmd_wait_reset();
+			bool ok = fn(ctx, started);
+			fflush(stdout);
+			fflush(stderr);
+			_exit(ok ? 0 : 1);
+		}
+	}
+
+	*res = true;
+	for (i = 0; i < started; ++i) {
+		int status, r;
+		do {
+			r = waitpid(pids[i], &status, 0);
+		} while (r == -1 && errno == EINTR);
+
+		if (r == -1 || !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+			*res = false;
+		}
+	}
+
+	z_free(pids);
+	return ret;
+}
@@ -7,12 +7,12 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/wait.h>
-#include <time.h>
 #include <unistd.h>
 
 #include "args.h"
@@ -22,6 +22,7 @@
 #include "platform/mem.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
+#include "profile.h"
 
 extern char **environ;
 
@@ -34,9 +35,13 @@ enum copy_pipe_result {
 };
 
 static enum copy_pipe_result
-copy_pipe(int pipe, struct run_cmd_pipe_ctx *ctx)
+copy_pipe(int pipe, bool *pipe_open, struct run_cmd_pipe_ctx *ctx, size_t max)
 {
 	ssize_t b;
+	if (!*pipe_open) {
+		return copy_pipe_result_finished;
+	}
+
 	if (!ctx->size) {
 		ctx->size = COPY_PIPE_BLOCK_SIZE;
 		ctx->len = 0;
@@ -53,14 +58,25 @@ copy_pipe(int pipe, struct run_cmd_pipe_ctx *ctx)
 				return copy_pipe_result_failed;
 			}
 		} else if (b == 0) {
+			// close the pipe as soon as it hits EOF so that
+			// run_cmd_wait doesn't keep polling it
+			if (close(pipe) == -1) {
+				LOG_E("failed to close: %s", strerror(errno));
+			}
+			*pipe_open = false;
 			return copy_pipe_result_finished;
 		}
 
 		ctx->len += b;
+		ctx->buf[ctx->len] = 0;
+
+		if (!run_cmd_pipe_spill(ctx, max)) {
+			return copy_pipe_result_failed;
+		}
+
 		if ((ctx->len + COPY_PIPE_BLOCK_SIZE) > ctx->size) {
 			ctx->size *= 2;
 			ctx->buf = z_realloc(ctx->buf, ctx->size + 1);
-			memset(&ctx->buf[ctx->len], 0, (ctx->size + 1) - ctx->len);
 		}
 	}
 }
@@ -70,11 +86,12 @@ copy_pipes(struct run_cmd_ctx *ctx)
 {
 	enum copy_pipe_result res;
 
-	if ((res = copy_pipe(ctx->pipefd_out[0], &ctx->out)) == copy_pipe_result_failed) {
+	if ((res = copy_pipe(ctx->pipefd_out[0], &ctx->pipefd_out_open[0], &ctx->out, ctx->capture_max)) == copy_pipe_result_failed) {
 		return res;
 	}
 
-	switch (copy_pipe(ctx->pipefd_err[0], &ctx->err)) {
+	// stderr is never spilled, it is printed in full when a command fails
+	switch (copy_pipe(ctx->pipefd_err[0], &ctx->pipefd_err_open[0], &ctx->err, 0)) {
 	case copy_pipe_result_waiting:
 		return copy_pipe_result_waiting;
 	case copy_pipe_result_finished:
@@ -117,6 +134,117 @@ run_cmd_ctx_close_fds(struct run_cmd_ctx *ctx)
 
 }
 
+/*
+ * SIGCHLD is turned into readiness on a self-pipe so that run_cmd_wait can
+ * poll for child exits alongside the output pipes of running commands.
+ */
+static int sigchld_pipe[2] = { -1, -1 };
+
+static void
+sigchld_handler(int sig)
+{
+	int e = errno;
+	if (write(sigchld_pipe[1], "", 1) == -1) {
+		// the pipe is full, so a wakeup is already pending
+	}
+	errno = e;
+}
+
+static bool
+sigchld_pipe_init(void)
+{
+	static bool init = false;
+	if (init) {
+		return sigchld_pipe[0] != -1;
+	}
+	init = true;
+
+	int fds[2];
+	if (pipe(fds) == -1) {
+		LOG_W("failed to create pipe: %s", strerror(errno));
+		return false;
+	}
+
+	uint32_t i;
+	for (i = 0; i < 2; ++i) {
+		if (fcntl(fds[i], F_SETFD, FD_CLOEXEC) == -1
+		    || fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK) == -1) {
+			LOG_W("failed to set pipe flags: %s", strerror(errno));
+			goto err;
+		}
+	}
+
+	sigchld_pipe[0] = fds[0];
+	sigchld_pipe[1] = fds[1];
+
+	struct sigaction sa = { .sa_handler = sigchld_handler, .sa_flags = SA_RESTART | SA_NOCLDSTOP };
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGCHLD, &sa, NULL) == -1) {
+		LOG_W("failed to install SIGCHLD handler: %s", strerror(errno));
+		sigchld_pipe[0] = sigchld_pipe[1] = -1;
+		goto err;
+	}
+
+	return true;
+err:
+	close(fds[0]);
+	close(fds[1]);
+	return false;
+}
+
+/*
+ * The SIGCHLD handler interrupts blocking calls in children that don't exec,
+ * e.g. the poll() in the embedded samurai, which treats that as fatal.
+ */
+void
+run_cmd_wait_reset(void)
+{
+	if (sigchld_pipe[0] == -1) {
+		return;
+	}
+
+	struct sigaction sa = { .sa_handler = SIG_DFL };
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGCHLD, &sa, NULL);
+
+	close(sigchld_pipe[0]);
+	close(sigchld_pipe[1]);
+	sigchld_pipe[0] = sigchld_pipe[1] = -1;
+}
+
+void
+run_cmd_wait(struct run_cmd_ctx **ctxs, uint32_t len, uint32_t timeout_ms)
+{
+	struct pollfd *fds = z_calloc(len * 2 + 1, sizeof(struct pollfd));
+	uint32_t i, nfds = 0;
+
+	if (sigchld_pipe[0] != -1) {
+		fds[nfds++] = (struct pollfd) { .fd = sigchld_pipe[0], .events = POLLIN };
+	}
+
+	for (i = 0; i < len; ++i) {
+		if (ctxs[i]->pipefd_out_open[0]) {
+			fds[nfds++] = (struct pollfd) { .fd = ctxs[i]->pipefd_out[0], .events = POLLIN };
+		}
+
+		if (ctxs[i]->pipefd_err_open[0]) {
+			fds[nfds++] = (struct pollfd) { .fd = ctxs[i]->pipefd_err[0], .events = POLLIN };
+		}
+	}
+
+	if (poll(fds, nfds, timeout_ms) == -1 && errno != EINTR) {
+		LOG_W("poll failed: %s", strerror(errno));
+	}
+
+	if (sigchld_pipe[0] != -1) {
+		char buf[64];
+		while (read(sigchld_pipe[0], buf, sizeof(buf)) > 0) {
+		}
+	}
+
+	z_free(fds);
+}
+
 enum run_cmd_state
 run_cmd_collect(struct run_cmd_ctx *ctx)
 {
@@ -138,10 +266,7 @@ run_cmd_collect(struct run_cmd_ctx *ctx)
 			if (ctx->flags & run_cmd_ctx_flag_async) {
 				return run_cmd_running;
 			} else {
-				// sleep here for 1ms to give the process some
-				// time to complete
-				struct timespec req = { .tv_nsec = 1000000, };
-				nanosleep(&req, NULL);
+				run_cmd_wait(&ctx, 1, RUN_CMD_WAIT_MAX);
 			}
 		} else {
 			break;
@@ -255,6 +380,8 @@ run_cmd_internal(struct run_cmd_ctx *ctx, const char *_cmd, char *const *argv, c
 		}
 	}
 
+	sigchld_pipe_init();
+
 	if ((ctx->pid = fork()) == -1) {
 		goto err;
 	} else if (ctx->pid == 0 /* child */) {
@@ -454,7 +581,13 @@ run_cmd_argv(struct run_cmd_ctx *ctx, char *const *argv, const char *envstr, uin
 		argv = (char **)new_argv;
 	}
 
-	ret = run_cmd_internal(ctx, cmd.buf, (char *const *)argv, envstr, envc);
+	if (!(ctx->flags & run_cmd_ctx_flag_async)) {
+		profile_begin("run_cmd", cmd.buf);
+		ret = run_cmd_internal(ctx, cmd.buf, (char *const *)argv, envstr, envc);
+		profile_end();
+	} else {
+		ret = run_cmd_internal(ctx, cmd.buf, (char *const *)argv, envstr, envc);
+	}
 err:
 	fs_source_destroy(&src);
 	if (new_argv) {
@@ -476,7 +609,13 @@ run_cmd(struct run_cmd_ctx *ctx, const char *argstr, uint32_t argc, const char *
 		goto err;
 	}
 
-	ret = run_cmd_internal(ctx, cmd.buf, (char *const *)argv, envstr, envc);
+	if (!(ctx->flags & run_cmd_ctx_flag_async)) {
+		profile_begin("run_cmd", cmd.buf);
+		ret = run_cmd_internal(ctx, cmd.buf, (char *const *)argv, envstr, envc);
+		profile_end();
+	} else {
+		ret = run_cmd_internal(ctx, cmd.buf, (char *const *)argv, envstr, envc);
+	}
 err:
 	fs_source_destroy(&src);
 	if (argv) {
@@ -490,16 +629,8 @@ void
 run_cmd_ctx_destroy(struct run_cmd_ctx *ctx)
 {
 	run_cmd_ctx_close_fds(ctx);
-
-	if (ctx->out.size) {
-		z_free(ctx->out.buf);
-		ctx->out.size = 0;
-	}
-
-	if (ctx->err.size) {
-		z_free(ctx->err.buf);
-		ctx->err.size = 0;
-	}
+	run_cmd_pipe_destroy(&ctx->out);
+	run_cmd_pipe_destroy(&ctx->err);
 }
 
 bool
@@ -37,6 +37,20 @@ timer_end(struct timer *t)
 	return (float)ns / 1000000000.0f;
 }
 
+uint64_t
+timer_elapsed_ns(struct timer *t)
+{
+	struct timespec now;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &now) == -1) {
+		LOG_E("clock_gettime: %s", strerror(errno));
+		return 0;
+	}
+
+	return (uint64_t)((int64_t)(now.tv_sec - t->start.tv_sec) * 1000000000LL
+			  + (now.tv_nsec - t->start.tv_nsec));
+}
+
 void
 timer_sleep(uint64_t nanoseconds)
 {
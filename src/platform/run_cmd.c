@@ -13,7 +13,12 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
 
+#include "buf_size.h"
+#include "log.h"
+#include "platform/filesystem.h"
 #include "platform/mem.h"
 #include "platform/run_cmd.h"
 
@@ -65,3 +70,190 @@ argstr_to_argv(const char *argstr, uint32_t argc, const char *prepend, char *con
 	*res = (char *const *)new_argv;
 	return argc;
 }
+
+size_t
+run_cmd_pipe_keep_tail(struct run_cmd_pipe_ctx *ctx, size_t len)
+{
+	if (ctx->len <= len) {
+		return 0;
+	}
+
+	size_t dropped = ctx->len - len;
+	memmove(ctx->buf, &ctx->buf[dropped], len);
+	// the buffer is expected to be zeroed past len
+	memset(&ctx->buf[len], 0, dropped);
+	ctx->len = len;
+	return dropped;
+}
+
+bool
+run_cmd_pipe_spill(struct run_cmd_pipe_ctx *ctx, size_t max)
+{
+	if (!max || ctx->len < max) {
+		return true;
+	}
+
+	if (!ctx->spill && !(ctx->spill = tmpfile())) {
+		LOG_E("failed to create temporary file: %s", strerror(errno));
+		return false;
+	}
+
+	if (!fs_fwrite(ctx->buf, ctx->len, ctx->spill)) {
+		return false;
+	}
+
+	ctx->spilled += ctx->len;
+	ctx->len = 0;
+	ctx->buf[0] = 0;
+	return true;
+}
+
+bool
+run_cmd_pipe_write(struct run_cmd_pipe_ctx *ctx, const char *path)
+{
+	if (!ctx->spill) {
+		return fs_write(path, (uint8_t *)ctx->buf, ctx->len);
+	}
+
+	FILE *f;
+	if (!(f = fs_fopen(path, "wb"))) {
+		return false;
+	}
+
+	bool ret = false;
+	char buf[BUF_SIZE_32k];
+	uint64_t left = ctx->spilled;
+
+	rewind(ctx->spill);
+	while (left) {
+		size_t n = left < sizeof(buf) ? left : sizeof(buf);
+		if (!fs_fread(buf, n, ctx->spill) || !fs_fwrite(buf, n, f)) {
+			goto ret;
+		}
+		left -= n;
+	}
+
+	if (ctx->len && !fs_fwrite(ctx->buf, ctx->len, f)) {
+		goto ret;
+	}
+
+	ret = true;
+ret:
+	if (!fs_fclose(f)) {
+		ret = false;
+	}
+	return ret;
+}
+
+void
+run_cmd_pipe_destroy(struct run_cmd_pipe_ctx *ctx)
+{
+	if (ctx->size) {
+		z_free(ctx->buf);
+		ctx->size = 0;
+	}
+
+	if (ctx->spill) {
+		fclose(ctx->spill);
+		ctx->spill = NULL;
+	}
+}
+
+bool
+run_cmd_jobs(uint32_t total,
+	uint32_t jobs,
+	void *ctx,
+	run_cmd_jobs_argv_cb argv_cb,
+	run_cmd_jobs_done_cb done_cb)
+{
+	if (jobs > total) {
+		jobs = total;
+	}
+
+	if (!jobs) {
+		return true;
+	}
+
+	struct run_cmd_ctx *cmd_ctxs = z_calloc(jobs, sizeof(struct run_cmd_ctx));
+	struct run_cmd_ctx **running = z_calloc(jobs, sizeof(struct run_cmd_ctx *));
+	uint32_t *ids = z_calloc(jobs, sizeof(uint32_t));
+	bool *busy = z_calloc(jobs, sizeof(bool));
+
+	bool ret = true;
+	uint32_t i, next = 0, busy_len = 0;
+
+	while (next < total || busy_len) {
+		for (i = 0; i < jobs && next < total; ++i) {
+			if (busy[i]) {
+				continue;
+			}
+
+			uint32_t id = next++;
+
+			cmd_ctxs[i] = (struct run_cmd_ctx) { .flags = run_cmd_ctx_flag_async };
+			if (!run_cmd_argv(&cmd_ctxs[i], (char *const *)argv_cb(ctx, id), NULL, 0)) {
+				done_cb(ctx, id, &cmd_ctxs[i], false);
+				run_cmd_ctx_destroy(&cmd_ctxs[i]);
+				ret = false;
+				continue;
+			}
+
+			ids[i] = id;
+			busy[i] = true;
+			++busy_len;
+		}
+
+		if (!busy_len) {
+			continue;
+		}
+
+		uint32_t len = 0;
+		for (i = 0; i < jobs; ++i) {
+			if (busy[i]) {
+				running[len++] = &cmd_ctxs[i];
+			}
+		}
+
+		run_cmd_wait(running, len, RUN_CMD_WAIT_MAX);
+
+		for (i = 0; i < jobs; ++i) {
+			if (!busy[i]) {
+				continue;
+			}
+
+			bool ok = false;
+			switch (run_cmd_collect(&cmd_ctxs[i])) {
+			case run_cmd_running:
+				continue;
+			case run_cmd_error:
+				break;
+			case run_cmd_finished:
+				ok = cmd_ctxs[i].status == 0;
+				break;
+			}
+
+			if (!ok) {
+				ret = false;
+			}
+
+			done_cb(ctx, ids[i], &cmd_ctxs[i], ok);
+
+			if (cmd_ctxs[i].out.len) {
+				log_plain("%s", cmd_ctxs[i].out.buf);
+			}
+			if (cmd_ctxs[i].err.len) {
+				log_plain("%s", cmd_ctxs[i].err.buf);
+			}
+
+			run_cmd_ctx_destroy(&cmd_ctxs[i]);
+			busy[i] = false;
+			--busy_len;
+		}
+	}
+
+	z_free(busy);
+	z_free(ids);
+	z_free(running);
+	z_free(cmd_ctxs);
+	return ret;
+}
@@ -178,6 +178,11 @@ bool
 fs_mkdir(const char *path)
 {
 	if (!CreateDirectory(path, NULL)) {
+		if (GetLastError() == ERROR_ALREADY_EXISTS && fs_dir_exists(path)) {
+			// another process may have created it in the meantime
+			return true;
+		}
+
 		LOG_E("failed to create directory %s: %s", path, win32_error());
 		return false;
 	}
@@ -185,6 +190,23 @@ fs_mkdir(const char *path)
 	return true;
 }
 
+bool
+fs_rmdir(const char *path)
+{
+	if (!RemoveDirectory(path)) {
+		LOG_E("failed to remove directory %s: %s", path, win32_error());
+		return false;
+	}
+
+	return true;
+}
+
+int64_t
+fs_stat_mtime_ns(const struct stat *sb)
+{
+	return (int64_t)sb->st_mtime * 1000000000;
+}
+
 bool
 fs_copy_file(const char *src, const char *dest)
 {
@@ -196,6 +218,76 @@ fs_copy_file(const char *src, const char *dest)
 	return true;
 }
 
+static bool
+fs_set_mtime(const char *path, const FILETIME *mtime)
+{
+	HANDLE h;
+	bool ret;
+
+	h = CreateFile(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (h == INVALID_HANDLE_VALUE) {
+		LOG_E("failed to open %s: %s", path, win32_error());
+		return false;
+	}
+
+	if (!(ret = SetFileTime(h, NULL, NULL, mtime))) {
+		LOG_E("failed to set modification time of %s: %s", path, win32_error());
+	}
+
+	CloseHandle(h);
+	return ret;
+}
+
+/*
+ * CopyFile preserves the last write time, but a fixup changes it, so it is
+ * set back to that of src afterwards.
+ */
+bool
+fs_copy_file_if_changed(const char *src, const char *dest, fs_copy_fixup_cb fixup, void *ctx, bool *copied)
+{
+	WIN32_FILE_ATTRIBUTE_DATA src_attr, dest_attr;
+	*copied = false;
+
+	if (!GetFileAttributesEx(src, GetFileExInfoStandard, &src_attr)) {
+		LOG_E("failed to get attributes of %s: %s", src, win32_error());
+		return false;
+	}
+
+	if (GetFileAttributesEx(dest, GetFileExInfoStandard, &dest_attr)
+	    && src_attr.nFileSizeHigh == dest_attr.nFileSizeHigh
+	    && src_attr.nFileSizeLow == dest_attr.nFileSizeLow) {
+		if (CompareFileTime(&src_attr.ftLastWriteTime, &dest_attr.ftLastWriteTime) == 0) {
+			return true;
+		} else if (!fixup && fs_same_contents(src, dest)) {
+			goto set_mtime;
+		}
+	}
+
+	if (!fs_copy_file(src, dest)) {
+		return false;
+	}
+
+	*copied = true;
+
+	if (fixup && !fixup(ctx, dest)) {
+		return false;
+	}
+
+set_mtime:
+	// this comes last so that dest is only considered up to date once
+	// everything above has succeeded
+	return fs_set_mtime(dest, &src_attr.ftLastWriteTime);
+}
+
+bool
+fs_touch(const char *path)
+{
+	FILETIME now;
+
+	GetSystemTimeAsFileTime(&now);
+	return fs_set_mtime(path, &now);
+}
+
 bool
 fs_dir_foreach(const char *path, void *_ctx, fs_dir_foreach_cb cb)
 {
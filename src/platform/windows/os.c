@@ -54,6 +54,24 @@ char *os_getcwd(char *buf, size_t size)
 	return buf;
 }
 
+uint32_t os_getpid(void)
+{
+	return GetCurrentProcessId();
+}
+
+bool
+os_peak_rss(uint64_t *bytes)
+{
+	// GetProcessMemoryInfo would need psapi, which muon doesn't link
+	return false;
+}
+
+bool
+os_run_isolated(bool (*fn)(void *ctx, uint32_t i), void *ctx, uint32_t n, bool *res)
+{
+	return false;
+}
+
 /*
  * getopt ported from musl libc
  */
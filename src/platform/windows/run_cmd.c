@@ -21,6 +21,7 @@
 #include "platform/path.h"
 #include "platform/run_cmd.h"
 #include "platform/windows/win32_error.h"
+#include "profile.h"
 
 #define CLOSE_PIPE(p_) do { \
 		if ((p_) != INVALID_HANDLE_VALUE && !CloseHandle(p_)) { \
@@ -559,7 +560,13 @@ run_cmd_argv(struct run_cmd_ctx *ctx, char *const *argtab, const char *envstr, u
 		goto err;
 	}
 
-	ret = run_cmd_internal(ctx, cmd.buf, envstr, envc);
+	if (!(ctx->flags & run_cmd_ctx_flag_async)) {
+		profile_begin("run_cmd", cmd_argv0.buf);
+		ret = run_cmd_internal(ctx, cmd.buf, envstr, envc);
+		profile_end();
+	} else {
+		ret = run_cmd_internal(ctx, cmd.buf, envstr, envc);
+	}
 
 err:
 	fs_source_destroy(&src);
@@ -581,7 +588,13 @@ run_cmd(struct run_cmd_ctx *ctx, const char *argstr, uint32_t argc, const char *
 		goto err;
 	}
 
-	ret = run_cmd_internal(ctx, cmd.buf, envstr, envc);
+	if (!(ctx->flags & run_cmd_ctx_flag_async)) {
+		profile_begin("run_cmd", cmd_argv0.buf);
+		ret = run_cmd_internal(ctx, cmd.buf, envstr, envc);
+		profile_end();
+	} else {
+		ret = run_cmd_internal(ctx, cmd.buf, envstr, envc);
+	}
 
 err:
 	fs_source_destroy(&src);
@@ -596,16 +609,40 @@ run_cmd_ctx_destroy(struct run_cmd_ctx *ctx)
 {
 	CloseHandle(ctx->process);
 	run_cmd_ctx_close_pipes(ctx);
+	run_cmd_pipe_destroy(&ctx->out);
+	run_cmd_pipe_destroy(&ctx->err);
+}
+
+/*
+ * Output pipes can't be waited on together with process handles, so only
+ * process exits wake this up early.  The timeout is kept short while output
+ * is being captured so that a child never stalls on a full pipe for long.
+ */
+void
+run_cmd_wait(struct run_cmd_ctx **ctxs, uint32_t len, uint32_t timeout_ms)
+{
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	DWORD i, nhandles = 0;
+
+	for (i = 0; i < len && nhandles < MAXIMUM_WAIT_OBJECTS; ++i) {
+		handles[nhandles++] = ctxs[i]->process;
 
-	if (ctx->out.size) {
-		z_free(ctx->out.buf);
-		ctx->out.size = 0;
+		if (!(ctxs[i]->flags & run_cmd_ctx_flag_dont_capture) && timeout_ms > 10) {
+			timeout_ms = 10;
+		}
 	}
 
-	if (ctx->err.size) {
-		z_free(ctx->err.buf);
-		ctx->err.size = 0;
+	if (!nhandles) {
+		Sleep(timeout_ms);
+		return;
 	}
+
+	WaitForMultipleObjects(nhandles, handles, FALSE, timeout_ms);
+}
+
+void
+run_cmd_wait_reset(void)
+{
 }
 
 bool
@@ -24,6 +24,16 @@ timer_end(struct timer *t)
 	return (float)(end.QuadPart - t->start.QuadPart) / (float)t->freq.QuadPart;
 }
 
+uint64_t
+timer_elapsed_ns(struct timer *t)
+{
+	LARGE_INTEGER end;
+
+	QueryPerformanceCounter(&end);
+	uint64_t ticks = end.QuadPart - t->start.QuadPart, freq = t->freq.QuadPart;
+	return ticks / freq * 1000000000ULL + ticks % freq * 1000000000ULL / freq;
+}
+
 void
 timer_sleep(uint64_t nanoseconds)
 {
@@ -0,0 +1,358 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "datastructures/arr.h"
+#include "formats/json.h"
+#include "log.h"
+#include "platform/filesystem.h"
+#include "platform/timer.h"
+#include "profile.h"
+
+struct profile_span {
+	const char *cat;
+	uint32_t name, detail, lane;
+	uint64_t start, dur, child_dur;
+};
+
+static struct {
+	bool enabled;
+	struct timer timer;
+	struct arr spans, stack, strs;
+} profile;
+
+void
+profile_init(void)
+{
+	profile.enabled = true;
+	timer_start(&profile.timer);
+	arr_init(&profile.spans, 1024, sizeof(struct profile_span));
+	arr_init(&profile.stack, 64, sizeof(uint32_t));
+	arr_init(&profile.strs, 4096, 1);
+
+	// offset 0 is the empty string, used for spans without a detail
+	arr_push(&profile.strs, &(char) { 0 });
+}
+
+void
+profile_destroy(void)
+{
+	if (!profile.enabled) {
+		return;
+	}
+
+	arr_destroy(&profile.spans);
+	arr_destroy(&profile.stack);
+	arr_destroy(&profile.strs);
+	profile.enabled = false;
+}
+
+bool
+profile_enabled(void)
+{
+	return profile.enabled;
+}
+
+uint64_t
+profile_now(void)
+{
+	return profile.enabled ? timer_elapsed_ns(&profile.timer) : 0;
+}
+
+static uint32_t
+profile_str(const char *s, uint32_t len)
+{
+	if (!len) {
+		return 0;
+	}
+
+	uint32_t off = profile.strs.len;
+	arr_grow_by(&profile.strs, len + 1);
+	char *dest = arr_get(&profile.strs, off);
+	memcpy(dest, s, len);
+	dest[len] = 0;
+	return off;
+}
+
+static uint32_t
+profile_strv(const char *fmt, va_list ap)
+{
+	char buf[4096];
+	int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+	if (len < 0) {
+		return 0;
+	} else if ((size_t)len >= sizeof(buf)) {
+		len = sizeof(buf) - 1;
+	}
+
+	return profile_str(buf, len);
+}
+
+static const char *
+profile_get_str(uint32_t off)
+{
+	return arr_get(&profile.strs, off);
+}
+
+static void
+profile_push(const char *cat, const char *name, uint32_t detail)
+{
+	uint32_t i = arr_push(&profile.spans, &(struct profile_span) {
+		.cat = cat,
+		.name = profile_str(name, strlen(name)),
+		.detail = detail,
+		.start = timer_elapsed_ns(&profile.timer),
+	});
+
+	arr_push(&profile.stack, &i);
+}
+
+void
+profile_begin(const char *cat, const char *name)
+{
+	if (!profile.enabled) {
+		return;
+	}
+
+	profile_push(cat, name, 0);
+}
+
+void
+profile_begin_detail(const char *cat, const char *name, const char *fmt, ...)
+{
+	if (!profile.enabled) {
+		return;
+	}
+
+	va_list ap;
+	va_start(ap, fmt);
+	uint32_t detail = profile_strv(fmt, ap);
+	va_end(ap);
+
+	profile_push(cat, name, detail);
+}
+
+void
+profile_end(void)
+{
+	if (!profile.enabled) {
+		return;
+	}
+
+	assert(profile.stack.len);
+	uint32_t i = *(uint32_t *)arr_get(&profile.stack, profile.stack.len - 1);
+	--profile.stack.len;
+
+	struct profile_span *span = arr_get(&profile.spans, i);
+	span->dur = timer_elapsed_ns(&profile.timer) - span->start;
+
+	if (profile.stack.len) {
+		uint32_t parent = *(uint32_t *)arr_get(&profile.stack, profile.stack.len - 1);
+		((struct profile_span *)arr_get(&profile.spans, parent))->child_dur += span->dur;
+	}
+}
+
+void
+profile_record(const char *cat, uint32_t lane, uint64_t start, const char *name, const char *fmt, ...)
+{
+	if (!profile.enabled) {
+		return;
+	}
+
+	va_list ap;
+	va_start(ap, fmt);
+	uint32_t detail = profile_strv(fmt, ap);
+	va_end(ap);
+
+	arr_push(&profile.spans, &(struct profile_span) {
+		.cat = cat,
+		.name = profile_str(name, strlen(name)),
+		.detail = detail,
+		.lane = lane,
+		.start = start,
+		.dur = timer_elapsed_ns(&profile.timer) - start,
+	});
+}
+
+/*
+ * Spans that are still open, e.g. because setup failed, end now.
+ */
+static void
+profile_close_open_spans(void)
+{
+	uint64_t now = timer_elapsed_ns(&profile.timer);
+
+	uint32_t i;
+	for (i = 0; i < profile.stack.len; ++i) {
+		struct profile_span *span = arr_get(&profile.spans, *(uint32_t *)arr_get(&profile.stack, i));
+		span->dur = now - span->start;
+	}
+}
+
+/*
+ * The output is in the chrome trace event format, which can be loaded in
+ * e.g. chrome://tracing, perfetto, or speedscope.  Spans recorded on lane n
+ * are shown as thread n + 1.
+ */
+bool
+profile_write(const char *path)
+{
+	if (!profile.enabled) {
+		return true;
+	}
+
+	profile_close_open_spans();
+
+	FILE *f;
+	if (!(f = fs_fopen(path, "wb"))) {
+		return false;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"muon\"}}", f);
+
+	uint32_t i, lanes = 0;
+	for (i = 0; i < profile.spans.len; ++i) {
+		struct profile_span *span = arr_get(&profile.spans, i);
+
+		if (span->lane > lanes) {
+			lanes = span->lane;
+		}
+
+		fputs(",\n{\"name\":", f);
+		json_write_str(f, profile_get_str(span->name));
+		fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+			span->cat,
+			span->start / 1000.0,
+			span->dur / 1000.0,
+			span->lane + 1);
+
+		if (span->detail) {
+			fputs(",\"args\":{\"detail\":", f);
+			json_write_str(f, profile_get_str(span->detail));
+			fputc('}', f);
+		}
+
+		fputc('}', f);
+	}
+
+	for (i = 1; i <= lanes; ++i) {
+		fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"lane %d\"}}",
+			i + 1, i);
+	}
+
+	fputs("\n]}\n", f);
+
+	return fs_fclose(f);
+}
+
+struct profile_total {
+	const struct profile_span *span;
+	uint64_t total, self;
+	uint32_t count;
+};
+
+static int32_t
+profile_span_key_cmp(const struct profile_span *a, const struct profile_span *b)
+{
+	int32_t r;
+	if ((r = strcmp(a->cat, b->cat))) {
+		return r;
+	} else if ((r = strcmp(profile_get_str(a->name), profile_get_str(b->name)))) {
+		return r;
+	} else {
+		return strcmp(profile_get_str(a->detail), profile_get_str(b->detail));
+	}
+}
+
+static int32_t
+profile_span_ptr_cmp(const void *_a, const void *_b, void *_ctx)
+{
+	return profile_span_key_cmp(*(const struct profile_span **)_a, *(const struct profile_span **)_b);
+}
+
+static int32_t
+profile_total_cmp(const void *_a, const void *_b, void *_ctx)
+{
+	const struct profile_total *a = _a, *b = _b;
+
+	if (a->total > b->total) {
+		return -1;
+	} else if (a->total < b->total) {
+		return 1;
+	} else {
+		return 0;
+	}
+}
+
+/*
+ * Spans with the same category, name, and detail (e.g. every call of a
+ * builtin at one location) are added up, and the n with the largest total
+ * time are printed.
+ */
+void
+profile_print_slowest(uint32_t n)
+{
+	if (!profile.enabled || !profile.spans.len) {
+		return;
+	}
+
+	profile_close_open_spans();
+
+	struct arr spans, totals;
+	arr_init(&spans, profile.spans.len, sizeof(struct profile_span *));
+	arr_init(&totals, 256, sizeof(struct profile_total));
+
+	uint32_t i;
+	for (i = 0; i < profile.spans.len; ++i) {
+		const struct profile_span *span = arr_get(&profile.spans, i);
+		arr_push(&spans, &span);
+	}
+
+	arr_sort(&spans, NULL, profile_span_ptr_cmp);
+
+	struct profile_total *total = NULL;
+	for (i = 0; i < spans.len; ++i) {
+		const struct profile_span *span = *(const struct profile_span **)arr_get(&spans, i);
+
+		if (!total || profile_span_key_cmp(total->span, span) != 0) {
+			total = arr_get(&totals, arr_push(&totals, &(struct profile_total) { .span = span }));
+		}
+
+		total->total += span->dur;
+		total->self += span->dur - span->child_dur;
+		++total->count;
+	}
+
+	arr_sort(&totals, NULL, profile_total_cmp);
+
+	LOG_I("slowest profiled spans:");
+	log_plain("%10s %10s %8s  %-14s %s\n", "total ms", "self ms", "count", "category", "name");
+
+	for (i = 0; i < totals.len && i < n; ++i) {
+		total = arr_get(&totals, i);
+
+		log_plain("%10.3f %10.3f %8d  %-14s %s",
+			total->total / 1e6,
+			total->self / 1e6,
+			total->count,
+			total->span->cat,
+			profile_get_str(total->span->name));
+
+		if (total->span->detail) {
+			log_plain(" (%s)", profile_get_str(total->span->detail));
+		}
+
+		log_plain("\n");
+	}
+
+	arr_destroy(&totals);
+	arr_destroy(&spans);
+}
@@ -37,14 +37,6 @@ static const uint32_t k[] = {
 	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
-struct buffer_state {
-	const uint8_t *p;
-	size_t len;
-	size_t total_len;
-	int single_one_delivered; /* bool */
-	int total_len_delivered;  /* bool */
-};
-
 static inline uint32_t
 right_rot(uint32_t value, unsigned int count)
 {
@@ -54,83 +46,12 @@ right_rot(uint32_t value, unsigned int count)
 	return value >> count | value << (32 - count);
 }
 
-static void
-init_buf_state(struct buffer_state *state, const void *input, size_t len)
-{
-	state->p = input;
-	state->len = len;
-	state->total_len = len;
-	state->single_one_delivered = 0;
-	state->total_len_delivered = 0;
-}
-
-static inline const uint8_t *
-calc_chunk(uint8_t chunk[CHUNK_SIZE], struct buffer_state *state)
-{
-	if (state->total_len_delivered) {
-		return NULL;
-	}
-
-	/* For whole chunks, there is no need to copy data, we just return the original chunk. */
-	if (state->len >= CHUNK_SIZE) {
-		const uint8_t *const chunk_start = state->p;
-		state->p += CHUNK_SIZE;
-		state->len -= CHUNK_SIZE;
-		return chunk_start;
-	}
-
-	const uint8_t *const chunk_start = chunk;
-	memcpy(chunk, state->p, state->len);
-	chunk += state->len;
-	size_t space_in_chunk = CHUNK_SIZE - state->len;
-	state->p += state->len;
-	state->len = 0;
-
-	/* If we are here, space_in_chunk is one at minimum. */
-	if (!state->single_one_delivered) {
-		*chunk++ = 0x80;
-		space_in_chunk -= 1;
-		state->single_one_delivered = 1;
-	}
-
-	/*
-	 * Now:
-	 * - either there is enough space left for the total length, and we can conclude,
-	 * - or there is too little space left, and we have to pad the rest of this chunk with zeroes. In the latter
-	 *   case, we will conclude at the next invocation of this function.
-	 */
-	if (space_in_chunk >= TOTAL_LEN_LEN) {
-		const size_t left = space_in_chunk - TOTAL_LEN_LEN;
-		size_t len = state->total_len;
-		int i;
-		memset(chunk, 0x00, left);
-		chunk += left;
-
-		/* Storing of len * 8 as a big endian 64-bit without overflow. */
-		chunk[7] = (uint8_t)(len << 3);
-		len >>= 5;
-		for (i = 6; i >= 0; i--) {
-			chunk[i] = (uint8_t)len;
-			len >>= 8;
-		}
-		state->total_len_delivered = 1;
-	} else {
-		memset(chunk, 0x00, space_in_chunk);
-	}
-
-	return chunk_start;
-}
-
 /*
- * Limitations:
- * - Since input is a pointer, the data to hash must be directly accessible to the processor, which could be a problem
- *   for large data sizes.
- * - SHA algorithms theoretically operate on bit strings. However, this implementation has no support for bit string
- *   lengths that are not multiples of eight, and it really operates on arrays of bytes.  In particular, the len
- *   parameter is a number of bytes.
+ * Process n consecutive 512-bit chunks starting at p, updating the hash
+ * values in h.
  */
-void
-calc_sha_256(uint8_t hash[32], const void *input, size_t len)
+static void
+sha_256_blocks_portable(uint32_t h[8], const uint8_t *p, size_t n)
 {
 	/*
 	 * Note 1: All integers (expect indexes) are 32-bit unsigned integers and addition is calculated modulo 2^32.
@@ -144,24 +65,9 @@ calc_sha_256(uint8_t hash[32], const void *input, size_t len)
 	 * message block data from bytes to words, for example, the first word of the input message "abc" after padding
 	 * is 0x61626380.
 	 */
-
-	/*
-	 * Initialize hash values (first 32 bits of the fractional parts of the square roots of the first 8 primes
-	 * 2..19):
-	 */
-	uint32_t h[] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
 	unsigned i, j;
 
-	/* 512-bit chunks is what we will operate on. */
-	uint8_t chunk[CHUNK_SIZE];
-
-	struct buffer_state state;
-
-	init_buf_state(&state, input, len);
-
-	const uint8_t *p;
-
-	while ((p = calc_chunk(chunk, &state))) {
+	for (; n; --n) {
 		uint32_t ah[8];
 
 		/* Initialize working variables to current hash value: */
@@ -224,12 +130,294 @@ calc_sha_256(uint8_t hash[32], const void *input, size_t len)
 			h[i] += ah[i];
 		}
 	}
+}
+
+/*
+ * Hardware accelerated implementations.  These are compiled whenever the
+ * compiler supports them and selected at runtime if the cpu does.
+ */
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHA_256_HAVE_X86_SHA
+#include <cpuid.h>
+#include <immintrin.h>
+
+__attribute__((target("sha,sse4.1")))
+static void
+sha_256_blocks_x86_sha(uint32_t h[8], const uint8_t *p, size_t n)
+{
+	const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i state0, state1, msg, tmp, abef_save, cdgh_save, m[4];
+	unsigned i;
+
+	/* The sha instructions expect the state as ABEF and CDGH. */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[0]), 0xb1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[4]), 0x1b);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+	for (; n; --n, p += CHUNK_SIZE) {
+		abef_save = state0;
+		cdgh_save = state1;
+
+		/* Four rounds per iteration, scheduling the message four words ahead. */
+		for (i = 0; i < 16; ++i) {
+			if (i < 4) {
+				m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&p[i * 16]), byte_swap);
+			}
+
+			msg = _mm_add_epi32(m[i & 3], _mm_loadu_si128((const __m128i *)&k[i * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+
+			if (i >= 3 && i < 15) {
+				tmp = _mm_alignr_epi8(m[i & 3], m[(i + 3) & 3], 4);
+				m[(i + 1) & 3] = _mm_add_epi32(m[(i + 1) & 3], tmp);
+				m[(i + 1) & 3] = _mm_sha256msg2_epu32(m[(i + 1) & 3], m[i & 3]);
+			}
+
+			msg = _mm_shuffle_epi32(msg, 0x0e);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+			if (i >= 1 && i < 13) {
+				m[(i + 3) & 3] = _mm_sha256msg1_epu32(m[(i + 3) & 3], m[i & 3]);
+			}
+		}
+
+		state0 = _mm_add_epi32(state0, abef_save);
+		state1 = _mm_add_epi32(state1, cdgh_save);
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+	state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+	_mm_storeu_si128((__m128i *)&h[0], state0);
+	_mm_storeu_si128((__m128i *)&h[4], state1);
+}
+
+static int
+sha_256_have_x86_sha(void)
+{
+	unsigned a, b, c, d;
+
+	if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSE4_1) || !(c & bit_SSSE3)) {
+		return 0;
+	} else if (__get_cpuid_max(0, 0) < 7) {
+		return 0;
+	}
+
+	__cpuid_count(7, 0, a, b, c, d);
+	return (b >> 29) & 1;
+}
+#endif
+
+#if defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__)) \
+	&& (defined(__linux__) || defined(__APPLE__))
+#define SHA_256_HAVE_ARM_SHA2
+#include <arm_neon.h>
+#ifdef __linux__
+#include <sys/auxv.h>
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif
+#endif
+
+#ifdef __clang__
+__attribute__((target("crypto")))
+#else
+__attribute__((target("+crypto")))
+#endif
+static void
+sha_256_blocks_arm_sha2(uint32_t h[8], const uint8_t *p, size_t n)
+{
+	uint32x4_t state0 = vld1q_u32(&h[0]), state1 = vld1q_u32(&h[4]);
+	uint32x4_t abcd_save, efgh_save, wk, tmp, m[4];
+	unsigned i;
+
+	for (; n; --n, p += CHUNK_SIZE) {
+		abcd_save = state0;
+		efgh_save = state1;
+
+		for (i = 0; i < 4; ++i) {
+			m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&p[i * 16])));
+		}
+
+		/* Four rounds per iteration, scheduling the message four words ahead. */
+		for (i = 0; i < 16; ++i) {
+			wk = vaddq_u32(m[i & 3], vld1q_u32(&k[i * 4]));
+
+			if (i < 12) {
+				m[i & 3] = vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]);
+				m[i & 3] = vsha256su1q_u32(m[i & 3], m[(i + 2) & 3], m[(i + 3) & 3]);
+			}
+
+			tmp = state0;
+			state0 = vsha256hq_u32(state0, state1, wk);
+			state1 = vsha256h2q_u32(state1, tmp, wk);
+		}
+
+		state0 = vaddq_u32(state0, abcd_save);
+		state1 = vaddq_u32(state1, efgh_save);
+	}
+
+	vst1q_u32(&h[0], state0);
+	vst1q_u32(&h[4], state1);
+}
+
+static int
+sha_256_have_arm_sha2(void)
+{
+#ifdef __APPLE__
+	return 1;
+#else
+	return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+#endif
+}
+#endif
+
+typedef void (*sha_256_blocks_fn)(uint32_t h[8], const uint8_t *p, size_t n);
+
+static sha_256_blocks_fn
+sha_256_select_blocks(void)
+{
+	static sha_256_blocks_fn blocks;
+
+	if (blocks) {
+		return blocks;
+	}
+
+	blocks = sha_256_blocks_portable;
+#ifdef SHA_256_HAVE_X86_SHA
+	if (sha_256_have_x86_sha()) {
+		blocks = sha_256_blocks_x86_sha;
+	}
+#endif
+#ifdef SHA_256_HAVE_ARM_SHA2
+	if (sha_256_have_arm_sha2()) {
+		blocks = sha_256_blocks_arm_sha2;
+	}
+#endif
+
+	return blocks;
+}
+
+static void
+sha_256_init_h(struct sha_256 *ctx, const uint32_t h[8], unsigned hash_len)
+{
+	memcpy(ctx->h, h, sizeof(ctx->h));
+	ctx->chunk_len = 0;
+	ctx->total_len = 0;
+	ctx->hash_len = hash_len;
+	ctx->blocks = sha_256_select_blocks();
+}
+
+void
+sha_256_init(struct sha_256 *ctx)
+{
+	/*
+	 * Initialize hash values (first 32 bits of the fractional parts of the square roots of the first 8 primes
+	 * 2..19):
+	 */
+	static const uint32_t h[] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	sha_256_init_h(ctx, h, 32);
+}
+
+/*
+ * SHA-224 is SHA-256 with different initial values and a truncated result.
+ */
+void
+sha_224_init(struct sha_256 *ctx)
+{
+	static const uint32_t h[] = {
+		0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+	};
+
+	sha_256_init_h(ctx, h, 28);
+}
+
+void
+sha_256_update(struct sha_256 *ctx, const void *input, size_t len)
+{
+	const uint8_t *p = input;
+	sha_256_blocks_fn blocks = ctx->blocks;
+
+	ctx->total_len += len;
+
+	/* Complete a partial chunk left over from a previous update first. */
+	if (ctx->chunk_len) {
+		size_t n = CHUNK_SIZE - ctx->chunk_len;
+		if (n > len) {
+			n = len;
+		}
+
+		memcpy(&ctx->chunk[ctx->chunk_len], p, n);
+		ctx->chunk_len += n;
+		p += n;
+		len -= n;
+
+		if (ctx->chunk_len < CHUNK_SIZE) {
+			return;
+		}
+
+		blocks(ctx->h, ctx->chunk, 1);
+		ctx->chunk_len = 0;
+	}
+
+	/* For whole chunks, there is no need to copy data. */
+	if (len >= CHUNK_SIZE) {
+		blocks(ctx->h, p, len / CHUNK_SIZE);
+		p += len - len % CHUNK_SIZE;
+		len %= CHUNK_SIZE;
+	}
+
+	memcpy(ctx->chunk, p, len);
+	ctx->chunk_len = len;
+}
+
+void
+sha_256_final(struct sha_256 *ctx, uint8_t *hash)
+{
+	unsigned i, j;
+	uint64_t len = ctx->total_len;
+	uint8_t pad[CHUNK_SIZE + TOTAL_LEN_LEN] = { 0x80 };
+
+	/*
+	 * Append a single one bit, then zeroes until there is just enough space
+	 * left for the total length.
+	 */
+	size_t pad_len = (ctx->chunk_len < CHUNK_SIZE - TOTAL_LEN_LEN ? CHUNK_SIZE : 2 * CHUNK_SIZE)
+			 - ctx->chunk_len - TOTAL_LEN_LEN;
+
+	/* Storing of len * 8 as a big endian 64-bit without overflow. */
+	for (i = 0; i < TOTAL_LEN_LEN; ++i) {
+		pad[pad_len + i] = (uint8_t)((len << 3) >> (8 * (TOTAL_LEN_LEN - 1 - i)));
+	}
+
+	sha_256_update(ctx, pad, pad_len + TOTAL_LEN_LEN);
 
 	/* Produce the final hash value (big-endian): */
-	for (i = 0, j = 0; i < 8; i++) {
-		hash[j++] = (uint8_t)(h[i] >> 24);
-		hash[j++] = (uint8_t)(h[i] >> 16);
-		hash[j++] = (uint8_t)(h[i] >> 8);
-		hash[j++] = (uint8_t)h[i];
+	for (i = 0, j = 0; j < ctx->hash_len; i++) {
+		hash[j++] = (uint8_t)(ctx->h[i] >> 24);
+		hash[j++] = (uint8_t)(ctx->h[i] >> 16);
+		hash[j++] = (uint8_t)(ctx->h[i] >> 8);
+		hash[j++] = (uint8_t)ctx->h[i];
 	}
 }
+
+/*
+ * Limitations:
+ * - SHA algorithms theoretically operate on bit strings. However, this implementation has no support for bit string
+ *   lengths that are not multiples of eight, and it really operates on arrays of bytes.  In particular, the len
+ *   parameter is a number of bytes.
+ */
+void
+calc_sha_256(uint8_t hash[32], const void *input, size_t len)
+{
+	struct sha_256 ctx;
+	sha_256_init(&ctx);
+	sha_256_update(&ctx, input, len);
+	sha_256_final(&ctx, hash);
+}
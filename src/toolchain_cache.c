@@ -0,0 +1,208 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "args.h"
+#include "cache.h"
+#include "log.h"
+#include "platform/filesystem.h"
+#include "platform/path.h"
+#include "platform/run_cmd.h"
+#include "sha_256.h"
+#include "toolchain_cache.h"
+
+#define TOOLCHAIN_CACHE_NS "toolchain"
+
+/*
+ * Environment variables that can change what a compiler reports about
+ * itself or how it compiles, e.g. the language of its messages or its
+ * search dirs.
+ */
+static const char *toolchain_cache_env[] = {
+	"PATH",
+	"LANG",
+	"LC_ALL",
+	"LC_MESSAGES",
+	"COMPILER_PATH",
+	"GCC_EXEC_PREFIX",
+	"LIBRARY_PATH",
+	"CPATH",
+	"C_INCLUDE_PATH",
+	"CPLUS_INCLUDE_PATH",
+	"OBJC_INCLUDE_PATH",
+	NULL
+};
+
+/*
+ * Resolve arg to a file, either as a command in PATH or as a path.  The
+ * first element of the command line must resolve, the rest are only
+ * looked at in case they are a wrapped compiler (e.g. ccache cc) or a file
+ * that is passed to it.
+ */
+static bool
+toolchain_cache_resolve(struct workspace *wk, struct sbuf *path, const char *arg, bool first)
+{
+	if (!*arg || *arg == '-') {
+		return false;
+	} else if (fs_find_cmd(wk, path, arg)) {
+		return true;
+	} else if (!first && !path_is_basename(arg) && fs_file_exists(arg)) {
+		path_make_absolute(wk, path, arg);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Entries in the shared cache are keyed by prefix, the resolved path,
+ * inode, mtime, and size of every element of cmd_arr that is a file, and the
+ * environment variables above.
+ */
+bool
+toolchain_cache_key(struct workspace *wk, const struct str *prefix, obj cmd_arr, uint8_t key[32])
+{
+	SBUF(buf);
+	sbuf_pushn(wk, &buf, prefix->s, prefix->len);
+
+	SBUF(path);
+	uint32_t i;
+	for (i = 0; i < get_obj_array(wk, cmd_arr)->len; ++i) {
+		obj arg;
+		obj_array_index(wk, cmd_arr, i, &arg);
+
+		if (!toolchain_cache_resolve(wk, &path, get_cstr(wk, arg), i == 0)) {
+			if (i == 0) {
+				return false;
+			}
+			continue;
+		}
+
+		struct stat sb;
+		if (!fs_stat(path.buf, &sb)) {
+			return false;
+		}
+
+		sbuf_pushf(wk, &buf, "\n%s\n%" PRIu64 "\n%" PRId64 "\n%" PRIu64,
+			path.buf,
+			(uint64_t)sb.st_ino,
+			fs_stat_mtime_ns(&sb),
+			(uint64_t)sb.st_size);
+	}
+
+	for (i = 0; toolchain_cache_env[i]; ++i) {
+		const char *v = getenv(toolchain_cache_env[i]);
+		sbuf_pushf(wk, &buf, "\n%s=%s", toolchain_cache_env[i], v ? v : "");
+	}
+
+	calc_sha_256(key, buf.buf, buf.len);
+	return true;
+}
+
+static bool
+toolchain_cache_entry(struct workspace *wk, obj entry, struct toolchain_cmd_result *res)
+{
+	if (get_obj_type(wk, entry) != obj_array || get_obj_array(wk, entry)->len != 3) {
+		return false;
+	}
+
+	obj status;
+	obj_array_index(wk, entry, 0, &status);
+	obj_array_index(wk, entry, 1, &res->out);
+	obj_array_index(wk, entry, 2, &res->err);
+
+	if (get_obj_type(wk, status) != obj_number
+	    || get_obj_type(wk, res->out) != obj_string
+	    || get_obj_type(wk, res->err) != obj_string) {
+		return false;
+	}
+
+	res->status = get_obj_number(wk, status);
+	return true;
+}
+
+/*
+ * Evicting scans the whole namespace, so it is done once at the end of setup
+ * rather than every time an entry is added.
+ */
+void
+toolchain_cache_evict(struct workspace *wk)
+{
+	if (!wk->toolchain_cache_written) {
+		return;
+	}
+
+	if (!cache_evict(wk, TOOLCHAIN_CACHE_NS, CACHE_DEFAULT_MAX_SIZE)) {
+		LOG_W("failed to evict old entries from the shared toolchain cache");
+	}
+}
+
+/*
+ * Run cmd_arr with arg appended, or look up the result of a previous run.
+ * Returns false if the command could not be run at all, which is never
+ * cached.
+ */
+bool
+toolchain_run_cmd(struct workspace *wk, obj cmd_arr, const char *arg, struct toolchain_cmd_result *res)
+{
+	obj args, entry;
+	obj_array_dup(wk, cmd_arr, &args);
+	obj_array_push(wk, args, make_str(wk, arg));
+
+	obj cmd_key;
+	obj_array_join(wk, false, args, make_strn(wk, "\0", 1), &cmd_key);
+
+	if (obj_dict_index(wk, wk->toolchain_cmd_cache, cmd_key, &entry)) {
+		return toolchain_cache_entry(wk, entry, res);
+	}
+
+	uint8_t key[32];
+	bool use_shared_cache = wk->compiler_check_shared_cache
+				&& toolchain_cache_key(wk, get_str(wk, cmd_key), cmd_arr, key);
+
+	if (use_shared_cache
+	    && cache_get(wk, TOOLCHAIN_CACHE_NS, key, &entry)
+	    && toolchain_cache_entry(wk, entry, res)) {
+		obj_dict_set(wk, wk->toolchain_cmd_cache, cmd_key, entry);
+		return true;
+	}
+
+	const char *argstr;
+	uint32_t argc;
+	join_args_argstr(wk, &argstr, &argc, args);
+
+	struct run_cmd_ctx cmd_ctx = { 0 };
+	if (!run_cmd(&cmd_ctx, argstr, argc, NULL, 0)) {
+		run_cmd_ctx_destroy(&cmd_ctx);
+		return false;
+	}
+
+	obj status;
+	make_obj(wk, &status, obj_number);
+	set_obj_number(wk, status, cmd_ctx.status);
+
+	make_obj(wk, &entry, obj_array);
+	obj_array_push(wk, entry, status);
+	obj_array_push(wk, entry, make_strn(wk, cmd_ctx.out.len ? cmd_ctx.out.buf : "", cmd_ctx.out.len));
+	obj_array_push(wk, entry, make_strn(wk, cmd_ctx.err.len ? cmd_ctx.err.buf : "", cmd_ctx.err.len));
+	run_cmd_ctx_destroy(&cmd_ctx);
+
+	obj_dict_set(wk, wk->toolchain_cmd_cache, cmd_key, entry);
+
+	if (use_shared_cache) {
+		if (!cache_set(wk, TOOLCHAIN_CACHE_NS, key, entry)) {
+			LOG_W("failed to write shared toolchain cache");
+		} else {
+			wk->toolchain_cache_written = true;
+		}
+	}
+
+	return toolchain_cache_entry(wk, entry, res);
+}
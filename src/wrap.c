@@ -8,6 +8,7 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "digest.h"
 #include "error.h"
 #include "external/libarchive.h"
 #include "external/libcurl.h"
@@ -220,19 +221,17 @@ wrap_parse_provides_cb(void *_ctx, struct source *src, const char *sect,
 }
 
 static bool
-checksum(const uint8_t *file_buf, uint64_t len, const char *sha256)
+checksum_verify(const uint8_t hash[32], const char *sha256)
 {
 	char buf[3] = { 0 };
 	uint32_t i;
-	uint8_t b, hash[32];
+	uint8_t b;
 
 	if (strlen(sha256) != 64) {
 		LOG_E("checksum '%s' is not 64 characters long", sha256);
 		return false;
 	}
 
-	calc_sha_256(hash, file_buf, len);
-
 	for (i = 0; i < 64; i += 2) {
 		memcpy(buf, &sha256[i], 2);
 		b = strtol(buf, NULL, 16);
@@ -246,40 +245,105 @@ checksum(const uint8_t *file_buf, uint64_t len, const char *sha256)
 }
 
 static bool
-checksum_extract(const char *buf, size_t len, const char *sha256,
-	const char *dest_dir)
+checksum_extract(const char *path, const char *sha256, const char *dest_dir)
 {
-	if (sha256 && !checksum((const uint8_t *)buf, len, sha256)) {
-		return false;
-	} else if (!muon_archive_extract(buf, len, dest_dir)) {
-		return false;
+	uint8_t hash[32];
+
+	if (sha256) {
+		if (!digest_file(digest_algo_sha256, path, hash)) {
+			return false;
+		} else if (!checksum_verify(hash, sha256)) {
+			return false;
+		}
 	}
 
-	return true;
+	return muon_archive_extract(path, dest_dir);
+}
+
+struct fetch_ctx {
+	FILE *f;
+	struct sha_256 sha;
+};
+
+static bool
+fetch_write_cb(void *_ctx, const uint8_t *buf, uint64_t len)
+{
+	struct fetch_ctx *ctx = _ctx;
+
+	sha_256_update(&ctx->sha, buf, len);
+	return fs_fwrite(buf, len, ctx->f);
 }
 
+/*
+ * Downloads are written to subprojects/packagecache as they arrive and hashed
+ * along the way, so memory use doesn't depend on the size of the archive.
+ * The file only replaces its final name in the cache once the checksum
+ * matches, and only then is it extracted.  A previously downloaded file in
+ * the cache is reused if it still matches the checksum.
+ */
 static bool
 fetch_checksum_extract(const char *src, const char *dest, const char *sha256,
-	const char *dest_dir)
+	const char *subprojects, const char *dest_dir)
 {
 	bool res = false;
-	uint8_t *dlbuf = NULL;
-	uint64_t dlbuf_len;
+	SBUF_manual(cache_path);
+	SBUF_manual(part_path);
 
+	path_join(NULL, &cache_path, subprojects, "packagecache");
+	if (!fs_mkdir_p(cache_path.buf)) {
+		goto ret;
+	}
+
+	path_push(NULL, &cache_path, dest);
+	sbuf_pushf(NULL, &part_path, "%s.part", cache_path.buf);
+
+	if (fs_file_exists(cache_path.buf)) {
+		uint8_t hash[32];
+		if (!sha256) {
+			res = muon_archive_extract(cache_path.buf, dest_dir);
+			goto ret;
+		} else if (digest_file(digest_algo_sha256, cache_path.buf, hash) && checksum_verify(hash, sha256)) {
+			res = muon_archive_extract(cache_path.buf, dest_dir);
+			goto ret;
+		}
+
+		LOG_W("discarding cached file '%s'", cache_path.buf);
+		if (!fs_remove(cache_path.buf)) {
+			goto ret;
+		}
+	}
+
+	struct fetch_ctx ctx = { 0 };
+	if (!(ctx.f = fs_fopen(part_path.buf, "wb"))) {
+		goto ret;
+	}
+
+	sha_256_init(&ctx.sha);
 	muon_curl_init();
 
-	if (!muon_curl_fetch(src, &dlbuf, &dlbuf_len)) {
+	bool fetched = muon_curl_fetch(src, fetch_write_cb, &ctx);
+
+	if (!fs_fclose(ctx.f)) {
+		fetched = false;
+	}
+
+	if (fetched && sha256) {
+		uint8_t hash[32];
+		sha_256_final(&ctx.sha, hash);
+		fetched = checksum_verify(hash, sha256);
+	}
+
+	if (!fetched) {
+		fs_remove(part_path.buf);
 		goto ret;
-	} else if (!checksum_extract((const char *)dlbuf, dlbuf_len, sha256, dest_dir)) {
+	} else if (!fs_rename(part_path.buf, cache_path.buf)) {
 		goto ret;
 	}
 
-	res = true;
+	res = muon_archive_extract(cache_path.buf, dest_dir);
 ret:
-	if (dlbuf) {
-		z_free(dlbuf);
-	}
-	muon_curl_deinit();
+	sbuf_destroy(&cache_path);
+	sbuf_destroy(&part_path);
 	return res;
 }
 
@@ -303,18 +367,10 @@ wrap_download_or_check_packagefiles(const char *filename, const char *url,
 			LOG_W("url specified, but local file '%s' is being used", source_path.buf);
 		}
 
-		struct source src = { 0 };
-		if (!fs_read_entire_file(source_path.buf, &src)) {
+		if (!checksum_extract(source_path.buf, hash, dest_dir)) {
 			goto ret;
 		}
 
-		if (!checksum_extract(src.src, src.len, hash, dest_dir)) {
-			fs_source_destroy(&src);
-			goto ret;
-		}
-
-		fs_source_destroy(&src);
-
 		res = true;
 	} else if (fs_dir_exists(source_path.buf)) {
 		if (url) {
@@ -331,7 +387,7 @@ wrap_download_or_check_packagefiles(const char *filename, const char *url,
 			LOG_E("wrap downloading is disabled");
 			goto ret;
 		}
-		res = fetch_checksum_extract(url, filename, hash, dest_dir);
+		res = fetch_checksum_extract(url, filename, hash, subprojects, dest_dir);
 	} else {
 		LOG_E("no url specified, but '%s' is not a file or directory", source_path.buf);
 	}
@@ -0,0 +1,21 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Print a plan and that many test points, flushing in the middle of each
+ * line so that lines are split between reads. */
+int main(int argc, char **argv) {
+    int i, n;
+
+    if (argc != 2) {
+        fprintf(stderr, "Incorrect number of arguments, got %i\n", argc);
+        return 1;
+    }
+    n = atoi(argv[1]);
+    printf("1..%i\n", n);
+    for (i = 1; i <= n; ++i) {
+        printf("ok ");
+        fflush(stdout);
+        printf("%i\n", i);
+    }
+    return 0;
+}
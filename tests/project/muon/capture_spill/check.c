@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int
+main(int argc, char *argv[])
+{
+	char line[64], expected[64];
+	long i = 0, n;
+	FILE *f;
+
+	if (argc < 3 || !(f = fopen(argv[1], "r"))) {
+		return 1;
+	}
+
+	n = strtol(argv[2], NULL, 10);
+	while (fgets(line, sizeof(line), f)) {
+		snprintf(expected, sizeof(expected), "line %ld\n", i);
+		if (strcmp(line, expected) != 0) {
+			fprintf(stderr, "line %ld: expected '%s', got '%s'\n", i, expected, line);
+			return 1;
+		}
+		++i;
+	}
+
+	fclose(f);
+
+	if (i != n) {
+		fprintf(stderr, "expected %ld lines, got %ld\n", n, i);
+		return 1;
+	}
+
+	return 0;
+}
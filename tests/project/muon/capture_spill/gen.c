@@ -0,0 +1,24 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int
+main(int argc, char *argv[])
+{
+	long i, n;
+
+	if (argc < 2) {
+		return 1;
+	}
+
+	n = strtol(argv[1], NULL, 10);
+	for (i = 0; i < n; ++i) {
+		printf("line %ld\n", i);
+	}
+
+	return 0;
+}
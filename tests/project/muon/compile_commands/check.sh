@@ -0,0 +1,26 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+set -eux
+
+# Every source gets an entry, and its command still compiles it when split
+# and run by a shell, which breaks if arguments are escaped wrongly.
+python3 - "$BUILD" <<'PY'
+import json, os, shlex, subprocess, sys
+
+build = os.path.abspath(sys.argv[1])
+
+with open(os.path.join(build, 'compile_commands.json')) as f:
+    entries = json.load(f)
+
+assert sorted(os.path.basename(e['file']) for e in entries) == ['main.c', 'other file.c'], entries
+
+for e in entries:
+    assert os.path.samefile(e['directory'], build), e
+    args = shlex.split(e['command'])
+    for arg in ['-DSPACE="a b"', '-DQUOTE="it\'s"', '-DBACKSLASH="a\\b"', e['file']]:
+        assert arg in args, (arg, args)
+    assert args[args.index('-o') + 1] == e['output'], e
+    subprocess.check_call(e['command'], shell=True, cwd=e['directory'])
+PY
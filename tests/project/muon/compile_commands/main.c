@@ -0,0 +1,17 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <string.h>
+
+int other(void);
+
+int
+main(void)
+{
+	return strcmp(SPACE, "a b") != 0
+	       || strcmp(QUOTE, "it's") != 0
+	       || strcmp(BACKSLASH, "a\b") != 0
+	       || other() != 0;
+}
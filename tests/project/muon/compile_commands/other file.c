@@ -0,0 +1,12 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+int other(void);
+
+int
+other(void)
+{
+	return 0;
+}
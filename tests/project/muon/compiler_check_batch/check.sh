@@ -0,0 +1,13 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+set -eux
+
+# The checks must give the same answers whether they run one at a time,
+# where they stop as soon as the answer is known, or concurrently.
+src="$(cd "$(dirname "$0")" && pwd)"
+
+for jobs in 1 2 8; do
+	"$MUON" -C "$src" setup -j "$jobs" "$BUILD/jobs-$jobs"
+done
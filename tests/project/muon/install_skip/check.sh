@@ -0,0 +1,38 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+set -eux
+
+src="$(dirname "$0")"
+data="$DESTDIR/usr/share/install skip/data.txt"
+other="$DESTDIR/usr/share/install skip/other.txt"
+
+mode() {
+	ls -l "$1" | cut -c1-10
+}
+
+[ "$(mode "$data")" = "-rw-------" ]
+cmp "$src/data.txt" "$data"
+cmp "$src/other.txt" "$other"
+
+# Files with the same size and mtime as their source are skipped, but still
+# get their install_mode.
+chmod 644 "$data"
+printf 'OTHER DATA\n' > "$other"
+touch -r "$src/other.txt" "$other"
+
+"$MUON" -C "$BUILD" install
+
+[ "$(mode "$data")" = "-rw-------" ]
+[ "$(cat "$other")" = "OTHER DATA" ]
+
+# Files that differ in size or mtime are copied again.
+printf 'changed\n' > "$data"
+touch "$other"
+
+"$MUON" -C "$BUILD" install
+
+[ "$(mode "$data")" = "-rw-------" ]
+cmp "$src/data.txt" "$data"
+cmp "$src/other.txt" "$other"
@@ -0,0 +1,65 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+set -eux
+
+src="$(cd "$(dirname "$0")" && pwd)"
+build="$(cd "$BUILD" && pwd)"
+
+"$MUON" -C "$src" setup -j 4 -p "$build/trace.json" "$build/profile-build"
+
+python3 - "$build/trace.json" <<'PY'
+import json, sys
+
+with open(sys.argv[1]) as f:
+    trace = json.load(f)
+
+# ts and dur are printed in microseconds with 3 decimals
+eps = 0.002
+
+events = trace['traceEvents']
+names = {e['tid']: e['args']['name'] for e in events if e['ph'] == 'M'}
+spans = [e for e in events if e['ph'] != 'M']
+
+assert names[1] == 'muon', names
+assert spans
+
+lanes = {}
+for s in spans:
+    assert s['ph'] == 'X' and s['pid'] == 1, s
+    assert s['ts'] >= 0 and s['dur'] >= 0, s
+    assert s['tid'] in names, s
+    lanes.setdefault(s['tid'], []).append(s)
+
+cats = {s['cat'] for s in spans}
+for cat in ['setup', 'eval', 'backend', 'compiler_check']:
+    assert cat in cats, (cat, cats)
+
+# Spans on the main thread are opened and closed in order, so each one is
+# either nested in another or comes after it.
+main = sorted(lanes[1], key=lambda s: (s['ts'], -s['dur']))
+setup = main[0]
+assert setup['cat'] == 'setup', setup
+
+stack = []
+for s in main:
+    while stack and stack[-1]['ts'] + stack[-1]['dur'] <= s['ts'] + eps:
+        stack.pop()
+    if stack:
+        assert s['ts'] + s['dur'] <= stack[-1]['ts'] + stack[-1]['dur'] + eps, (s, stack[-1])
+    stack.append(s)
+
+# Concurrent compiler checks are on other lanes, where spans never overlap.
+for tid, lane in lanes.items():
+    if tid == 1:
+        continue
+    assert names[tid] == 'lane %d' % (tid - 1), names
+    lane.sort(key=lambda s: s['ts'])
+    for a, b in zip(lane, lane[1:]):
+        assert a['ts'] + a['dur'] <= b['ts'] + eps, (a, b)
+    for s in lane:
+        assert s['cat'] == 'compiler_check', s
+        assert setup['ts'] <= s['ts'] + eps
+        assert s['ts'] + s['dur'] <= setup['ts'] + setup['dur'] + eps, s
+PY
@@ -0,0 +1,50 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+set -eux
+
+src="$(cd "$(dirname "$0")" && pwd)"
+build="$(cd "$BUILD" && pwd)"
+python="$(command -v python3)"
+
+# The interpreter is a wrapper script that counts how often it is run.
+wrapper="$build/python-wrapper"
+log="$build/python-runs"
+
+write_wrapper() {
+	printf '#!/bin/sh\n# %s\necho run >> "%s"\nexec "%s" "$@"\n' "$1" "$log" "$python" > "$wrapper"
+	chmod +x "$wrapper"
+}
+
+runs() {
+	wc -l < "$log" | tr -d ' '
+}
+
+setup() {
+	"$MUON" -C "$src" setup -Dpython="$wrapper" "$@" "$build/cache-build"
+}
+
+rm -rf "$build/cache-build"
+: > "$log"
+write_wrapper v1
+
+setup
+[ "$(runs)" -eq 1 ]
+
+# An unchanged interpreter is introspected only once.
+setup
+[ "$(runs)" -eq 1 ]
+
+# Changing it invalidates the cached result.
+write_wrapper version-2
+setup
+[ "$(runs)" -eq 2 ]
+setup
+[ "$(runs)" -eq 2 ]
+
+# Modules can be installed at any time, so they are always probed.
+setup -Dmodules=json
+[ "$(runs)" -eq 3 ]
+setup -Dmodules=json
+[ "$(runs)" -eq 4 ]
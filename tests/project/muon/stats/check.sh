@@ -0,0 +1,51 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+set -eux
+
+src="$(cd "$(dirname "$0")" && pwd)"
+build="$(cd "$BUILD" && pwd)"
+
+"$MUON" -C "$src" setup -S "$build/setup_stats.json" "$build/stats-build"
+"$MUON" internal stats -o "$build/eval_stats.json" "$src/eval.meson"
+
+python3 - "$build/setup_stats.json" "$build/eval_stats.json" <<'PY'
+import json, sys
+
+def check_arena(a, keys):
+    for k in keys:
+        assert isinstance(a[k], int) and a[k] >= 0, (k, a)
+
+bucket_arr = ['count', 'item_size', 'bucket_size', 'buckets', 'bytes']
+
+for path in sys.argv[1:]:
+    with open(path) as f:
+        stats = json.load(f)
+
+    assert stats['phase'] == 'evaluation', stats['phase']
+    assert stats['objects'] > 0
+
+    types = stats['types']
+    assert types['str']['count'] > 0, types['str']
+    for t in types.values():
+        assert isinstance(t['count'], int)
+        if 'bytes' in t:
+            check_arena(t, bucket_arr)
+            assert 0 <= t['utilization'] <= 1, t
+
+    arenas = stats['arenas']
+    for name in ['objs', 'chrs', 'dict_elems', 'dict_hashes']:
+        check_arena(arenas[name], bucket_arr)
+    assert arenas['objs']['count'] == stats['objects']
+    check_arena(arenas['array_elems'], ['count', 'item_size', 'capacity', 'bytes'])
+    check_arena(arenas['dict_hash_tables'], ['bytes'])
+    check_arena(arenas['big_strings'], ['count', 'bytes'])
+
+    interning = stats['interning']
+    check_arena(interning, ['entries', 'bytes', 'str_lookups', 'str_hits', 'sym_lookups', 'sym_hits'])
+    assert 0 <= interning['str_hit_rate'] <= 1
+
+    assert stats['total_bytes'] > 0
+    assert stats['peak_rss'] is None or stats['peak_rss'] > 0
+PY
@@ -0,0 +1,26 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+set -eux
+
+list() {
+	"$MUON" -C "$BUILD" test -R -l "$@" | sed -n 's/^test order:\[.\(.\).\] - /\1:/p' | tr '\n' ' '
+}
+
+rm -f "$BUILD/muon-private/test_history.dat"
+
+# Tests without history are started first, then the slowest ones.  The two
+# dup tests are told apart by their suite.
+"$MUON" -C "$BUILD" test -R slow dup
+[ "$(list)" = "a:new a:slow a:dup b:dup " ]
+
+# With -F, the tests that failed last time come before everything else.
+touch "$BUILD/fail-dup-b"
+if "$MUON" -C "$BUILD" test -R; then
+	exit 1
+fi
+rm "$BUILD/fail-dup-b"
+
+[ "$(list -F)" = "b:dup a:slow a:dup a:new " ]
+[ "$(list)" = "a:slow a:dup b:dup a:new " ] || [ "$(list)" = "a:slow a:dup a:new b:dup " ]
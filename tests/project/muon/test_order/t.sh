@@ -0,0 +1,6 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+sleep "$1"
+[ ! -e "$2" ]
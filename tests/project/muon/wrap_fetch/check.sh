@@ -0,0 +1,68 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+set -eux
+
+# Fetching and extracting wraps needs both libcurl and libarchive.
+features="$("$MUON" version)"
+case "$features" in
+*libcurl*libarchive* | *libarchive*libcurl*) ;;
+*) exit 77 ;;
+esac
+
+if command -v sha256sum >/dev/null; then
+	sha256() { sha256sum "$1" | cut -d' ' -f1; }
+elif command -v shasum >/dev/null; then
+	sha256() { shasum -a 256 "$1" | cut -d' ' -f1; }
+else
+	exit 77
+fi
+
+work="$(cd "$BUILD" && pwd)/wrap_fetch"
+subprojects="$work/subprojects"
+cache="$subprojects/packagecache"
+
+rm -rf "$work"
+mkdir -p "$work/pkg-1.0" "$subprojects"
+printf 'hello\n' > "$work/pkg-1.0/data.txt"
+(cd "$work" && tar czf pkg.tar.gz pkg-1.0)
+
+write_wrap() {
+	cat > "$subprojects/pkg.wrap" <<WRAP
+[wrap-file]
+directory = pkg-1.0
+source_url = file://$work/pkg.tar.gz
+source_filename = pkg.tar.gz
+source_hash = $1
+WRAP
+}
+
+download() {
+	"$MUON" subprojects -d "$subprojects" download
+}
+
+# A download that doesn't match the hash leaves nothing behind.
+write_wrap 0000000000000000000000000000000000000000000000000000000000000000
+if download; then
+	exit 1
+fi
+
+[ ! -e "$cache/pkg.tar.gz.part" ]
+[ ! -e "$cache/pkg.tar.gz" ]
+[ ! -e "$subprojects/pkg-1.0" ]
+
+# A matching download is kept in the packagecache and extracted.
+write_wrap "$(sha256 "$work/pkg.tar.gz")"
+download
+
+[ ! -e "$cache/pkg.tar.gz.part" ]
+cmp "$work/pkg.tar.gz" "$cache/pkg.tar.gz"
+cmp "$work/pkg-1.0/data.txt" "$subprojects/pkg-1.0/data.txt"
+
+# Once verified, the cached file is used without downloading it again.
+rm -r "$subprojects/pkg-1.0"
+mv "$work/pkg.tar.gz" "$work/moved.tar.gz"
+download
+
+cmp "$work/pkg-1.0/data.txt" "$subprojects/pkg-1.0/data.txt"
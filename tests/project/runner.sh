@@ -58,11 +58,13 @@ DESTDIR=destdir "$muon" -C "$build" install
 
 if [ -x "$source/check.sh" ]; then
 	set +e
-	DESTDIR="$build/destdir" "$source/check.sh"
+	MUON="$muon" BUILD="$build" DESTDIR="$build/destdir" "$source/check.sh"
 	res=$?
 	set -e
 
-	if [ $res -ne 0 ]; then
+	if [ $res -eq 77 ]; then
+		exit "$skip_exit_code"
+	elif [ $res -ne 0 ]; then
 		set +x
 		exec >&2
 		if [ -d "$build/destdir" ]; then